@@ -0,0 +1,93 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#ifndef _OBLIVION_CORE_ALIGNED_BUFFER_H_
+#define _OBLIVION_CORE_ALIGNED_BUFFER_H_
+
+#include <cstddef>
+
+#include <oblivion/core/base.h>
+#include <oblivion/core/non_copyable.h>
+
+namespace oblivion {
+
+    /**
+     * A block of memory whose address is a multiple of a power of two, as direct
+     * I/O requires. The contents are not initialized.
+     */
+    class OB_CORE_API AlignedBuffer : NonCopyable {
+
+    public:
+
+        /**
+         * The default alignment, which suits direct I/O on any common storage device.
+         */
+        static const size_t DEFAULT_ALIGNMENT = 4096;
+
+        /**
+         * Creates an empty buffer.
+         */
+        AlignedBuffer();
+
+        /**
+         * Allocates a buffer.
+         * @param size The number of bytes.
+         * @param alignment The alignment of the first byte, a power of two.
+         * @throw Exception if the alignment is invalid or the memory cannot be allocated.
+         */
+        explicit AlignedBuffer(size_t size, size_t alignment = DEFAULT_ALIGNMENT);
+
+        /**
+         * Move constructs a buffer.
+         * @param other The buffer to move.
+         */
+        AlignedBuffer(AlignedBuffer&& other);
+
+        /**
+         * Frees the buffer.
+         */
+        ~AlignedBuffer();
+
+        /**
+         * Move assignment.
+         * @param other The buffer to move.
+         * @return A reference to this buffer.
+         */
+        AlignedBuffer& operator =(AlignedBuffer&& other);
+
+        /**
+         * Gets the first byte.
+         * @return The first byte, or nullptr if the buffer is empty.
+         */
+        char* data() const {
+            return data_;
+        }
+
+        /**
+         * Gets the number of bytes.
+         * @return The number of bytes.
+         */
+        size_t size() const {
+            return size_;
+        }
+
+        /**
+         * Gets the alignment of the first byte.
+         * @return The alignment.
+         */
+        size_t alignment() const {
+            return alignment_;
+        }
+
+    private:
+
+        char* data_;
+
+        size_t size_;
+
+        size_t alignment_;
+
+    };
+
+}
+
+#endif /* _OBLIVION_CORE_ALIGNED_BUFFER_H_ */
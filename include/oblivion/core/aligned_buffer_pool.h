@@ -0,0 +1,142 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#ifndef _OBLIVION_CORE_ALIGNED_BUFFER_POOL_H_
+#define _OBLIVION_CORE_ALIGNED_BUFFER_POOL_H_
+
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+#include <oblivion/core/aligned_buffer.h>
+#include <oblivion/core/base.h>
+#include <oblivion/core/non_copyable.h>
+
+namespace oblivion {
+
+    /**
+     * A thread-safe pool of aligned buffers of one size. Allocating aligned
+     * memory for every direct I/O request is slow and fragments the heap, so
+     * buffers are handed out as leases and return to the pool when the lease
+     * ends. The pool grows on demand and keeps a limited number of idle buffers.
+     */
+    class OB_CORE_API AlignedBufferPool : NonCopyable {
+
+    public:
+
+        /**
+         * A buffer borrowed from a pool, which returns it when destroyed. A lease
+         * must not outlive its pool.
+         */
+        class OB_CORE_API Lease : NonCopyable {
+
+        public:
+
+            /**
+             * Move constructs a lease.
+             * @param other The lease to move.
+             */
+            Lease(Lease&& other);
+
+            /**
+             * Returns the buffer to the pool.
+             */
+            ~Lease();
+
+            /**
+             * Move assignment.
+             * @param other The lease to move.
+             * @return A reference to this lease.
+             */
+            Lease& operator =(Lease&& other);
+
+            /**
+             * Gets the first byte of the buffer.
+             * @return The first byte.
+             */
+            char* data() const {
+                return buffer_.data();
+            }
+
+            /**
+             * Gets the number of bytes in the buffer.
+             * @return The number of bytes.
+             */
+            size_t size() const {
+                return buffer_.size();
+            }
+
+        private:
+
+            friend class AlignedBufferPool;
+
+            Lease(AlignedBufferPool* pool, AlignedBuffer&& buffer);
+
+            /**
+             * Gives the buffer back to the pool, if there is one.
+             */
+            void release();
+
+            AlignedBufferPool* pool_;
+
+            AlignedBuffer buffer_;
+
+        };
+
+        /**
+         * Creates an empty pool.
+         * @param bufferSize The size of each buffer in bytes.
+         * @param alignment The alignment of each buffer, a power of two.
+         * @param maxIdle The most unused buffers kept for reuse; more are freed.
+         * @throw Exception if the size or alignment is invalid.
+         */
+        explicit AlignedBufferPool(size_t bufferSize, size_t alignment = AlignedBuffer::DEFAULT_ALIGNMENT,
+            size_t maxIdle = 16);
+
+        /**
+         * Borrows a buffer, allocating one if none is idle.
+         * @return The lease.
+         * @throw Exception if the memory cannot be allocated.
+         */
+        Lease acquire();
+
+        /**
+         * Gets the size of each buffer.
+         * @return The size in bytes.
+         */
+        size_t bufferSize() const {
+            return bufferSize_;
+        }
+
+        /**
+         * Gets the alignment of each buffer.
+         * @return The alignment.
+         */
+        size_t alignment() const {
+            return alignment_;
+        }
+
+        /**
+         * Gets the number of buffers waiting to be reused.
+         * @return The number of idle buffers.
+         */
+        size_t idle() const;
+
+    private:
+
+        void release(AlignedBuffer&& buffer);
+
+        size_t bufferSize_;
+
+        size_t alignment_;
+
+        size_t maxIdle_;
+
+        mutable std::mutex mutex_;
+
+        std::vector<AlignedBuffer> idle_;
+
+    };
+
+}
+
+#endif /* _OBLIVION_CORE_ALIGNED_BUFFER_POOL_H_ */
@@ -0,0 +1,254 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#ifndef _OBLIVION_CORE_APPEND_LOG_H_
+#define _OBLIVION_CORE_APPEND_LOG_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include <oblivion/core/base.h>
+#include <oblivion/core/file.h>
+#include <oblivion/core/non_copyable.h>
+#include <oblivion/core/types.h>
+
+namespace oblivion {
+
+    /**
+     * When appended records reach the storage device.
+     */
+    enum class Durability {
+
+        /**
+         * Records are written by the background flusher but only synced when
+         * sync is called or a segment is finished.
+         */
+        None,
+
+        /**
+         * Records are synced at least once per interval. A crash loses at most
+         * the last interval of appends.
+         */
+        Interval,
+
+        /**
+         * Every append waits until its record has been synced.
+         */
+        Commit
+
+    };
+
+    /**
+     * An append-only log for write-ahead logging. Appends from any number of
+     * threads are copied into a shared batch, and a background flusher writes
+     * each batch with one write and makes it durable with one fdatasync. In
+     * Commit mode, appends that arrive while a sync is in progress wait for the
+     * next one together, so the cost of a sync is shared by the whole group.
+     *
+     * The log is a series of segment files named path.000001, path.000002 and
+     * so on. A new log starts a new segment after any that already exist. When
+     * a segment reaches segmentSize, the next batch starts a new one. Records
+     * are not split across segments, so a segment can grow past segmentSize by
+     * up to one batch. Records are stored as given; callers that need to find
+     * record boundaries on recovery must frame them.
+     */
+    class OB_CORE_API AppendLog : NonCopyable {
+
+    public:
+
+        /**
+         * Settings for a log.
+         */
+        struct OB_CORE_API Options {
+
+            /**
+             * Sets the defaults: Commit durability, a 100 ms interval, 64 MiB
+             * segments with preallocation and a 64 MiB limit on buffered records.
+             */
+            Options();
+
+            Durability durability;
+
+            /**
+             * The longest time in milliseconds records wait to be written, and
+             * in Interval mode to be synced.
+             */
+            int32 interval;
+
+            /**
+             * The size in bytes at which a new segment is started.
+             */
+            uint64 segmentSize;
+
+            /**
+             * Whether to reserve disk space for each segment when it is created.
+             */
+            bool preallocate;
+
+            /**
+             * The number of bytes that can wait to be written before appends block.
+             */
+            size_t maxPending;
+
+        };
+
+        /**
+         * Opens a log and starts its flusher.
+         * @param path The path of the log, without the segment number.
+         * @param options The settings.
+         * @throw Exception if the options are invalid or the first segment cannot be created.
+         */
+        explicit AppendLog(const std::string& path, const Options& options = Options());
+
+        /**
+         * Writes any remaining records, syncs them unless durability is None and
+         * closes the log.
+         */
+        ~AppendLog();
+
+        /**
+         * Appends a record. Returns once the record is durable in Commit mode,
+         * or once it is buffered otherwise.
+         * @param data The record.
+         * @param size The number of bytes in the record.
+         * @return The position of the end of the record, counted in bytes appended
+         *         through this object. @see durablePosition
+         * @throw Exception if the log has failed to write or sync.
+         */
+        uint64 append(const void* data, size_t size);
+
+        /**
+         * Appends a record. @see AppendLog::append
+         * @param record The record.
+         * @return The position of the end of the record.
+         */
+        uint64 append(const std::string& record);
+
+        /**
+         * Waits until every record appended so far is durable, in any mode.
+         * @throw Exception if the log has failed to write or sync.
+         */
+        void sync();
+
+        /**
+         * Gets the position of the end of the last appended record.
+         * @return The position in bytes.
+         */
+        uint64 position() const;
+
+        /**
+         * Gets the position up to which records are known to be on the storage device.
+         * @return The position in bytes.
+         */
+        uint64 durablePosition() const;
+
+        /**
+         * Gets the number of the segment being written.
+         * @return The segment number, starting from 1.
+         */
+        int32 segment() const;
+
+        /**
+         * Gets the path of a segment file.
+         * @param index The segment number.
+         * @return The path.
+         */
+        std::string segmentPath(int32 index) const;
+
+    private:
+
+        /**
+         * The body of the flusher thread.
+         */
+        void run();
+
+        /**
+         * Gets whether the flusher has work that cannot wait for the next interval.
+         * The mutex must be held.
+         */
+        bool ready() const;
+
+        /**
+         * Throws the flusher's error, if any. The mutex must be held.
+         */
+        void check() const;
+
+        /**
+         * Writes a batch to the current segment, starting a new one if it is full.
+         */
+        void write(const std::string& batch);
+
+        /**
+         * Creates a segment file and makes it the current one.
+         */
+        void openSegment(int32 index);
+
+        std::string path_;
+
+        Options options_;
+
+        /**
+         * The batch size that wakes the flusher before the interval ends.
+         */
+        size_t flushThreshold_;
+
+        mutable std::mutex mutex_;
+
+        /**
+         * Wakes the flusher.
+         */
+        std::condition_variable work_;
+
+        /**
+         * Wakes appenders when records are written or synced.
+         */
+        std::condition_variable done_;
+
+        /**
+         * Records waiting to be written, and the batch being written. They are
+         * swapped rather than reallocated.
+         */
+        std::string pending_;
+
+        std::string writing_;
+
+        uint64 appended_;
+
+        uint64 written_;
+
+        uint64 durable_;
+
+        /**
+         * The position that callers of sync are waiting for.
+         */
+        uint64 syncTarget_;
+
+        /**
+         * The number of appenders waiting for room in the batch.
+         */
+        int32 blocked_;
+
+        bool stopping_;
+
+        std::string error_;
+
+        /**
+         * The current segment. Only the flusher touches it once started.
+         */
+        std::unique_ptr<File> file_;
+
+        std::atomic<int32> segment_;
+
+        uint64 segmentOffset_;
+
+        std::thread flusher_;
+
+    };
+
+}
+
+#endif /* _OBLIVION_CORE_APPEND_LOG_H_ */
@@ -0,0 +1,241 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#ifndef _OBLIVION_CORE_ASYNC_IO_H_
+#define _OBLIVION_CORE_ASYNC_IO_H_
+
+#include <cstddef>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <oblivion/core/base.h>
+#include <oblivion/core/io_buffer.h>
+#include <oblivion/core/non_copyable.h>
+#include <oblivion/core/types.h>
+
+namespace oblivion {
+
+    /**
+     * The mechanism AsyncIo uses to perform requests.
+     */
+    enum class IoBackend {
+
+        /**
+         * io_uring if the kernel supports it, otherwise the thread pool.
+         */
+        Auto,
+
+        /**
+         * Linux io_uring. Requests go to the kernel in batches and complete
+         * without a thread blocking on each one.
+         */
+        IoUring,
+
+        /**
+         * A pool of threads that each perform one blocking request at a time.
+         */
+        ThreadPool
+
+    };
+
+    /**
+     * Asynchronous file I/O on posix file descriptors. Requests are queued by
+     * the methods below and handed to the backend together when submit is
+     * called, or automatically once queueDepth requests are waiting. Each
+     * request completes by calling its callback, or fulfilling its future, on
+     * a thread owned by this object with the result of the equivalent system
+     * call: a byte count or file descriptor on success, or a negative errno.
+     * Reads and writes may complete partially, like pread and pwrite.
+     *
+     * Callbacks must not block for long, since they hold up other completions,
+     * and must not call drain or registerBuffers. They may queue further requests.
+     * Buffers and paths must stay valid until the request completes.
+     */
+    class OB_CORE_API AsyncIo : NonCopyable {
+
+    public:
+
+        /**
+         * Receives the result of a request.
+         */
+        typedef std::function<void(int64 result)> Callback;
+
+        /**
+         * Starts the I/O engine.
+         * @param backend The backend to use.
+         * @param queueDepth The number of requests queued before they are submitted automatically.
+         * @param threadCount The number of threads for the thread pool backend.
+         * @throw Exception if the backend is IoUring and io_uring is not available.
+         */
+        explicit AsyncIo(IoBackend backend = IoBackend::Auto, int32 queueDepth = 256, int32 threadCount = 4);
+
+        /**
+         * Completes every outstanding request and stops the engine.
+         */
+        ~AsyncIo();
+
+        /**
+         * Gets the backend in use, which is never Auto.
+         * @return The backend.
+         */
+        IoBackend backend() const;
+
+        /**
+         * Queues an open. The result is the new file descriptor.
+         * @param path The path to open.
+         * @param flags The open flags (@see open).
+         * @param mode The permissions for a created file.
+         * @param callback Receives the result.
+         */
+        void open(const std::string& path, int flags, int mode, Callback callback);
+
+        /**
+         * Queues a positioned read.
+         * @param fd The file descriptor.
+         * @param buffer Receives the data.
+         * @param size The number of bytes to read.
+         * @param offset The file offset to read from.
+         * @param callback Receives the number of bytes read.
+         */
+        void read(int fd, void* buffer, size_t size, uint64 offset, Callback callback);
+
+        /**
+         * Queues a positioned write.
+         * @param fd The file descriptor.
+         * @param buffer The data to write.
+         * @param size The number of bytes to write.
+         * @param offset The file offset to write at.
+         * @param callback Receives the number of bytes written.
+         */
+        void write(int fd, const void* buffer, size_t size, uint64 offset, Callback callback);
+
+        /**
+         * Queues a read into a registered buffer. @see registerBuffers
+         * @param fd The file descriptor.
+         * @param bufferIndex The index of the registered buffer.
+         * @param buffer Receives the data; must lie inside the registered buffer.
+         * @param size The number of bytes to read.
+         * @param offset The file offset to read from.
+         * @param callback Receives the number of bytes read.
+         */
+        void readFixed(int fd, int32 bufferIndex, void* buffer, size_t size, uint64 offset, Callback callback);
+
+        /**
+         * Queues a write from a registered buffer. @see registerBuffers
+         * @param fd The file descriptor.
+         * @param bufferIndex The index of the registered buffer.
+         * @param buffer The data to write; must lie inside the registered buffer.
+         * @param size The number of bytes to write.
+         * @param offset The file offset to write at.
+         * @param callback Receives the number of bytes written.
+         */
+        void writeFixed(int fd, int32 bufferIndex, const void* buffer, size_t size, uint64 offset, Callback callback);
+
+        /**
+         * Queues a flush of a file to the storage device.
+         * @param fd The file descriptor.
+         * @param dataOnly Whether to skip metadata that is not needed to read the data back (@see fdatasync).
+         * @param callback Receives 0 on success.
+         */
+        void sync(int fd, bool dataOnly, Callback callback);
+
+        /**
+         * Queues a close.
+         * @param fd The file descriptor.
+         * @param callback Receives 0 on success.
+         */
+        void close(int fd, Callback callback);
+
+        /**
+         * Queues an open. @see AsyncIo::open
+         * @return The future result.
+         */
+        std::future<int64> open(const std::string& path, int flags, int mode);
+
+        /**
+         * Queues a positioned read. @see AsyncIo::read
+         * @return The future result.
+         */
+        std::future<int64> read(int fd, void* buffer, size_t size, uint64 offset);
+
+        /**
+         * Queues a positioned write. @see AsyncIo::write
+         * @return The future result.
+         */
+        std::future<int64> write(int fd, const void* buffer, size_t size, uint64 offset);
+
+        /**
+         * Queues a flush. @see AsyncIo::sync
+         * @return The future result.
+         */
+        std::future<int64> sync(int fd, bool dataOnly);
+
+        /**
+         * Queues a close. @see AsyncIo::close
+         * @return The future result.
+         */
+        std::future<int64> close(int fd);
+
+        /**
+         * Registers buffers for readFixed and writeFixed. With io_uring the kernel
+         * pins the buffers once instead of on every request. Any previously
+         * registered buffers are replaced. Outstanding requests are completed
+         * first, as with drain.
+         * @param buffers The buffers.
+         * @throw Exception if the buffers cannot be registered.
+         */
+        void registerBuffers(const std::vector<IoBuffer>& buffers);
+
+        /**
+         * Hands every queued request to the backend in one batch.
+         * @return The number of requests submitted.
+         * @throw Exception if the requests cannot be submitted.
+         */
+        int32 submit();
+
+        /**
+         * Submits every queued request and waits until all requests have
+         * completed, including any that their callbacks queue.
+         * @throw Exception if the requests cannot be submitted or the backend
+         * can no longer wait for completions.
+         */
+        void drain();
+
+    private:
+
+        /**
+         * A queued request.
+         */
+        struct Request;
+
+        /**
+         * The interface the backends implement.
+         */
+        struct Impl;
+
+        struct ThreadPool;
+
+        struct IoUring;
+
+        /**
+         * Queues a request.
+         */
+        void enqueue(Request* request);
+
+        /**
+         * Validates a fixed-buffer request.
+         * @throw Exception if the buffer is not inside the registered buffer.
+         */
+        void checkFixed(int32 bufferIndex, const void* buffer, size_t size) const;
+
+        std::unique_ptr<Impl> impl_;
+
+        std::vector<IoBuffer> buffers_;
+
+    };
+
+}
+
+#endif /* _OBLIVION_CORE_ASYNC_IO_H_ */
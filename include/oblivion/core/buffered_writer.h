@@ -0,0 +1,241 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#ifndef _OBLIVION_CORE_BUFFERED_WRITER_H_
+#define _OBLIVION_CORE_BUFFERED_WRITER_H_
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <oblivion/core/base.h>
+#include <oblivion/core/file.h>
+#include <oblivion/core/non_copyable.h>
+#include <oblivion/core/types.h>
+
+namespace oblivion {
+
+    /**
+     * When a BufferedWriter passes its buffer to the file.
+     */
+    enum class FlushPolicy {
+
+        /**
+         * Only when the buffer is full, when flush is called and on destruction.
+         */
+        WhenFull,
+
+        /**
+         * Also after every appendLine, for output that is followed as it is written.
+         */
+        EveryLine
+
+    };
+
+    /**
+     * Collects output in a large buffer and writes it to a file in big blocks.
+     * Appending copies into the buffer without parsing a format string, and
+     * numbers are converted by hand rather than through printf, so millions of
+     * small appends cost little more than the copies themselves.
+     */
+    class OB_CORE_API BufferedWriter : NonCopyable {
+
+    public:
+
+        /**
+         * The default buffer size in bytes.
+         */
+        static const size_t DEFAULT_BUFFER_SIZE = 1 << 20;
+
+        /**
+         * Creates a writer for an open file. The file must outlive the writer.
+         * @param file The file to write to.
+         * @param bufferSize The number of bytes to buffer.
+         * @param policy When to write the buffer to the file.
+         */
+        explicit BufferedWriter(File& file, size_t bufferSize = DEFAULT_BUFFER_SIZE,
+            FlushPolicy policy = FlushPolicy::WhenFull);
+
+        /**
+         * Creates a file and a writer for it.
+         * @param path The path to the file, which is replaced if it exists.
+         * @param bufferSize The number of bytes to buffer.
+         * @param policy When to write the buffer to the file.
+         * @throw Exception if the file cannot be created.
+         */
+        explicit BufferedWriter(const std::string& path, size_t bufferSize = DEFAULT_BUFFER_SIZE,
+            FlushPolicy policy = FlushPolicy::WhenFull);
+
+        /**
+         * Writes whatever is buffered. Errors are ignored; call flush first to see them.
+         */
+        ~BufferedWriter();
+
+        /**
+         * Appends bytes.
+         * @param data The bytes to append.
+         * @param size The number of bytes.
+         * @return A reference to this writer.
+         * @throw Exception if the buffer has to be written and the write fails.
+         */
+        BufferedWriter& append(const char* data, size_t size) {
+            if (size <= static_cast<size_t>(end_ - position_)) {
+                memcpy(position_, data, size);
+                position_ += size;
+                return *this;
+            }
+
+            return appendSlow(data, size);
+        }
+
+        /**
+         * Appends a string.
+         * @param text The string to append.
+         * @return A reference to this writer.
+         */
+        BufferedWriter& append(const std::string& text) {
+            return append(text.data(), text.size());
+        }
+
+        /**
+         * Appends a NUL-terminated string.
+         * @param text The string to append.
+         * @return A reference to this writer.
+         */
+        BufferedWriter& append(const char* text) {
+            return append(text, strlen(text));
+        }
+
+        /**
+         * Appends a character.
+         * @param c The character to append.
+         * @return A reference to this writer.
+         */
+        BufferedWriter& append(char c) {
+            if (position_ == end_) {
+                flushBuffer();
+            }
+
+            *position_++ = c;
+            return *this;
+        }
+
+        /**
+         * Appends an integer in decimal. There is an overload for every standard integer
+         * type, so int64, size_t and the like resolve on every platform.
+         * @param value The integer to append.
+         * @return A reference to this writer.
+         */
+        BufferedWriter& append(int value);
+
+        /**
+         * Appends an integer in decimal.
+         * @param value The integer to append.
+         * @return A reference to this writer.
+         */
+        BufferedWriter& append(long value);
+
+        /**
+         * Appends an integer in decimal.
+         * @param value The integer to append.
+         * @return A reference to this writer.
+         */
+        BufferedWriter& append(long long value);
+
+        /**
+         * Appends an integer in decimal.
+         * @param value The integer to append.
+         * @return A reference to this writer.
+         */
+        BufferedWriter& append(unsigned int value);
+
+        /**
+         * Appends an integer in decimal.
+         * @param value The integer to append.
+         * @return A reference to this writer.
+         */
+        BufferedWriter& append(unsigned long value);
+
+        /**
+         * Appends an integer in decimal.
+         * @param value The integer to append.
+         * @return A reference to this writer.
+         */
+        BufferedWriter& append(unsigned long long value);
+
+        /**
+         * Appends a floating point number with a fixed number of decimal places, as
+         * printf's %.Nf would. Halfway cases may round differently from printf in
+         * the last place. Values too large for the fast path use printf.
+         * @param value The number to append.
+         * @param precision The number of decimal places, from 0 to 9.
+         * @return A reference to this writer.
+         */
+        BufferedWriter& append(double value, int32 precision = 6);
+
+        /**
+         * Appends a string and a newline.
+         * @param line The line to append.
+         * @return A reference to this writer.
+         */
+        BufferedWriter& appendLine(const std::string& line);
+
+        /**
+         * Appends a newline, which ends the line for FlushPolicy::EveryLine.
+         * @return A reference to this writer.
+         */
+        BufferedWriter& newline();
+
+        /**
+         * Writes the buffer to the file and flushes the file stream.
+         * @param sync Whether to wait until the data has reached the storage device.
+         * @throw Exception if the write fails.
+         */
+        void flush(bool sync = false);
+
+        /**
+         * Gets the number of bytes waiting in the buffer.
+         * @return The number of bytes.
+         */
+        size_t buffered() const {
+            return static_cast<size_t>(position_ - buffer_.data());
+        }
+
+        /**
+         * Gets the file being written.
+         * @return The file.
+         */
+        File& file() {
+            return *file_;
+        }
+
+    private:
+
+        /**
+         * Appends bytes that do not fit in the rest of the buffer.
+         */
+        BufferedWriter& appendSlow(const char* data, size_t size);
+
+        /**
+         * Writes the buffer to the file.
+         */
+        void flushBuffer();
+
+        std::unique_ptr<File> ownedFile_;
+
+        File* file_;
+
+        std::vector<char> buffer_;
+
+        char* position_;
+
+        char* end_;
+
+        FlushPolicy policy_;
+
+    };
+
+}
+
+#endif /* _OBLIVION_CORE_BUFFERED_WRITER_H_ */
@@ -0,0 +1,251 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#ifndef _OBLIVION_CORE_CBOR_H_
+#define _OBLIVION_CORE_CBOR_H_
+
+#include <string>
+#include <vector>
+
+#include <oblivion/core/base.h>
+#include <oblivion/core/non_copyable.h>
+#include <oblivion/core/types.h>
+
+namespace oblivion {
+
+    class File;
+    class Variant;
+
+    /**
+     * Streaming CBOR (RFC 8949) encoder that writes to a string buffer or a file.
+     */
+    class OB_CORE_API CborWriter : NonCopyable {
+
+    public:
+
+        /**
+         * Constructs a writer that appends to a string buffer.
+         * @param buffer The buffer to append to.
+         */
+        explicit CborWriter(std::string& buffer);
+
+        /**
+         * Constructs a writer that writes to a file through an internal buffer.
+         * @param file The file to write to.
+         */
+        explicit CborWriter(File& file);
+
+        /**
+         * Flushes any buffered output to the file.
+         */
+        ~CborWriter();
+
+        /**
+         * Writes a null value.
+         */
+        void writeNull();
+
+        /**
+         * Writes a boolean value.
+         * @param value The value to write.
+         */
+        void writeBool(bool value);
+
+        /**
+         * Writes an integer value.
+         * @param value The value to write.
+         */
+        void writeInt(int64 value);
+
+        /**
+         * Writes a real value. Values that are exact in single precision are
+         * written as 32-bit floats, everything else as 64-bit floats.
+         * @param value The value to write.
+         */
+        void writeReal(real64 value);
+
+        /**
+         * Writes a text string.
+         * @param data The UTF-8 string data.
+         * @param size The number of bytes in the string.
+         */
+        void writeString(const char* data, size_t size);
+
+        /**
+         * Writes a text string.
+         * @param value The UTF-8 string.
+         */
+        void writeString(const std::string& value);
+
+        /**
+         * Starts an indefinite-length array. It must be closed with end().
+         */
+        void beginArray();
+
+        /**
+         * Starts an array with a known number of elements.
+         * @param size The number of elements that will follow.
+         */
+        void beginArray(uint64 size);
+
+        /**
+         * Starts an indefinite-length map. It must be closed with end().
+         */
+        void beginMap();
+
+        /**
+         * Starts a map with a known number of entries.
+         * @param size The number of key/value pairs that will follow.
+         */
+        void beginMap(uint64 size);
+
+        /**
+         * Closes the innermost indefinite-length array or map.
+         */
+        void end();
+
+        /**
+         * Writes a variant and all of its children.
+         * @param variant The variant to write.
+         */
+        void write(const Variant& variant);
+
+        /**
+         * Writes any buffered output to the file.
+         * @throw Exception if the write operation fails.
+         */
+        void flush();
+
+    private:
+
+        void writeHead(uint8 majorType, uint64 value);
+
+        void append(const void* data, size_t size);
+
+        std::string* buffer_;
+
+        File* file_;
+
+        std::string pending_;
+
+    };
+
+    /**
+     * The kinds of items produced by CborReader.
+     */
+    enum class CborToken {
+        Null,
+        Bool,
+        Integer,
+        Real,
+        String,
+        ArrayBegin,
+        MapBegin,
+        End,
+        EndOfInput
+    };
+
+    /**
+     * Pull parser for CBOR (RFC 8949) data held in memory. Definite-length
+     * strings are returned as pointers into the input without copying.
+     */
+    class OB_CORE_API CborReader : NonCopyable {
+
+    public:
+
+        /**
+         * Constructs a reader over a buffer. The buffer must outlive the reader.
+         * @param data The CBOR data.
+         * @param size The number of bytes of data.
+         */
+        CborReader(const void* data, size_t size);
+
+        /**
+         * Reads the next item. Each ArrayBegin and MapBegin is matched by an End,
+         * for both definite and indefinite-length containers. Tags are skipped.
+         * @return The kind of item read.
+         * @throw Exception if the data is malformed or truncated.
+         */
+        CborToken next();
+
+        /**
+         * Gets the value of the last Bool item.
+         * @return The boolean value.
+         */
+        bool boolValue() const;
+
+        /**
+         * Gets the value of the last Integer item.
+         * @return The integer value.
+         */
+        int64 intValue() const;
+
+        /**
+         * Gets the value of the last Real item.
+         * @return The real value.
+         */
+        real64 realValue() const;
+
+        /**
+         * Gets the data of the last String item. This points into the input
+         * unless the string was sent in chunks.
+         * @return The string data, which is not null terminated.
+         */
+        const char* stringData() const;
+
+        /**
+         * Gets the number of bytes in the last String item.
+         * @return The string size.
+         */
+        size_t stringSize() const;
+
+        /**
+         * Gets the number of elements (or key/value pairs) in the last ArrayBegin
+         * or MapBegin item.
+         * @return The size, or -1 for indefinite-length containers.
+         */
+        int64 containerSize() const;
+
+        /**
+         * Gets the number of bytes consumed so far.
+         * @return The read position.
+         */
+        size_t position() const;
+
+    private:
+
+        uint8 readByte();
+
+        uint64 readArgument(uint8 info);
+
+        const uint8* readBytes(size_t size);
+
+        void readChunkedString(uint8 majorType);
+
+        const uint8* data_;
+
+        size_t size_;
+
+        size_t position_;
+
+        /**
+         * Remaining items of each open container, or -1 if indefinite.
+         */
+        std::vector<int64> remaining_;
+
+        bool bool_;
+
+        int64 int_;
+
+        real64 real_;
+
+        const char* string_;
+
+        size_t stringSize_;
+
+        std::string chunks_;
+
+    };
+
+}
+
+#endif /* _OBLIVION_CORE_CBOR_H_ */
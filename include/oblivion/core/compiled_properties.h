@@ -0,0 +1,151 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#ifndef _OBLIVION_CORE_COMPILED_PROPERTIES_H_
+#define _OBLIVION_CORE_COMPILED_PROPERTIES_H_
+
+#include <cstddef>
+#include <string>
+
+#include <oblivion/core/base.h>
+#include <oblivion/core/mapped_file.h>
+#include <oblivion/core/non_copyable.h>
+#include <oblivion/core/properties.h>
+#include <oblivion/core/types.h>
+
+namespace oblivion {
+
+    /**
+     * A read-only set of properties loaded from a precompiled binary file.
+     * The file holds a table of entries sorted by name, a minimal perfect hash
+     * over the names and one blob of NUL-terminated strings. It is mapped into
+     * memory as is, so opening it costs no parsing and no per-entry allocation,
+     * and a lookup hashes the name once and compares it once.
+     *
+     * Files are written in the byte order of the machine that compiles them and
+     * are rejected on a machine with a different byte order.
+     */
+    class OB_CORE_API CompiledProperties : NonCopyable {
+
+    public:
+
+        /**
+         * Maps a compiled properties file.
+         * @param path The path to the file.
+         * @throw Exception if the file cannot be mapped or is not a valid compiled properties file.
+         */
+        explicit CompiledProperties(const std::string& path);
+
+        /**
+         * Compiles a set of properties into a file. The file is written under a
+         * temporary name and renamed over the path, so instances that have it
+         * mapped keep reading the old contents until they are reopened.
+         * @param properties The properties to compile.
+         * @param path The path to the file to write.
+         * @throw Exception if the file cannot be written.
+         */
+        static void compile(const Properties& properties, const std::string& path);
+
+        /**
+         * Finds the value of a property.
+         * @param name The name of the property.
+         * @param size The number of bytes in the name.
+         * @return A pointer to the NUL-terminated value inside the mapping, or nullptr
+         *         if the property doesn't exist. The pointer is valid for the lifetime
+         *         of this object.
+         */
+        const char* find(const char* name, size_t size) const;
+
+        /**
+         * Finds the value of a property.
+         * @param name The name of the property.
+         * @return A pointer to the NUL-terminated value inside the mapping, or nullptr
+         *         if the property doesn't exist.
+         */
+        const char* find(const std::string& name) const;
+
+        /**
+         * Gets whether or not a property exists.
+         * @param name The name of the property.
+         * @return True if the property exists, false otherwise.
+         */
+        bool contains(const std::string& name) const;
+
+        /**
+         * Gets the value of a property.
+         * @param name The name of the property to get.
+         * @return The value of the property if one exists, or the empty string otherwise.
+         */
+        std::string getProperty(const std::string& name) const;
+
+        /**
+         * Gets the value of a property, converting from a string representation.
+         * @param name The value of the property to get.
+         * @param defaultValue the value to return if the property doesn't exist.
+         * @return The value of the property if one exists, or defaultValue otherwise.
+         */
+        template <typename T>
+        T get(const std::string& name, const T& defaultValue = T()) const;
+
+        /**
+         * Gets the number of properties.
+         * @return The number of properties.
+         */
+        int32 size() const;
+
+        /**
+         * Gets the name of a property by its position in name order.
+         * @param index The position, from 0 to size() - 1.
+         * @return The NUL-terminated name.
+         */
+        const char* name(int32 index) const;
+
+        /**
+         * Gets the value of a property by its position in name order.
+         * @param index The position, from 0 to size() - 1.
+         * @return The NUL-terminated value.
+         */
+        const char* value(int32 index) const;
+
+        /**
+         * Copies the properties into a modifiable collection.
+         * @return The properties.
+         */
+        Properties toProperties() const;
+
+    private:
+
+        /**
+         * Validates the mapped file and locates its tables.
+         * @throw Exception if the file is not a valid compiled properties file.
+         */
+        void attach();
+
+        MappedFile file_;
+
+        /**
+         * The fixed-size header at the start of the file.
+         */
+        struct Header;
+
+        /**
+         * The location of a name and value in the string blob.
+         */
+        struct Entry;
+
+        const Header* header_;
+
+        const uint32* displacements_;
+
+        const uint32* slots_;
+
+        const Entry* entries_;
+
+        const char* strings_;
+
+    };
+
+}
+
+#include <oblivion/core/compiled_properties_inl.h>
+
+#endif /* _OBLIVION_CORE_COMPILED_PROPERTIES_H_ */
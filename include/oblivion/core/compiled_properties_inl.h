@@ -0,0 +1,22 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#ifndef _OBLIVION_CORE_COMPILED_PROPERTIES_INL_H_
+#define _OBLIVION_CORE_COMPILED_PROPERTIES_INL_H_
+
+#include <oblivion/core/string_util.h>
+
+namespace oblivion {
+
+/*****************************************************************************/
+
+template <typename T>
+T CompiledProperties::get(const std::string& name, const T& defaultValue) const {
+    auto value = find(name);
+    return value ? StringUtil::parse<T>(value) : defaultValue;
+}
+
+/*****************************************************************************/
+
+}
+
+#endif /* _OBLIVION_CORE_COMPILED_PROPERTIES_INL_H_ */
@@ -0,0 +1,61 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#ifndef _OBLIVION_CORE_COMPRESSED_FORMAT_H_
+#define _OBLIVION_CORE_COMPRESSED_FORMAT_H_
+
+#include <cstddef>
+
+#include <oblivion/core/base.h>
+#include <oblivion/core/types.h>
+
+namespace oblivion {
+
+    /**
+     * The layout of files written by CompressedWriter. All integers are little-endian.
+     *
+     * - A header: the magic number, the version and the block size (16 bytes).
+     * - The blocks. Each has an 8-byte header holding its stored size and its
+     *   uncompressed size, followed by the stored bytes. A block is an LZ4 block
+     *   unless STORED_FLAG is set in its stored size, in which case it is kept as
+     *   is because it did not compress.
+     * - The index, one entry per block: the file offset of the block header,
+     *   the stored size with its flag and the uncompressed size (16 bytes each).
+     * - A footer: the index offset, the number of blocks, the total uncompressed
+     *   size, 4 reserved bytes and the magic number again (32 bytes).
+     *
+     * The footer lets a reader find any uncompressed offset by searching the
+     * index and decompressing one block. The per-block headers let a damaged
+     * file without a footer be recovered by scanning.
+     */
+    struct OB_CORE_API CompressedFormat {
+
+        /**
+         * "OBCZ" as a little-endian integer.
+         */
+        static const uint32 MAGIC = 0x5a43424f;
+
+        static const uint32 VERSION = 1;
+
+        static const size_t HEADER_SIZE = 16;
+
+        static const size_t BLOCK_HEADER_SIZE = 8;
+
+        static const size_t INDEX_ENTRY_SIZE = 16;
+
+        static const size_t FOOTER_SIZE = 32;
+
+        /**
+         * Marks a block that is stored uncompressed.
+         */
+        static const uint32 STORED_FLAG = 0x80000000u;
+
+        /**
+         * The largest block size, which keeps sizes clear of STORED_FLAG.
+         */
+        static const size_t MAX_BLOCK_SIZE = 64 << 20;
+
+    };
+
+}
+
+#endif /* _OBLIVION_CORE_COMPRESSED_FORMAT_H_ */
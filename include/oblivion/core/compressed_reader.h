@@ -0,0 +1,146 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#ifndef _OBLIVION_CORE_COMPRESSED_READER_H_
+#define _OBLIVION_CORE_COMPRESSED_READER_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <oblivion/core/base.h>
+#include <oblivion/core/file.h>
+#include <oblivion/core/non_copyable.h>
+#include <oblivion/core/types.h>
+
+namespace oblivion {
+
+    /**
+     * Reads a file written by CompressedWriter as if it were uncompressed. The
+     * index is loaded when the file is opened, so a read at any offset
+     * decompresses only the blocks it touches. The last block used is kept
+     * decompressed, which makes small sequential reads cheap. The reader is not
+     * thread-safe; open one per thread for parallel reads.
+     */
+    class OB_CORE_API CompressedReader : NonCopyable {
+
+    public:
+
+        /**
+         * Opens a compressed file and loads its index.
+         * @param path The path to the file.
+         * @throw Exception if the file cannot be opened or is not a complete compressed file.
+         */
+        explicit CompressedReader(const std::string& path);
+
+        /**
+         * Reads from the current position and advances it.
+         * @param size The number of bytes to read.
+         * @param out The buffer to read into.
+         * @return The number of bytes read, less than size only at the end of the data.
+         * @throw Exception if reading fails or the file is corrupt.
+         */
+        size_t read(size_t size, void* out);
+
+        /**
+         * Reads from an uncompressed offset without moving the current position.
+         * @param offset The uncompressed offset to read from.
+         * @param size The number of bytes to read.
+         * @param out The buffer to read into.
+         * @return The number of bytes read, less than size only at the end of the data.
+         * @throw Exception if reading fails or the file is corrupt.
+         */
+        size_t readAt(uint64 offset, size_t size, void* out);
+
+        /**
+         * Reads all of the uncompressed data.
+         * @return The data.
+         * @throw Exception if reading fails or the file is corrupt.
+         */
+        std::string readAll();
+
+        /**
+         * Moves the current position.
+         * @param offset The uncompressed offset, which may be past the end.
+         */
+        void seek(uint64 offset);
+
+        /**
+         * Gets the current position.
+         * @return The uncompressed offset.
+         */
+        uint64 position() const {
+            return position_;
+        }
+
+        /**
+         * Gets the size of the uncompressed data.
+         * @return The size in bytes.
+         */
+        uint64 size() const {
+            return size_;
+        }
+
+        /**
+         * Gets the number of blocks in the file.
+         * @return The number of blocks.
+         */
+        size_t blockCount() const {
+            return blocks_.size();
+        }
+
+    private:
+
+        /**
+         * A block from the index.
+         */
+        struct Block {
+
+            uint64 offset;
+
+            uint64 rawOffset;
+
+            uint32 storedSize;
+
+            uint32 rawSize;
+
+            bool stored;
+
+        };
+
+        /**
+         * Reads a block and decompresses it into a buffer of at least its raw size.
+         */
+        void decompress(size_t index, char* out);
+
+        /**
+         * Gets a block's data through the cache.
+         */
+        const char* load(size_t index);
+
+        std::string path_;
+
+        File file_;
+
+        std::vector<Block> blocks_;
+
+        uint64 size_;
+
+        uint64 position_;
+
+        /**
+         * The stored bytes of the block being read.
+         */
+        std::vector<char> packed_;
+
+        /**
+         * The last block decompressed through load, and its index.
+         */
+        std::vector<char> cache_;
+
+        size_t cached_;
+
+    };
+
+}
+
+#endif /* _OBLIVION_CORE_COMPRESSED_READER_H_ */
@@ -0,0 +1,212 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#ifndef _OBLIVION_CORE_COMPRESSED_WRITER_H_
+#define _OBLIVION_CORE_COMPRESSED_WRITER_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <oblivion/core/base.h>
+#include <oblivion/core/file.h>
+#include <oblivion/core/non_copyable.h>
+#include <oblivion/core/types.h>
+
+namespace oblivion {
+
+    /**
+     * Writes a compressed file in the seekable block format described by
+     * CompressedFormat, so data is compressed on its way to the disk instead of
+     * being written once and compressed again by another tool.
+     *
+     * Written bytes are cut into blocks of a fixed size, and full blocks are
+     * compressed with LZ4 on a pool of threads while the caller goes on writing.
+     * Blocks are written to the file in order as they finish. The index and
+     * footer are written by close; a file that was not closed cannot be opened
+     * by CompressedReader. The writer is not thread-safe.
+     */
+    class OB_CORE_API CompressedWriter : NonCopyable {
+
+    public:
+
+        /**
+         * Settings for a writer.
+         */
+        struct OB_CORE_API Options {
+
+            /**
+             * Sets the defaults: 1 MiB blocks and one compression thread per core.
+             */
+            Options();
+
+            /**
+             * The number of uncompressed bytes per block, from 4 KiB to
+             * CompressedFormat::MAX_BLOCK_SIZE. Larger blocks compress a little
+             * better; smaller ones make random reads cheaper.
+             */
+            size_t blockSize;
+
+            /**
+             * The number of compression threads, or 0 to use one per core.
+             */
+            int32 threadCount;
+
+        };
+
+        /**
+         * Creates a compressed file.
+         * @param path The path to the file, which is replaced if it exists.
+         * @param options The settings.
+         * @throw Exception if the options are invalid or the file cannot be created.
+         */
+        explicit CompressedWriter(const std::string& path, const Options& options = Options());
+
+        /**
+         * Closes the file if close has not been called. Errors are ignored; call
+         * close to see them.
+         */
+        ~CompressedWriter();
+
+        /**
+         * Appends bytes.
+         * @param data The bytes to append.
+         * @param size The number of bytes.
+         * @throw Exception if the writer is closed or writing to the file fails.
+         */
+        void write(const void* data, size_t size);
+
+        /**
+         * Appends a string.
+         * @param text The string to append.
+         * @throw Exception if the writer is closed or writing to the file fails.
+         */
+        void write(const std::string& text);
+
+        /**
+         * Compresses and writes the remaining data, then writes the index and
+         * footer and closes the file. Does nothing if already closed.
+         * @param sync Whether to wait until the file has reached the storage device.
+         * @throw Exception if writing to the file fails.
+         */
+        void close(bool sync = false);
+
+        /**
+         * Gets the number of uncompressed bytes written so far.
+         * @return The number of bytes.
+         */
+        uint64 size() const {
+            return size_;
+        }
+
+    private:
+
+        /**
+         * A block on its way through the compression threads.
+         */
+        struct Block {
+
+            std::string raw;
+
+            std::string packed;
+
+            bool stored;
+
+            bool done;
+
+        };
+
+        /**
+         * Where a written block is, for the index.
+         */
+        struct IndexEntry {
+
+            uint64 offset;
+
+            uint32 storedSize;
+
+            uint32 rawSize;
+
+        };
+
+        /**
+         * The body of a compression thread.
+         */
+        void run();
+
+        /**
+         * Hands the current block to the compression threads.
+         */
+        void submit();
+
+        /**
+         * Writes finished blocks in order, waiting until at most a number are in flight.
+         */
+        void drain(size_t limit);
+
+        /**
+         * Writes a block and records it in the index.
+         */
+        void writeBlock(const Block& block);
+
+        /**
+         * Stops and joins the compression threads.
+         */
+        void stop();
+
+        std::string path_;
+
+        std::unique_ptr<File> file_;
+
+        size_t blockSize_;
+
+        /**
+         * The block being filled by write.
+         */
+        std::unique_ptr<Block> current_;
+
+        /**
+         * Blocks submitted but not yet written, in file order. Only the
+         * calling thread touches the deque; the mutex guards each block's
+         * done flag and the queue.
+         */
+        std::deque<std::unique_ptr<Block>> inFlight_;
+
+        /**
+         * Written blocks kept so their buffers are reused.
+         */
+        std::vector<std::unique_ptr<Block>> spare_;
+
+        std::mutex mutex_;
+
+        /**
+         * Wakes compression threads when blocks are queued.
+         */
+        std::condition_variable work_;
+
+        /**
+         * Wakes the caller when a block is compressed.
+         */
+        std::condition_variable done_;
+
+        std::deque<Block*> queue_;
+
+        bool stopping_;
+
+        std::vector<std::thread> threads_;
+
+        std::vector<IndexEntry> index_;
+
+        uint64 offset_;
+
+        uint64 size_;
+
+    };
+
+}
+
+#endif /* _OBLIVION_CORE_COMPRESSED_WRITER_H_ */
@@ -0,0 +1,193 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#ifndef _OBLIVION_CORE_DIRECT_FILE_H_
+#define _OBLIVION_CORE_DIRECT_FILE_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include <oblivion/core/aligned_buffer_pool.h>
+#include <oblivion/core/base.h>
+#include <oblivion/core/non_copyable.h>
+#include <oblivion/core/types.h>
+
+namespace oblivion {
+
+    /**
+     * How a direct file is opened.
+     */
+    enum class DirectMode {
+
+        /**
+         * Opens an existing file for reading.
+         */
+        Read,
+
+        /**
+         * Opens an existing file for reading and writing.
+         */
+        ReadWrite,
+
+        /**
+         * Creates a file for reading and writing, truncating it if it exists.
+         */
+        Create
+
+    };
+
+    /**
+     * A file opened for direct I/O, which moves data between the caller's memory
+     * and the storage device without going through the page cache (O_DIRECT,
+     * F_NOCACHE on OS X, FILE_FLAG_NO_BUFFERING on windows). Large scans then
+     * do not evict data that other readers need cached.
+     *
+     * The device only transfers whole blocks into aligned memory. Requests whose
+     * offset, size and address are multiples of ALIGNMENT go straight to the
+     * device; any others are widened to whole blocks through pooled bounce
+     * buffers, so callers that can align their requests should, for example
+     * with an AlignedBufferPool. Unaligned writes read back the partial blocks at
+     * either end, so concurrent writes must not share a block.
+     *
+     * File systems without direct I/O, such as tmpfs, are opened through the
+     * page cache instead. @see DirectFile::direct
+     *
+     * I/O on a file that has been moved from throws.
+     */
+    class OB_CORE_API DirectFile : NonCopyable {
+
+    public:
+
+        /**
+         * The alignment of offsets, sizes and addresses for requests that need
+         * no bounce buffer. It is a multiple of the logical block size of every
+         * common storage device.
+         */
+        static const size_t ALIGNMENT = AlignedBuffer::DEFAULT_ALIGNMENT;
+
+        /**
+         * The size of the bounce buffers used for unaligned requests.
+         */
+        static const size_t BOUNCE_SIZE = 1 << 20;
+
+        /**
+         * Opens a file for direct I/O.
+         * @param path The path to the file.
+         * @param mode How to open the file.
+         * @throw Exception if the file cannot be opened.
+         */
+        DirectFile(const std::string& path, DirectMode mode);
+
+        /**
+         * Move constructs a file.
+         * @param other The file to move.
+         */
+        DirectFile(DirectFile&& other);
+
+        /**
+         * Closes the file.
+         */
+        ~DirectFile();
+
+        /**
+         * Move assignment.
+         * @param other The file to move.
+         * @return A reference to this file.
+         */
+        DirectFile& operator =(DirectFile&& other);
+
+        /**
+         * Reads from an offset. Safe to call from several threads at once.
+         * @param offset The file offset to read from.
+         * @param size The number of bytes to read.
+         * @param out The buffer to read into.
+         * @return The number of bytes read, less than size only at the end of the file.
+         * @throw Exception if the read fails.
+         */
+        size_t readAt(uint64 offset, size_t size, void* out);
+
+        /**
+         * Writes at an offset, growing the file if the write ends past it.
+         * @param offset The file offset to write at.
+         * @param size The number of bytes to write.
+         * @param data The data to write.
+         * @throw Exception if the file is read-only or the write fails.
+         */
+        void writeAt(uint64 offset, size_t size, const void* data);
+
+        /**
+         * Waits until written data has reached the storage device. Direct writes
+         * skip the page cache but may still sit in the device's own cache, and
+         * metadata such as the file size is only durable after a sync.
+         * @param dataOnly Whether to skip metadata that is not needed to read the data back.
+         * @throw Exception if the operation fails.
+         */
+        void sync(bool dataOnly = false);
+
+        /**
+         * Gets the size of the file.
+         * @return The size in bytes.
+         * @throw Exception if the size cannot be read.
+         */
+        uint64 size() const;
+
+        /**
+         * Changes the size of the file.
+         * @param size The new size in bytes.
+         * @throw Exception if the file is read-only or cannot be resized.
+         */
+        void truncate(uint64 size);
+
+        /**
+         * Gets whether the page cache is bypassed. False when the file system
+         * refused direct I/O and the file was opened normally.
+         * @return True if I/O is direct.
+         */
+        bool direct() const;
+
+        /**
+         * Gets the path that the file was opened from.
+         * @return The path.
+         */
+        const std::string& path() const;
+
+    private:
+
+        /**
+         * Reads until size bytes or the end of the file. The request is aligned
+         * unless the file is not direct.
+         */
+        size_t readFully(uint64 offset, size_t size, void* out);
+
+        /**
+         * Writes all of an aligned request.
+         */
+        void writeFully(uint64 offset, size_t size, const void* data);
+
+        /**
+         * Gets whether a request can go to the device without a bounce buffer.
+         */
+        bool aligned(uint64 offset, size_t size, const void* data) const;
+
+        struct Impl;
+
+        /**
+         * Gets the implementation.
+         * @return The implementation.
+         * @throw Exception if this file has been moved from.
+         */
+        Impl& impl() const;
+
+        std::unique_ptr<Impl> impl_;
+
+        /**
+         * Bounce buffers, kept apart from the platform state so the alignment
+         * handling is shared.
+         */
+        std::unique_ptr<AlignedBufferPool> bounce_;
+
+    };
+
+}
+
+#endif /* _OBLIVION_CORE_DIRECT_FILE_H_ */
@@ -7,7 +7,9 @@
 #include <string>
 
 #include <oblivion/core/base.h>
+#include <oblivion/core/io_buffer.h>
 #include <oblivion/core/non_copyable.h>
+#include <oblivion/core/types.h>
 
 namespace oblivion {
 
@@ -49,20 +51,38 @@ namespace oblivion {
          */
         void flush();
 
+        /**
+         * Flushes the file stream and waits until the operating system has written
+         * the data to the storage device.
+         * @param dataOnly Whether to skip metadata that is not needed to read the data back (@see fdatasync).
+         * @throw Exception if the operation fails.
+         */
+        void sync(bool dataOnly = false);
+
+        /**
+         * Reserves disk space for the start of the file without changing its size,
+         * so later writes cannot fail for lack of space and the file is not
+         * fragmented as it grows.
+         * @param size The number of bytes to reserve, counted from the start of the file.
+         * @return True if the space was reserved, false if the platform or file system cannot.
+         * @throw Exception if the space cannot be reserved.
+         */
+        bool allocate(uint64 size);
+
         /**
          * Seeks to a position in the file. (@see fseek).
          * @param offset The number of bytes to offset from origin.
          * @param origin Position used as a reference for the offset. Possible values are (SEEK_SET, SEEK_CUR or SEEK_END).
          * @throw Excception if the operation fails.
          */
-        void seek(long int offset, int origin);
+        void seek(int64 offset, int origin);
 
         /**
          * Gets the current position of the file.
          * @return The current file position.
          * @throw Exception if the operation fails.
          */
-        long int position();
+        int64 position();
 
         /**
          * Reads data from a file.
@@ -74,8 +94,32 @@ namespace oblivion {
         size_t read(size_t size, void* out);
 
         /**
-         * Reads a line of text from the file.
-         * @return The line of text.
+         * Reads data from a position in the file without using the stream position,
+         * so several threads can read different parts of one file at once. The
+         * stream buffer is bypassed: call flush first to see buffered writes.
+         * @param offset The file offset to read from.
+         * @param size The number of bytes to read.
+         * @param out The output parameter for the file data.
+         * @return The number of bytes read, which is less than size only at the end of the file.
+         * @throw Exception if the read operation fails.
+         */
+        size_t readAt(uint64 offset, size_t size, void* out);
+
+        /**
+         * Reads data from a position in the file into several buffers, filling each
+         * in turn. On posix this is a single preadv call. @see readAt
+         * @param offset The file offset to read from.
+         * @param buffers The buffers to fill.
+         * @param count The number of buffers.
+         * @return The total number of bytes read.
+         * @throw Exception if the read operation fails.
+         */
+        size_t readv(uint64 offset, const IoBuffer* buffers, size_t count);
+
+        /**
+         * Reads a line of text from the file, including the newline. LineReader
+         * reads lines faster and without copying them.
+         * @return The line of text, or the empty string at the end of the file.
          */
         std::string readLine();
 
@@ -87,6 +131,30 @@ namespace oblivion {
          */
         void write(size_t size, void* data);
 
+        /**
+         * Writes data at a position in the file without using the stream position.
+         * The stream buffer is bypassed: call flush first if it holds writes that
+         * this one must follow. On posix a file opened in append mode ("a" or "a+")
+         * ignores the offset and appends, as pwrite does with O_APPEND, so use
+         * this only on files opened without it.
+         * @param offset The file offset to write at.
+         * @param size The size of the data to write.
+         * @param data The data to write.
+         * @throw Exception if the write operation fails.
+         */
+        void writeAt(uint64 offset, size_t size, const void* data);
+
+        /**
+         * Writes several buffers one after another at a position in the file. On
+         * posix this is a single pwritev call, so a record header and its payload
+         * need no copy into one buffer. @see writeAt
+         * @param offset The file offset to write at.
+         * @param buffers The buffers to write.
+         * @param count The number of buffers.
+         * @throw Exception if the write operation fails.
+         */
+        void writev(uint64 offset, const IoBuffer* buffers, size_t count);
+
         /**
          * Writes formatted output to a file.
          * @param format The printf style format string.
@@ -94,24 +162,26 @@ namespace oblivion {
         void printf(const char* format, ...);
 
         /**
-         * Writes some text to the file.
+         * Writes some text to the file. For many small writes, @see BufferedWriter.
          * @param text The text to write.
+         * @throw Exception if the write operation fails.
          */
         void write(const std::string& text);
 
         /**
          * Writes a line of text to the file.
          * @param line The line to write.
+         * @throw Exception if the write operation fails.
          */
         void writeLine(const std::string& line);
 
         /**
-         * Gets the size of the specified file.
-         * @param out The output parameter for the file size.
+         * Gets the size of the file, including writes still buffered in the stream.
          * @return The file size.
          * @throw Exception if the operation fails.
          */
-        size_t size();
+        uint64 size();
+
         /**
          * Gets whether or not the file is currently at the end of input.
          * @return True if the file is at the end of input, false otherwise.
@@ -30,6 +30,38 @@ namespace oblivion {
          */
         static void remove(const std::string& path);
 
+        /**
+         * Renames a file, atomically replacing the destination if it exists. On
+         * posix systems the containing directory is synced so that the rename
+         * survives a crash.
+         * @param from The path to the file to rename.
+         * @param to The new path of the file.
+         * @throw Exception If the file cannot be renamed.
+         */
+        static void rename(const std::string& from, const std::string& to);
+
+        /**
+         * Copies a file, keeping its permissions. The copy is made inside the
+         * kernel where possible, so the data never passes through user space:
+         * on Linux a reflink that shares the source's blocks is tried first, then
+         * copy_file_range, then sendfile, then a read and write loop.
+         * @param from The path to the file to copy.
+         * @param to The path to the copy, which is replaced if it exists.
+         * @param sparse Whether to skip the holes in a sparse file so the copy is
+         *        sparse too. Ignored where the platform cannot find holes.
+         * @throw Exception if the file cannot be copied, or if both paths name
+         *        the same file, which is left untouched.
+         */
+        static void copy(const std::string& from, const std::string& to, bool sparse = false);
+
+        /**
+         * Waits until the operating system has written a directory's entries to the
+         * storage device, making files created in or renamed into it durable. Does
+         * nothing on platforms where directories cannot be synced.
+         * @param path The path to the directory.
+         */
+        static void syncDirectory(const std::string& path);
+
         /**
          * Gets whether or not the specified path is a directory.
          * @param path The path to check.
@@ -43,6 +75,41 @@ namespace oblivion {
          */
         static void createDirectory(const std::string& path);
 
+        /**
+         * Reads a whole file into memory with as few system calls as possible: the
+         * size comes from fstat, the kernel is told the file will be read
+         * sequentially, and the data is read straight into the result. Faster
+         * than File::size followed by File::read, which goes through stdio.
+         * @param path The path to the file.
+         * @return The contents of the file.
+         * @throw Exception if the file cannot be read.
+         */
+        static std::string readAll(const std::string& path);
+
+        /**
+         * Replaces the contents of a file. The file's space is reserved up front so
+         * it is allocated contiguously.
+         * @param path The path to the file.
+         * @param data The new contents.
+         * @param size The number of bytes in the new contents.
+         * @param sync Whether to wait until the data has reached the storage device.
+         * @param direct Whether to bypass the page cache (O_DIRECT), so writing a
+         *        large file does not evict data that is still in use. Ignored where
+         *        the platform or file system does not support it.
+         * @throw Exception if the file cannot be written.
+         */
+        static void writeAll(const std::string& path, const void* data, size_t size, bool sync,
+            bool direct = false);
+
+        /**
+         * Replaces the contents of a file. @see FileUtil::writeAll
+         * @param path The path to the file.
+         * @param contents The new contents.
+         * @param sync Whether to wait until the data has reached the storage device.
+         * @throw Exception if the file cannot be written.
+         */
+        static void writeAll(const std::string& path, const std::string& contents, bool sync = false);
+
         /**
          * Gets the file extension (including the .) for the specified file path.
          * @param path The path to the file.
@@ -0,0 +1,25 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#ifndef _OBLIVION_CORE_IO_BUFFER_H_
+#define _OBLIVION_CORE_IO_BUFFER_H_
+
+#include <cstddef>
+
+#include <oblivion/core/base.h>
+
+namespace oblivion {
+
+    /**
+     * A block of memory taking part in a scatter/gather or fixed-buffer operation.
+     */
+    struct OB_CORE_API IoBuffer {
+
+        void* data;
+
+        size_t size;
+
+    };
+
+}
+
+#endif /* _OBLIVION_CORE_IO_BUFFER_H_ */
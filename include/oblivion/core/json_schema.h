@@ -0,0 +1,70 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#ifndef _OBLIVION_CORE_JSON_SCHEMA_H_
+#define _OBLIVION_CORE_JSON_SCHEMA_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <oblivion/core/base.h>
+#include <oblivion/core/non_copyable.h>
+
+namespace oblivion {
+
+    class Variant;
+
+    /**
+     * A JSON Schema compiled into a validation program. The supported subset of
+     * draft 2020-12 is: type, enum, const, minimum, maximum, exclusiveMinimum,
+     * exclusiveMaximum, multipleOf, minLength, maxLength, pattern, properties,
+     * required, additionalProperties, minProperties, maxProperties, items,
+     * minItems, maxItems, uniqueItems, allOf, anyOf, oneOf, not and the boolean
+     * schemas true and false. Annotation keywords are ignored.
+     */
+    class OB_CORE_API JsonSchema : NonCopyable {
+
+    public:
+
+        /**
+         * Compiles a schema.
+         * @param schema The schema document.
+         * @throw Exception if the schema is invalid or uses an unsupported keyword.
+         */
+        explicit JsonSchema(const Variant& schema);
+
+        /**
+         * Cleanup.
+         */
+        ~JsonSchema();
+
+        /**
+         * Validates a value in a single pass, stopping at the first failure.
+         * @param value The value to validate.
+         * @return True if the value conforms to the schema, false otherwise.
+         */
+        bool validate(const Variant& value) const;
+
+        /**
+         * Validates a value in a single pass and collects every failure.
+         * @param value The value to validate.
+         * @param errors Output parameter that receives one message per failure,
+         *               prefixed with the JSON pointer of the failing value.
+         * @return True if the value conforms to the schema, false otherwise.
+         */
+        bool validate(const Variant& value, std::vector<std::string>& errors) const;
+
+        /**
+         * A compiled schema node.
+         */
+        struct Node;
+
+    private:
+
+        std::unique_ptr<Node> root_;
+
+    };
+
+}
+
+#endif /* _OBLIVION_CORE_JSON_SCHEMA_H_ */
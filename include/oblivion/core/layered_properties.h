@@ -0,0 +1,148 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#ifndef _OBLIVION_CORE_LAYERED_PROPERTIES_H_
+#define _OBLIVION_CORE_LAYERED_PROPERTIES_H_
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <oblivion/core/base.h>
+#include <oblivion/core/properties.h>
+#include <oblivion/core/types.h>
+
+namespace oblivion {
+
+    /**
+     * A stack of property layers that is read as one set of properties, for
+     * example defaults, then a file, then the environment. A lookup walks the
+     * layers from the top and stops at the first layer that has the name, so
+     * no layer is copied. Values set at runtime go into a layer of their own
+     * that sits above all the others.
+     */
+    class OB_CORE_API LayeredProperties {
+
+    public:
+
+        /**
+         * A shared, read-only layer.
+         */
+        typedef std::shared_ptr<const Properties> Layer;
+
+        /**
+         * Constructs a set of properties with only the runtime layer.
+         */
+        LayeredProperties();
+
+        /**
+         * Adds a layer above the existing layers and below the runtime layer.
+         * The layer is shared rather than copied.
+         * @param layer The layer to add.
+         */
+        void addLayer(Layer layer);
+
+        /**
+         * Adds a layer above the existing layers and below the runtime layer.
+         * @param layer The layer to add.
+         */
+        void addLayer(Properties layer);
+
+        /**
+         * Adds a layer holding the environment variables that start with a prefix.
+         * @see LayeredProperties::environment
+         * @param prefix The prefix of the variables to include.
+         */
+        void addEnvironmentLayer(const std::string& prefix);
+
+        /**
+         * Gets the number of layers, not counting the runtime layer.
+         * @return The number of layers.
+         */
+        int32 layerCount() const;
+
+        /**
+         * Gets a layer.
+         * @param index The index of the layer, where 0 is the bottom layer.
+         * @return The layer.
+         */
+        const Layer& layer(int32 index) const;
+
+        /**
+         * Sets the value of a property in the runtime layer.
+         * @param name The name of the property.
+         * @param value The value of the property.
+         */
+        void setProperty(const std::string& name, const std::string& value);
+
+        /**
+         * Sets the value of a property in the runtime layer to the string representation of a value.
+         * @param name The name of the property.
+         * @param value The value to set.
+         */
+        template <typename T>
+        void set(const std::string& name, const T& value);
+
+        /**
+         * Gets the value of a property from the topmost layer that has it.
+         * @param name The name of the property to get.
+         * @return The value of the property if one exists, or the empty string otherwise.
+         */
+        const std::string& getProperty(const std::string& name) const;
+
+        /**
+         * Gets the value of a property from the topmost layer that has it, converting
+         * from a string representation. The converted value is cached by that layer.
+         * @param name The value of the property to get.
+         * @param defaultValue the value to return if the property doesn't exist.
+         * @return The value of the property if one exists, or defaultValue otherwise.
+         */
+        template <typename T>
+        T get(const std::string& name, const T& defaultValue = T()) const;
+
+        /**
+         * Gets whether or not any layer contains a value for the specified property name.
+         * @param name The name of the property to look for.
+         * @return True if there is a property entry, false otherwise.
+         */
+        bool contains(const std::string& name) const;
+
+        /**
+         * Resolves every name through the layers into a single set of properties.
+         * Use this to take a compact snapshot when the number of layers makes
+         * lookups too slow.
+         * @return The resolved properties.
+         */
+        Properties flatten() const;
+
+        /**
+         * Reads the environment variables that start with a prefix into a set of
+         * properties. The prefix is removed, the rest of the name is lower cased,
+         * and each underscore becomes a dot, with a double underscore standing for
+         * a single underscore. With the prefix "APP_", APP_DB_PRIMARY_HOST becomes
+         * db.primary.host and APP_MAX__CONNECTIONS becomes max_connections.
+         * @param prefix The prefix of the variables to include.
+         * @return The properties.
+         */
+        static Properties environment(const std::string& prefix);
+
+    private:
+
+        /**
+         * Finds a property in the topmost layer that has it.
+         * @param name The name of the property.
+         * @param layer Output parameter that receives the layer holding the property.
+         * @return The entry, or nullptr if no layer has the property.
+         */
+        const Properties::Entry* find(const std::string& name, const Properties*& layer) const;
+
+        std::vector<Layer> layers_;
+
+        Properties runtime_;
+
+    };
+
+}
+
+#include <oblivion/core/layered_properties_inl.h>
+
+#endif /* _OBLIVION_CORE_LAYERED_PROPERTIES_H_ */
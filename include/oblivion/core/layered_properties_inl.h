@@ -0,0 +1,28 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#ifndef _OBLIVION_CORE_LAYERED_PROPERTIES_INL_H_
+#define _OBLIVION_CORE_LAYERED_PROPERTIES_INL_H_
+
+namespace oblivion {
+
+/*****************************************************************************/
+
+template <typename T>
+void LayeredProperties::set(const std::string& name, const T& value) {
+    runtime_.set(name, value);
+}
+
+/*****************************************************************************/
+
+template <typename T>
+T LayeredProperties::get(const std::string& name, const T& defaultValue) const {
+    const Properties* layer = nullptr;
+    auto entry = find(name, layer);
+    return entry ? layer->value<T>(*entry) : defaultValue;
+}
+
+/*****************************************************************************/
+
+}
+
+#endif /* _OBLIVION_CORE_LAYERED_PROPERTIES_INL_H_ */
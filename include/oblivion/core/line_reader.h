@@ -0,0 +1,120 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#ifndef _OBLIVION_CORE_LINE_READER_H_
+#define _OBLIVION_CORE_LINE_READER_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <oblivion/core/base.h>
+#include <oblivion/core/non_copyable.h>
+#include <oblivion/core/types.h>
+
+namespace oblivion {
+
+    class File;
+    class MappedFile;
+
+    /**
+     * Reads lines from a file or a block of memory without copying them. Each
+     * line is exposed as a pointer and a size into the reader's buffer or the
+     * source memory, without the line ending; both \n and \r\n are accepted.
+     * Lines have no length limit, and a final line without a line ending is
+     * returned while an empty last line after the final newline is not.
+     */
+    class OB_CORE_API LineReader : NonCopyable {
+
+    public:
+
+        /**
+         * The default number of bytes read from a file at a time.
+         */
+        static const size_t DEFAULT_BUFFER_SIZE = 1 << 20;
+
+        /**
+         * Reads lines from the current position of a file through an internal buffer,
+         * which grows if a line does not fit.
+         * @param file The file to read, which must outlive the reader.
+         * @param bufferSize The initial size of the buffer.
+         */
+        explicit LineReader(File& file, size_t bufferSize = DEFAULT_BUFFER_SIZE);
+
+        /**
+         * Reads lines directly from a mapped file.
+         * @param file The mapping to read, which must outlive the reader.
+         */
+        explicit LineReader(const MappedFile& file);
+
+        /**
+         * Reads lines directly from a block of memory.
+         * @param data The text to read, which must outlive the reader.
+         * @param size The number of bytes of text.
+         */
+        LineReader(const char* data, size_t size);
+
+        /**
+         * Advances to the next line.
+         * @return True if there is a line, false at the end of input.
+         * @throw Exception if reading from the file fails.
+         */
+        bool next();
+
+        /**
+         * Gets the first character of the current line. The line is not terminated,
+         * and the pointer is valid until the next call to next.
+         * @return The first character.
+         */
+        const char* data() const {
+            return line_;
+        }
+
+        /**
+         * Gets the number of characters in the current line, not counting the line ending.
+         * @return The number of characters.
+         */
+        size_t size() const {
+            return size_;
+        }
+
+        /**
+         * Copies the current line into a string.
+         * @return The line.
+         */
+        std::string str() const;
+
+        /**
+         * Gets the number of the current line, starting from 1.
+         * @return The line number, or 0 before the first call to next.
+         */
+        int64 lineNumber() const;
+
+    private:
+
+        /**
+         * Moves the unread bytes to the front of the buffer and reads more from the file.
+         * @return False if the file had no more bytes.
+         */
+        bool fill();
+
+        File* file_;
+
+        std::vector<char> buffer_;
+
+        const char* position_;
+
+        const char* end_;
+
+        const char* line_;
+
+        size_t size_;
+
+        int64 lineNumber_;
+
+        bool eof_;
+
+    };
+
+}
+
+#endif /* _OBLIVION_CORE_LINE_READER_H_ */
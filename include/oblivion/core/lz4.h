@@ -0,0 +1,55 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#ifndef _OBLIVION_CORE_LZ4_H_
+#define _OBLIVION_CORE_LZ4_H_
+
+#include <cstddef>
+
+#include <oblivion/core/base.h>
+
+namespace oblivion {
+
+    /**
+     * A compressor for the LZ4 block format: a fast byte-oriented LZ77 that
+     * trades ratio for speed, decompressing at memory bandwidth. Output can be
+     * read by other LZ4 block decoders and vice versa. Blocks carry no sizes or
+     * checksums; callers store the original size alongside.
+     */
+    class OB_CORE_API Lz4 {
+
+    public:
+
+        /**
+         * Gets the most bytes compressing a block can produce.
+         * @param size The size of the input.
+         * @return The size of the output buffer needed by compress.
+         */
+        static size_t compressBound(size_t size);
+
+        /**
+         * Compresses a block.
+         * @param data The bytes to compress.
+         * @param size The number of bytes, less than 2 GiB.
+         * @param out The buffer to compress into, of at least compressBound(size) bytes.
+         * @return The number of bytes written to out.
+         */
+        static size_t compress(const char* data, size_t size, char* out);
+
+        /**
+         * Decompresses a block. Malformed input is detected rather than read or
+         * written out of bounds.
+         * @param data The compressed bytes.
+         * @param size The number of compressed bytes.
+         * @param out The buffer to decompress into.
+         * @param capacity The size of out. Bytes of out past the decompressed data
+         *        may be overwritten.
+         * @return The number of decompressed bytes.
+         * @throw Exception if the input is malformed or does not fit in out.
+         */
+        static size_t decompress(const char* data, size_t size, char* out, size_t capacity);
+
+    };
+
+}
+
+#endif /* _OBLIVION_CORE_LZ4_H_ */
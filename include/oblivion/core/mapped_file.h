@@ -0,0 +1,202 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#ifndef _OBLIVION_CORE_MAPPED_FILE_H_
+#define _OBLIVION_CORE_MAPPED_FILE_H_
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+#include <oblivion/core/base.h>
+#include <oblivion/core/non_copyable.h>
+#include <oblivion/core/types.h>
+
+namespace oblivion {
+
+    /**
+     * The access a file is mapped with.
+     */
+    enum class MapMode {
+        ReadOnly,
+        ReadWrite
+    };
+
+    /**
+     * Hints about how a mapped range will be accessed. Hints that the platform
+     * does not support are ignored.
+     */
+    enum class MapAdvice {
+        Normal,
+        Sequential,
+        Random,
+        WillNeed,
+        DontNeed,
+        HugePage
+    };
+
+    /**
+     * RAII wrapper around a memory mapping of a file. The mapped bytes are the
+     * page cache itself, so reading them involves no copy. Read-write mappings
+     * are shared: stores go to the file.
+     *
+     * Mapping a range that extends past the end of the file grows the file to
+     * cover it when the mapping is read-write, and throws when it is read-only,
+     * on every platform. A mapping that has been moved from maps nothing: data
+     * is nullptr, size is 0, and the operations that need the file throw.
+     */
+    class OB_CORE_API MappedFile : NonCopyable {
+
+    public:
+
+        /**
+         * Maps a whole file.
+         * @param path The path to the file to map.
+         * @param mode The access to map the file with.
+         * @throw Exception if the file cannot be opened or mapped.
+         */
+        explicit MappedFile(const std::string& path, MapMode mode = MapMode::ReadOnly);
+
+        /**
+         * Maps a range of a file. The offset does not need to be page aligned.
+         * @param path The path to the file to map.
+         * @param mode The access to map the file with.
+         * @param offset The offset of the first byte to map.
+         * @param size The number of bytes to map.
+         * @throw Exception if the file cannot be opened or mapped.
+         */
+        MappedFile(const std::string& path, MapMode mode, uint64 offset, size_t size);
+
+        /**
+         * Move constructs a mapping.
+         * @param other The mapping to move.
+         */
+        MappedFile(MappedFile&& other);
+
+        /**
+         * Unmaps the file and closes it.
+         */
+        ~MappedFile();
+
+        /**
+         * Move assignment.
+         * @param other The mapping to move.
+         * @return A reference to this mapping.
+         */
+        MappedFile& operator =(MappedFile&& other);
+
+        /**
+         * Gets the first mapped byte.
+         * @return The first byte, or nullptr if nothing is mapped.
+         */
+        const char* data() const;
+
+        /**
+         * Gets the first mapped byte for writing.
+         * @return The first byte, or nullptr if nothing is mapped.
+         * @throw Exception if the file is mapped read-only.
+         */
+        char* mutableData();
+
+        /**
+         * Gets the number of mapped bytes.
+         * @return The number of bytes.
+         */
+        size_t size() const;
+
+        /**
+         * Gets whether or not nothing is mapped.
+         * @return True if no bytes are mapped, false otherwise.
+         */
+        bool empty() const;
+
+        /**
+         * Gets the first mapped byte, for iteration.
+         * @return The first byte.
+         */
+        const char* begin() const;
+
+        /**
+         * Gets one past the last mapped byte, for iteration.
+         * @return One past the last byte.
+         */
+        const char* end() const;
+
+        /**
+         * Gets a mapped byte.
+         * @param index The index of the byte, relative to the start of the mapping.
+         * @return The byte.
+         */
+        char operator [](size_t index) const;
+
+        /**
+         * Gets the offset in the file of the first mapped byte.
+         * @return The offset.
+         */
+        uint64 offset() const;
+
+        /**
+         * Gets the current size of the file, which may differ from the mapped size.
+         * @return The size of the file in bytes.
+         * @throw Exception if the size cannot be read.
+         */
+        uint64 fileSize() const;
+
+        /**
+         * Gets the path that the file was opened from.
+         * @return The path.
+         */
+        const std::string& path() const;
+
+        /**
+         * Gives the operating system a hint about how a range will be accessed.
+         * @param advice The hint.
+         * @param offset The offset of the range, relative to the start of the mapping.
+         * @param size The number of bytes in the range, or 0 for the rest of the mapping.
+         */
+        void advise(MapAdvice advice, size_t offset = 0, size_t size = 0);
+
+        /**
+         * Remaps the whole file, picking up any growth since it was mapped.
+         * @throw Exception if the file cannot be mapped.
+         */
+        void remap();
+
+        /**
+         * Remaps a different range of the file. Pointers into the old range are invalidated.
+         * @param offset The offset of the first byte to map.
+         * @param size The number of bytes to map.
+         * @throw Exception if the range cannot be mapped.
+         */
+        void remap(uint64 offset, size_t size);
+
+        /**
+         * Changes the size of the file and maps it whole.
+         * @param size The new size of the file in bytes.
+         * @throw Exception if the file is mapped read-only or cannot be resized.
+         */
+        void resize(uint64 size);
+
+        /**
+         * Writes modified pages back to the file and waits for them to reach the storage device.
+         * @throw Exception if the operation fails.
+         */
+        void sync();
+
+    private:
+
+        struct Impl;
+
+        /**
+         * Gets the implementation.
+         * @return The implementation.
+         * @throw Exception if this mapping has been moved from.
+         */
+        Impl& impl() const;
+
+        std::unique_ptr<Impl> impl_;
+
+    };
+
+}
+
+#endif /* _OBLIVION_CORE_MAPPED_FILE_H_ */
@@ -3,8 +3,15 @@
 #ifndef _OBLIVION_CORE_PROPERTIES_H_
 #define _OBLIVION_CORE_PROPERTIES_H_
 
+#include <atomic>
+#include <deque>
+#include <iterator>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include <oblivion/core/base.h>
 #include <oblivion/core/types.h>
@@ -12,10 +19,104 @@
 namespace oblivion {
 
     /**
-     * Storage for name/value pairs.
+     * A map of name/value pairs.
      */
     typedef std::unordered_map<std::string, std::string> PropertyMap;
 
+    /**
+     * A parsed value cached on a property entry.
+     */
+    struct PropertyValueCache {
+
+        virtual ~PropertyValueCache() { }
+
+        /**
+         * Identifies the cached type. @see propertyTypeId
+         */
+        const void* type;
+
+    };
+
+    /**
+     * A parsed value of type T cached on a property entry.
+     */
+    template <typename T>
+    struct TypedPropertyValueCache : PropertyValueCache {
+
+        T value;
+
+    };
+
+    /**
+     * Gets a unique identifier for a type, used to check the type of a cached value.
+     * @return The identifier.
+     */
+    template <typename T>
+    const void* propertyTypeId() {
+        static const char id = 0;
+        return &id;
+    }
+
+    class Properties;
+
+    /**
+     * A property name resolved once to a slot in a Properties collection.
+     * Reading through a handle is an indexed load with no hashing. The slot
+     * stays reserved for the name when the collection is cleared or reloaded,
+     * so the handle stays valid for as long as the collection exists.
+     *
+     * A handle is only a slot number. Reading it from a collection it was not
+     * resolved against, or copied from, is not detected and reads whichever
+     * property holds that slot there.
+     */
+    template <typename T>
+    class PropertyHandle {
+
+    public:
+
+        /**
+         * Constructs a handle that refers to no property.
+         */
+        PropertyHandle()
+            : properties_(nullptr),
+              slot_(-1) {
+        }
+
+        /**
+         * Constructs a handle.
+         * @param properties The collection the slot belongs to, or nullptr if the
+         *                   handle is read through Properties::get or SharedProperties::get.
+         * @param slot The slot of the property.
+         */
+        PropertyHandle(const Properties* properties, int32 slot)
+            : properties_(properties),
+              slot_(slot) {
+        }
+
+        /**
+         * Gets the value of the property from the collection the handle was resolved against.
+         * @param defaultValue the value to return if the property doesn't exist.
+         * @return The value of the property if one exists, or defaultValue otherwise.
+         * @throw Exception if the handle is not bound to a collection.
+         */
+        T get(const T& defaultValue = T()) const;
+
+        /**
+         * Gets the slot of the property.
+         * @return The slot, or -1 if the handle refers to no property.
+         */
+        int32 slot() const {
+            return slot_;
+        }
+
+    private:
+
+        const Properties* properties_;
+
+        int32 slot_;
+
+    };
+
     /**
      * The properties class encapsulates a set of string/value pairs
      * with support for reading and writing to files.
@@ -24,16 +125,38 @@ namespace oblivion {
 
     public:
 
+        /**
+         * A name/value pair.
+         */
+        typedef std::pair<const std::string, std::string> value_type;
+
         /**
          * Constant iterator type.
          */
-        typedef PropertyMap::const_iterator const_iterator;
+        class const_iterator;
+
+        /**
+         * A read-only view of the properties whose names start with a prefix.
+         */
+        class View;
 
         /** 
          * Constructs an empty set of properties.
          */
         Properties();
 
+        /**
+         * Copy constructor. Cached typed values are not copied.
+         * @param other The properties to copy.
+         */
+        Properties(const Properties& other);
+
+        /**
+         * Move constructor.
+         * @param other The properties to move.
+         */
+        Properties(Properties&& other);
+
         /**
          * Constructs a set of properties by loading from the specified path.
          * @param path The path to the file to load.
@@ -41,6 +164,20 @@ namespace oblivion {
          */
         explicit Properties(const std::string& path);
 
+        /**
+         * Copy assignment. Cached typed values are not copied.
+         * @param other The properties to copy.
+         * @return A reference to this.
+         */
+        Properties& operator =(const Properties& other);
+
+        /**
+         * Move assignment.
+         * @param other The properties to move.
+         * @return A reference to this.
+         */
+        Properties& operator =(Properties&& other);
+
         /**
          * Sets the value of the specified property.
          * @param name The name of the property.
@@ -57,7 +194,10 @@ namespace oblivion {
         void set(const std::string& name, const T& value);
 
         /**
-         * Gets the value of a property.
+         * Gets the value of a property. The reference stays valid until this
+         * collection is assigned to or destroyed. Like a raw value, an expanded
+         * value is updated in place: a reference held across a change sees the
+         * new expansion once the property has been read again.
          * @param name The name of the property to get.
          * @return The value of the property if one exists, or the empty string otherwise.
          */
@@ -65,6 +205,8 @@ namespace oblivion {
 
         /**
          * Gets the value of a property, converting from a string representation.
+         * The converted value is cached on the entry until the property is set
+         * again, so repeated reads of the same type cost a single hash lookup.
          * @param name The value of the property to get.
          * @param defaultValue the value to return if the property doesn't exist.
          * @return The value of the property if one exists, or defaultValue otherwise.
@@ -72,6 +214,53 @@ namespace oblivion {
         template <typename T>
         T get(const std::string& name, const T& defaultValue = T()) const;
 
+        /**
+         * Gets the value of a property through a handle, converting from a string
+         * representation. The handle must have been resolved against this collection
+         * or against the collection this one was copied from; other handles are not
+         * detected and read an unrelated property.
+         * @param handle The handle of the property to get.
+         * @param defaultValue the value to return if the property doesn't exist.
+         * @return The value of the property if one exists, or defaultValue otherwise.
+         */
+        template <typename T>
+        T get(const PropertyHandle<T>& handle, const T& defaultValue = T()) const;
+
+        /**
+         * Resolves a property name to a handle. The name does not need to exist
+         * yet; the handle reads the default value until the property is set.
+         * The handle stays valid across setProperty, load and clear, and is
+         * invalidated by assigning to or destroying this collection.
+         * @param name The name of the property.
+         * @return The handle.
+         */
+        template <typename T>
+        PropertyHandle<T> handle(const std::string& name);
+
+        /**
+         * Enables or disables interpolation. When enabled, getProperty, get and the
+         * handle and view lookups expand ${name} to the value of another property
+         * in this collection and ${env:NAME} to an environment variable. A missing
+         * reference expands to the empty string and $${ stands for a literal ${.
+         * Iteration always yields the raw values.
+         *
+         * Expanded values are computed on first read and cached. References are
+         * tracked when a value is set, so setting or reloading a property discards
+         * only the cached values that depend on it. Each property keeps one
+         * string for its expanded value, which later expansions overwrite, so
+         * references returned by getProperty stay valid without memory growing
+         * as values change. Environment variables are read when a value is
+         * first expanded.
+         * @param enabled Whether to expand references.
+         */
+        void setInterpolation(bool enabled);
+
+        /**
+         * Gets whether or not interpolation is enabled.
+         * @return True if references are expanded, false otherwise.
+         */
+        bool interpolation() const;
+
         /**
          * Gets whether or not this properties collection contains a value for the specified property name.
          * @param name The name of the property to look for.
@@ -80,11 +269,16 @@ namespace oblivion {
         bool contains(const std::string& name) const;
 
         /**
-         * Saves the set of properties to a file.
+         * Saves the set of properties to a file. The output is formatted into one
+         * buffer, written to path + ".tmp", synced to disk and renamed over the
+         * destination, so a crash leaves either the old file or the new one.
+         * Concurrent saves to the same path must be serialized by the caller.
          * @param path The path to the file to write.
+         * @param sorted Whether to write the properties in name order rather than
+         *               insertion order, for deterministic output.
          * @throw Exception if the properties file cannot be saved.
          */
-        void save(const std::string& path) const;
+        void save(const std::string& path, bool sorted = false) const;
 
         /**
          * Loads the set of properties from a file.
@@ -93,6 +287,17 @@ namespace oblivion {
          */
         void load(const std::string& path);
 
+        /**
+         * Gets a view of the properties whose names start with a prefix, for
+         * example "db.primary.". Finding the range is a binary search over a
+         * sorted index of the names, and no names or values are copied. Names
+         * added since the last view are sorted into the index first. The view
+         * is invalidated when a new name is added to this collection.
+         * @param prefix The prefix to match; the empty prefix matches every property.
+         * @return The view, which iterates in name order.
+         */
+        View view(const std::string& prefix) const;
+
         /**
          * Gets the first iterator to the property map.
          * @return The iterator.
@@ -118,13 +323,461 @@ namespace oblivion {
         bool empty() const;
 
         /**
-         * Removes all elements from this collection.
+         * Removes all elements from this collection. Slots of the removed names
+         * are kept so existing handles stay valid.
          */
         void clear();
 
     private:
 
-        PropertyMap properties_;
+        friend class LayeredProperties;
+
+        /**
+         * A property and its cached typed value.
+         */
+        struct Entry {
+
+            /**
+             * The dependency edges of an entry whose value references other properties,
+             * or that other values reference.
+             */
+            struct Links {
+
+                /**
+                 * The slots this entry's value references.
+                 */
+                std::vector<int32> references;
+
+                /**
+                 * The slots whose values reference this entry.
+                 */
+                std::vector<int32> dependents;
+
+            };
+
+            Entry(std::string name, std::string value);
+
+            Entry(const Entry& other);
+
+            ~Entry();
+
+            /**
+             * Discards the cached typed and expanded values. The storage of the
+             * expanded value is kept, since callers of getProperty may still
+             * refer to it, and the next expansion is written into it.
+             */
+            void invalidate();
+
+            value_type property;
+
+            /**
+             * Whether the property is set. A slot that is not present holds a name
+             * that was cleared or that a handle was resolved for before it was set.
+             */
+            bool present;
+
+            /**
+             * Whether the value contains ${ and needs expanding when interpolation is enabled.
+             */
+            bool templated;
+
+            std::unique_ptr<Links> links;
+
+            mutable std::atomic<PropertyValueCache*> cache;
+
+            /**
+             * The expanded value, pointing at storage, or nullptr if it has to be
+             * expanded again.
+             */
+            mutable std::atomic<std::string*> expanded;
+
+            /**
+             * The string that holds the expanded value, created on first
+             * expansion and reused by later ones.
+             */
+            mutable std::unique_ptr<std::string> storage;
+
+        private:
+
+            Entry& operator =(const Entry& other);
+
+        };
+
+        /**
+         * Hashes entry names through a pointer.
+         */
+        struct NameHash {
+            size_t operator ()(const std::string* name) const;
+        };
+
+        /**
+         * Compares entry names through a pointer.
+         */
+        struct NameEqual {
+            bool operator ()(const std::string* a, const std::string* b) const;
+        };
+
+        /**
+         * Index from name to position in entries_. Keys point at the names stored
+         * in the entries so each name is only stored once.
+         */
+        typedef std::unordered_map<const std::string*, int32, NameHash, NameEqual> EntryIndex;
+
+        /**
+         * Finds the entry for a name.
+         * @param name The name to look for.
+         * @return The entry, or nullptr if there is none.
+         */
+        const Entry* find(const std::string& name) const;
+
+        /**
+         * Gets the entry in a slot.
+         * @param slot The slot.
+         * @return The entry, or nullptr if the slot is out of range or not present.
+         */
+        const Entry* at(int32 slot) const;
+
+        /**
+         * Gets the slot for a name, creating an empty slot if necessary. A new
+         * slot is appended to sorted_ without sorting it. @see sort
+         * @param name The name of the property.
+         * @return The slot.
+         */
+        int32 resolve(const std::string& name);
+
+        /**
+         * Gets the value of an entry, expanded if interpolation is enabled.
+         * @param entry The entry.
+         * @return The value.
+         */
+        const std::string& text(const Entry& entry) const;
+
+        /**
+         * Expands the references in the value of an entry, using and filling the
+         * expanded value cache.
+         * @param entry The entry.
+         * @param depth The number of references followed to reach this entry.
+         * @return The expanded value.
+         * @throw Exception if the references are circular.
+         */
+        const std::string& expand(const Entry& entry, int32 depth) const;
+
+        /**
+         * Records the references in the value of an entry, replacing its old ones.
+         * @param slot The slot of the entry.
+         */
+        void link(int32 slot);
+
+        /**
+         * Discards the cached values of an entry and of every entry that depends on it.
+         * @param slot The slot of the entry.
+         */
+        void changed(int32 slot);
+
+        /**
+         * Converts the value of an entry, using and filling the typed value cache.
+         * @param entry The entry.
+         * @return The converted value.
+         */
+        template <typename T>
+        T value(const Entry& entry) const;
+
+        /**
+         * Sets the value of an entry, creating the entry if necessary.
+         * @param name The name of the property.
+         * @param valueBegin The start of the value.
+         * @param valueEnd The end of the value.
+         */
+        void put(std::string name, const char* valueBegin, const char* valueEnd);
+
+        /**
+         * Rebuilds index_ from entries_.
+         */
+        void reindex();
+
+        /**
+         * Sorts the slots appended to sorted_ since the last ordered access and
+         * merges them into the sorted prefix. New names are only appended, so a
+         * collection built one name at a time is sorted once, when it is first
+         * read in name order. Readers of a shared const instance may call this
+         * concurrently.
+         */
+        void sort() const;
+
+        /**
+         * Parses properties text and adds the entries to this collection.
+         * @param data The text to parse.
+         * @param size The number of bytes of text.
+         * @throw Exception if a line is not a comment, blank, or name = value.
+         */
+        void parse(const char* data, size_t size);
+
+        std::deque<Entry> entries_;
+
+        EntryIndex index_;
+
+        /**
+         * Every slot. The first sortedCount_ are ordered by name, and the rest
+         * are in the order they were added.
+         */
+        mutable std::vector<int32> sorted_;
+
+        mutable std::atomic<size_t> sortedCount_;
+
+        /**
+         * Serializes sorting by readers of a shared const instance.
+         */
+        mutable std::mutex sortMutex_;
+
+        /**
+         * Serializes filling the expanded value cache by readers of a shared
+         * const instance.
+         */
+        mutable std::mutex expandMutex_;
+
+        int32 count_;
+
+        bool interpolation_;
+
+    public:
+
+        /**
+         * Constant iterator over the name/value pairs.
+         */
+        class const_iterator {
+
+        public:
+
+            typedef std::forward_iterator_tag iterator_category;
+            typedef Properties::value_type value_type;
+            typedef std::ptrdiff_t difference_type;
+            typedef const value_type* pointer;
+            typedef const value_type& reference;
+
+            const_iterator() { }
+
+            const_iterator(std::deque<Entry>::const_iterator itr, std::deque<Entry>::const_iterator end)
+                : itr_(itr),
+                  end_(end) {
+                skip();
+            }
+
+            reference operator *() const {
+                return itr_->property;
+            }
+
+            pointer operator ->() const {
+                return &itr_->property;
+            }
+
+            const_iterator& operator ++() {
+                ++itr_;
+                skip();
+                return *this;
+            }
+
+            const_iterator operator ++(int) {
+                auto result = *this;
+                ++*this;
+                return result;
+            }
+
+            bool operator ==(const const_iterator& other) const {
+                return itr_ == other.itr_;
+            }
+
+            bool operator !=(const const_iterator& other) const {
+                return itr_ != other.itr_;
+            }
+
+        private:
+
+            void skip() {
+                while (itr_ != end_ && !itr_->present) {
+                    ++itr_;
+                }
+            }
+
+            std::deque<Entry>::const_iterator itr_;
+
+            std::deque<Entry>::const_iterator end_;
+
+        };
+
+        /**
+         * A read-only view of the properties whose names start with a prefix.
+         * Names passed to the lookup methods are relative to the prefix, while
+         * iteration yields the full names.
+         */
+        class OB_CORE_API View {
+
+        public:
+
+            class const_iterator;
+
+            /**
+             * Constructs an empty view.
+             */
+            View();
+
+            /**
+             * Gets the prefix of the view.
+             * @return The prefix.
+             */
+            const std::string& prefix() const;
+
+            /**
+             * Gets the value of a property.
+             * @param name The name of the property relative to the prefix.
+             * @return The value of the property if one exists, or the empty string otherwise.
+             */
+            const std::string& getProperty(const std::string& name) const;
+
+            /**
+             * Gets the value of a property, converting from a string representation.
+             * @param name The name of the property relative to the prefix.
+             * @param defaultValue the value to return if the property doesn't exist.
+             * @return The value of the property if one exists, or defaultValue otherwise.
+             */
+            template <typename T>
+            T get(const std::string& name, const T& defaultValue = T()) const;
+
+            /**
+             * Gets whether or not the view contains a property.
+             * @param name The name of the property relative to the prefix.
+             * @return True if there is a property entry, false otherwise.
+             */
+            bool contains(const std::string& name) const;
+
+            /**
+             * Gets a narrower view.
+             * @param prefix The prefix relative to the prefix of this view.
+             * @return The view.
+             */
+            View view(const std::string& prefix) const;
+
+            /**
+             * Copies the view into a new collection with the prefix removed from the names.
+             * @return The properties.
+             */
+            Properties toProperties() const;
+
+            /**
+             * Gets the first iterator of the view.
+             * @return The iterator.
+             */
+            const_iterator begin() const;
+
+            /**
+             * Gets the ending iterator of the view.
+             * @return The last iterator.
+             */
+            const_iterator end() const;
+
+            /**
+             * Gets the number of properties in the view. This walks the view.
+             * @return The number of properties in the view.
+             */
+            int32 size() const;
+
+            /**
+             * Gets whether or not the view is empty.
+             * @return True if the view is empty, false otherwise.
+             */
+            bool empty() const;
+
+            /**
+             * Constant iterator over the name/value pairs of a view.
+             */
+            class const_iterator {
+
+            public:
+
+                typedef std::forward_iterator_tag iterator_category;
+                typedef Properties::value_type value_type;
+                typedef std::ptrdiff_t difference_type;
+                typedef const value_type* pointer;
+                typedef const value_type& reference;
+
+                const_iterator()
+                    : entries_(nullptr),
+                      itr_(nullptr),
+                      end_(nullptr) {
+                }
+
+                const_iterator(const std::deque<Entry>* entries, const int32* itr, const int32* end)
+                    : entries_(entries),
+                      itr_(itr),
+                      end_(end) {
+                    skip();
+                }
+
+                reference operator *() const {
+                    return (*entries_)[*itr_].property;
+                }
+
+                pointer operator ->() const {
+                    return &(*entries_)[*itr_].property;
+                }
+
+                const_iterator& operator ++() {
+                    ++itr_;
+                    skip();
+                    return *this;
+                }
+
+                const_iterator operator ++(int) {
+                    auto result = *this;
+                    ++*this;
+                    return result;
+                }
+
+                bool operator ==(const const_iterator& other) const {
+                    return itr_ == other.itr_;
+                }
+
+                bool operator !=(const const_iterator& other) const {
+                    return itr_ != other.itr_;
+                }
+
+            private:
+
+                void skip() {
+                    while (itr_ != end_ && !(*entries_)[*itr_].present) {
+                        ++itr_;
+                    }
+                }
+
+                const std::deque<Entry>* entries_;
+
+                const int32* itr_;
+
+                const int32* end_;
+
+            };
+
+        private:
+
+            friend class Properties;
+
+            View(const Properties* properties, std::string prefix, const int32* begin, const int32* end);
+
+            /**
+             * Finds the entry for a name relative to the prefix with a binary search.
+             * @param name The relative name.
+             * @return The entry, or nullptr if there is none.
+             */
+            const Entry* find(const std::string& name) const;
+
+            const Properties* properties_;
+
+            std::string prefix_;
+
+            const int32* begin_;
+
+            const int32* end_;
+
+        };
 
     };
 
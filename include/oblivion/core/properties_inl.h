@@ -3,6 +3,9 @@
 #ifndef _OBLIVION_CORE_PROPERTIES_INL_H_
 #define _OBLIVION_CORE_PROPERTIES_INL_H_
 
+#include <memory>
+
+#include <oblivion/core/exception.h>
 #include <oblivion/core/string_util.h>
 
 namespace oblivion {
@@ -18,11 +21,97 @@ void Properties::set(const std::string& name, const T& value) {
 
 template <typename T>
 T Properties::get(const std::string& name, const T& defaultValue) const {
-    if (contains(name)) {
-        return StringUtil::parse<T>(getProperty(name));
+    auto entry = find(name);
+    return entry ? value<T>(*entry) : defaultValue;
+}
+
+/*****************************************************************************/
+
+template <typename T>
+T Properties::get(const PropertyHandle<T>& handle, const T& defaultValue) const {
+    auto entry = at(handle.slot());
+    return entry ? value<T>(*entry) : defaultValue;
+}
+
+/*****************************************************************************/
+
+template <typename T>
+PropertyHandle<T> Properties::handle(const std::string& name) {
+    return PropertyHandle<T>(this, resolve(name));
+}
+
+/*****************************************************************************/
+
+inline const Properties::Entry* Properties::at(int32 slot) const {
+    if (slot < 0 || static_cast<size_t>(slot) >= entries_.size()) {
+        return nullptr;
+    }
+
+    auto& entry = entries_[slot];
+    return entry.present ? &entry : nullptr;
+}
+
+/*****************************************************************************/
+
+inline const std::string& Properties::text(const Entry& entry) const {
+    if (!interpolation_ || !entry.templated) {
+        return entry.property.second;
+    }
+
+    return expand(entry, 0);
+}
+
+/*****************************************************************************/
+
+template <typename T>
+T Properties::value(const Entry& entry) const {
+    auto cache = entry.cache.load(std::memory_order_acquire);
+    if (cache) {
+        if (cache->type == propertyTypeId<T>()) {
+            return static_cast<TypedPropertyValueCache<T>*>(cache)->value;
+        }
+
+        // Only the first type read is cached; other types are parsed every time.
+        return StringUtil::parse<T>(text(entry));
+    }
+
+    std::unique_ptr<TypedPropertyValueCache<T>> parsed(new TypedPropertyValueCache<T>());
+    parsed->type = propertyTypeId<T>();
+    parsed->value = StringUtil::parse<T>(text(entry));
+
+    // Readers of a shared const instance may race to fill the cache; the first one wins.
+    PropertyValueCache* expected = nullptr;
+    if (entry.cache.compare_exchange_strong(expected, parsed.get(), std::memory_order_acq_rel)) {
+        return parsed.release()->value;
+    }
+
+    return parsed->value;
+}
+
+/*****************************************************************************/
+
+template <>
+inline std::string Properties::value(const Entry& entry) const {
+    return text(entry);
+}
+
+/*****************************************************************************/
+
+template <typename T>
+T Properties::View::get(const std::string& name, const T& defaultValue) const {
+    auto entry = find(name);
+    return entry ? properties_->value<T>(*entry) : defaultValue;
+}
+
+/*****************************************************************************/
+
+template <typename T>
+T PropertyHandle<T>::get(const T& defaultValue) const {
+    if (!properties_) {
+        OB_THROW("Property handle is not bound to a collection");
     }
 
-    return defaultValue;
+    return properties_->get(*this, defaultValue);
 }
 
 /*****************************************************************************/
@@ -0,0 +1,82 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#ifndef _OBLIVION_CORE_PROPERTIES_WATCHER_H_
+#define _OBLIVION_CORE_PROPERTIES_WATCHER_H_
+
+#include <functional>
+#include <memory>
+#include <set>
+#include <string>
+
+#include <oblivion/core/base.h>
+#include <oblivion/core/non_copyable.h>
+#include <oblivion/core/types.h>
+
+namespace oblivion {
+
+    class SharedProperties;
+
+    /**
+     * Watches a properties file for changes and reloads it into a SharedProperties.
+     * Bursts of writes are collected into a single reload, and subscribers are told
+     * which keys were added, removed or modified. Uses inotify, so it is only
+     * available on Linux.
+     */
+    class OB_CORE_API PropertiesWatcher : NonCopyable {
+
+    public:
+
+        /**
+         * Callback invoked on the watcher thread after a reload that changed something.
+         * A key counts as modified when its raw text changes; one whose ${name}
+         * references expand differently is not reported unless its own text changed.
+         * Exceptions thrown by a listener are caught and ignored, and the remaining
+         * listeners are still called.
+         */
+        typedef std::function<void(const std::set<std::string>& changedKeys)> Listener;
+
+        /**
+         * Starts watching a file. The file is not reloaded until it changes.
+         * @param properties The properties to reload into. Must outlive the watcher.
+         * @param path The path to the properties file.
+         * @param debounceMillis How long to wait after the first change to the file
+         *        before reloading it. Further changes within that time are picked up
+         *        by the same reload, and changes to other files are ignored.
+         * @throw Exception if the file cannot be watched.
+         */
+        PropertiesWatcher(SharedProperties& properties, const std::string& path, int32 debounceMillis = 100);
+
+        /**
+         * Stops watching and joins the watcher thread.
+         */
+        ~PropertiesWatcher();
+
+        /**
+         * Registers a listener for changes.
+         * @param listener The callback.
+         * @return An id that can be passed to unsubscribe.
+         */
+        int32 subscribe(Listener listener);
+
+        /**
+         * Removes a listener.
+         * @param id The id returned by subscribe.
+         */
+        void unsubscribe(int32 id);
+
+        /**
+         * Gets the number of reloads that have been applied.
+         * @return The reload count.
+         */
+        int32 reloadCount() const;
+
+    private:
+
+        struct Impl;
+        std::unique_ptr<Impl> impl_;
+
+    };
+
+}
+
+#endif /* _OBLIVION_CORE_PROPERTIES_WATCHER_H_ */
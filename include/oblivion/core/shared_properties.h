@@ -0,0 +1,190 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#ifndef _OBLIVION_CORE_SHARED_PROPERTIES_H_
+#define _OBLIVION_CORE_SHARED_PROPERTIES_H_
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <oblivion/core/base.h>
+#include <oblivion/core/non_copyable.h>
+#include <oblivion/core/properties.h>
+
+namespace oblivion {
+
+    /**
+     * A set of properties that many threads can read while it is being reloaded.
+     * Writers build a new, immutable snapshot off to the side, swap it in and
+     * bump a version counter, so readers never see a partially applied change.
+     *
+     * Each thread keeps its own reference to the snapshot it last read. While
+     * nothing new is published, get and getProperty cost one atomic load of the
+     * version and write no shared memory, so readers do not contend. A thread
+     * that sees a new version fetches the new snapshot once; that fetch and the
+     * swap itself go through std::atomic_load and std::atomic_store on
+     * shared_ptr, which common standard libraries implement with a lock.
+     * A thread's reference keeps the snapshot it last read alive until the
+     * thread reads this object again or exits.
+     */
+    class OB_CORE_API SharedProperties : NonCopyable {
+
+    public:
+
+        /**
+         * An immutable view of the properties at one point in time.
+         */
+        typedef std::shared_ptr<const Properties> Snapshot;
+
+        /**
+         * Constructs an empty set of properties.
+         */
+        SharedProperties();
+
+        /**
+         * Constructs a set of properties by loading from the specified path.
+         * @param path The path to the file to load.
+         * @throw Exception if the properties file cannot be loaded.
+         */
+        explicit SharedProperties(const std::string& path);
+
+        /**
+         * Gets the current snapshot. The snapshot stays valid and unchanged for as
+         * long as the caller holds it, even if a reload happens in the meantime.
+         * Copying the snapshot increments its shared reference count; for single
+         * reads, get and getProperty avoid that.
+         * @return The current snapshot.
+         */
+        Snapshot snapshot() const;
+
+        /**
+         * Replaces the contents with a freshly loaded file. If loading fails the
+         * current snapshot is kept. Handles stay valid.
+         *
+         * Every write builds the new snapshot from scratch, with only the handle
+         * names and the properties that are set, so names that are no longer used
+         * do not accumulate across reloads.
+         * @param path The path to the file to load.
+         * @throw Exception if the properties file cannot be loaded.
+         */
+        void reload(const std::string& path);
+
+        /**
+         * Replaces the contents with the specified properties. Handles stay valid.
+         * @param properties The new contents.
+         */
+        void publish(Properties properties);
+
+        /**
+         * Applies a change to a private copy of the current snapshot and publishes
+         * the result. Concurrent updates are serialized.
+         * @param mutator The function that modifies the copy.
+         */
+        void update(const std::function<void(Properties&)>& mutator);
+
+        /**
+         * Sets the value of the specified property.
+         * @param name The name of the property.
+         * @param value The value of the property.
+         */
+        void setProperty(const std::string& name, const std::string& value);
+
+        /**
+         * Gets the value of a property from the current snapshot.
+         * @param name The name of the property to get.
+         * @return The value of the property if one exists, or the empty string otherwise.
+         */
+        std::string getProperty(const std::string& name) const;
+
+        /**
+         * Gets the value of a property from the current snapshot, converting from a
+         * string representation.
+         * @param name The value of the property to get.
+         * @param defaultValue the value to return if the property doesn't exist.
+         * @return The value of the property if one exists, or defaultValue otherwise.
+         */
+        template <typename T>
+        T get(const std::string& name, const T& defaultValue = T()) const;
+
+        /**
+         * Gets the value of a property from the current snapshot through a handle.
+         * @param handle A handle from this object's handle method.
+         * @param defaultValue the value to return if the property doesn't exist.
+         * @return The value of the property if one exists, or defaultValue otherwise.
+         */
+        template <typename T>
+        T get(const PropertyHandle<T>& handle, const T& defaultValue = T()) const;
+
+        /**
+         * Resolves a property name to a handle that can be read from every snapshot
+         * published after this call, including across reloads. The handle is not
+         * bound to a snapshot; read it through get or through Properties::get on a snapshot.
+         * Handle names keep the first slots of every snapshot, in the order they
+         * were resolved. Resolving a new name publishes a new snapshot.
+         * @param name The name of the property.
+         * @return The handle.
+         */
+        template <typename T>
+        PropertyHandle<T> handle(const std::string& name);
+
+    private:
+
+        /**
+         * Gets this thread's reference to the current snapshot, refreshing it if
+         * a newer version has been published.
+         * @return The snapshot.
+         */
+        const Snapshot& local() const;
+
+        /**
+         * Creates an empty collection with the slots of the handle names reserved.
+         * @param interpolation Whether the collection expands references.
+         * @return The collection.
+         */
+        std::shared_ptr<Properties> reserved(bool interpolation) const;
+
+        /**
+         * Publishes a compacted copy of a collection.
+         * @param properties The collection to copy.
+         */
+        void publishCopy(const Properties& properties);
+
+        /**
+         * Gets the slot of a handle name, reserving one if necessary.
+         * @param name The name.
+         * @return The slot.
+         */
+        int32 reserve(const std::string& name);
+
+        void swap(Snapshot next);
+
+        /**
+         * Identifies this object in the per-thread snapshot references; unlike an
+         * address it is never reused.
+         */
+        const uint64 id_;
+
+        std::atomic<uint64> version_;
+
+        Snapshot current_;
+
+        /**
+         * The names handles were resolved for. The index of a name is its slot.
+         */
+        std::vector<std::string> handleNames_;
+
+        std::unordered_map<std::string, int32> handleSlots_;
+
+        std::mutex writeMutex_;
+
+    };
+
+}
+
+#include <oblivion/core/shared_properties_inl.h>
+
+#endif /* _OBLIVION_CORE_SHARED_PROPERTIES_H_ */
@@ -0,0 +1,33 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#ifndef _OBLIVION_CORE_SHARED_PROPERTIES_INL_H_
+#define _OBLIVION_CORE_SHARED_PROPERTIES_INL_H_
+
+namespace oblivion {
+
+/*****************************************************************************/
+
+template <typename T>
+T SharedProperties::get(const std::string& name, const T& defaultValue) const {
+    return local()->get<T>(name, defaultValue);
+}
+
+/*****************************************************************************/
+
+template <typename T>
+T SharedProperties::get(const PropertyHandle<T>& handle, const T& defaultValue) const {
+    return local()->get(handle, defaultValue);
+}
+
+/*****************************************************************************/
+
+template <typename T>
+PropertyHandle<T> SharedProperties::handle(const std::string& name) {
+    return PropertyHandle<T>(nullptr, reserve(name));
+}
+
+/*****************************************************************************/
+
+}
+
+#endif /* _OBLIVION_CORE_SHARED_PROPERTIES_INL_H_ */
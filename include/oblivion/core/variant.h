@@ -27,11 +27,111 @@ namespace oblivion {
         Map
     };
 
+    /**
+     * The number of values in VariantType.
+     */
+    const int32 VARIANT_TYPE_COUNT = 7;
+
+    /**
+     * Breakdown of the memory used by a variant tree, in bytes.
+     */
+    struct OB_CORE_API VariantMemoryUsage {
+
+        /**
+         * Variant handles, value objects and map tree nodes.
+         */
+        uint64 nodeBytes;
+
+        /**
+         * Heap buffers owned by string values.
+         */
+        uint64 stringBytes;
+
+        /**
+         * Heap buffers owned by map keys.
+         */
+        uint64 keyBytes;
+
+        /**
+         * Reserved but unused array capacity.
+         */
+        uint64 containerSlackBytes;
+
+        /**
+         * Gets the total number of bytes.
+         * @return The sum of all categories.
+         */
+        uint64 total() const;
+
+        /**
+         * Adds the usage of another tree to this one.
+         * @param other The usage to add.
+         * @return A reference to this.
+         */
+        VariantMemoryUsage& operator +=(const VariantMemoryUsage& other);
+
+    };
+
+    /**
+     * Global variant counters. These are only maintained when the library is
+     * built with OBLIVION_CORE_VARIANT_STATS, and are zero otherwise.
+     */
+    struct OB_CORE_API VariantStats {
+
+        /**
+         * The number of Variant objects currently alive.
+         */
+        int64 liveVariants;
+
+        /**
+         * The number of values currently alive, indexed by VariantType.
+         */
+        int64 liveValues[VARIANT_TYPE_COUNT];
+
+        /**
+         * The total number of values allocated, indexed by VariantType.
+         */
+        int64 allocations[VARIANT_TYPE_COUNT];
+
+    };
+
     /**
      * Interface for variant values.
      */
     class VariantValue;
 
+    class File;
+
+    /**
+     * How arrays are combined by Variant::merge.
+     */
+    enum class ArrayMergeMode {
+        Replace,
+        Append
+    };
+
+    /**
+     * Options for Variant::merge.
+     */
+    struct OB_CORE_API VariantMergeOptions {
+
+        /**
+         * Initializes the options to replace arrays and keep null values.
+         */
+        VariantMergeOptions();
+
+        /**
+         * How an overlay array is combined with an existing array.
+         */
+        ArrayMergeMode arrays;
+
+        /**
+         * Whether a null in the overlay removes the key instead of setting it to null.
+         */
+        bool nullRemovesKey;
+
+    };
+
     /**
      * Variable that is able to hold one of several types.
      */
@@ -185,6 +285,12 @@ namespace oblivion {
          */
         void add(const Variant& variant);
 
+        /**
+         * Adds an element to this Variant by moving it. Only supported by VariantType::Vector
+         * @param variant The variant to add.
+         */
+        void add(Variant&& variant);
+
         /**
          * Gets whether or not this variant contains the specified key. Only supported
          * by VariantType::Map.
@@ -199,12 +305,82 @@ namespace oblivion {
          */
         std::vector<std::string> mapKeys() const;
 
+        /**
+         * Removes the entry with the specified key. Only supported by VariantType::Map.
+         * @param key The key to remove.
+         * @return True if an entry was removed, false otherwise.
+         */
+        bool remove(const std::string& key);
+
+        /**
+         * Deep merges an overlay into this variant in place. Maps are merged key by
+         * key, and any other overlay value replaces the existing value. Only the
+         * keys present in the overlay are visited. The overlay may be this
+         * variant or a value inside it.
+         * @param overlay The variant to merge in.
+         * @param options Controls how arrays and nulls are handled.
+         */
+        void merge(const Variant& overlay, const VariantMergeOptions& options = VariantMergeOptions());
+
+        /**
+         * Deep merges an overlay into this variant in place, moving nodes out of the
+         * overlay instead of copying them. The overlay is left null unless it is
+         * this variant. It may be a value inside this variant, which is then null
+         * when the merge starts.
+         * @param overlay The variant to merge in.
+         * @param options Controls how arrays and nulls are handled.
+         */
+        void merge(Variant&& overlay, const VariantMergeOptions& options = VariantMergeOptions());
+
+        /**
+         * Applies an RFC 7396 JSON merge patch to this variant in place.
+         * @param patch The merge patch.
+         */
+        void mergePatch(const Variant& patch);
+
+        /**
+         * Applies an RFC 7396 JSON merge patch to this variant in place, moving
+         * nodes out of the patch. The patch is left null.
+         * @param patch The merge patch.
+         */
+        void mergePatch(Variant&& patch);
+
+        /**
+         * Gets an estimate of the memory used by this variant and its children.
+         * @return The memory usage breakdown.
+         */
+        VariantMemoryUsage memoryUsage() const;
+
+        /**
+         * Gets the global variant counters.
+         * @return The current counter values.
+         */
+        static VariantStats stats();
+
         /**
          * Gets the JSON value of this Variant.
          * @return The JSON value.
          */
         std::string toJson() const;
 
+        /**
+         * Gets the JSON value of this Variant, serializing the elements of a large
+         * array or map on several threads. The result is identical to toJson().
+         * @param threadCount The number of threads to use, or 0 to use one per core.
+         * @return The JSON value.
+         */
+        std::string toJsonParallel(int32 threadCount = 0) const;
+
+        /**
+         * Writes the JSON value of this Variant to a file. Large arrays and maps
+         * are serialized in chunks on several threads, and each chunk is written
+         * in order as soon as it is ready.
+         * @param file The file to write to.
+         * @param threadCount The number of threads to use, or 0 to use one per core.
+         * @throw Exception if the write operation fails.
+         */
+        void writeJson(File& file, int32 threadCount = 0) const;
+
         /**
          * Parses a JSON string.
          * @param jsonString the input JSON string.
@@ -212,6 +388,38 @@ namespace oblivion {
          */
         static Variant parseJson(const std::string& jsonString);
 
+        /**
+         * Gets the CBOR (RFC 8949) encoding of this Variant.
+         * @return The CBOR bytes.
+         */
+        std::string toCbor() const;
+
+        /**
+         * Writes the CBOR encoding of this Variant to a file.
+         * @param file The file to write to.
+         * @throw Exception if the write operation fails.
+         */
+        void writeCbor(File& file) const;
+
+        /**
+         * Parses CBOR data. Integers outside the int32 range become reals.
+         * Arrays and maps may be nested at most 512 levels deep.
+         * @param cbor The CBOR bytes.
+         * @return The equivalent variant.
+         * @throw Exception if the data is malformed or nested too deeply.
+         */
+        static Variant parseCbor(const std::string& cbor);
+
+        /**
+         * Parses CBOR data. Integers outside the int32 range become reals.
+         * Arrays and maps may be nested at most 512 levels deep.
+         * @param data The CBOR bytes.
+         * @param size The number of bytes.
+         * @return The equivalent variant.
+         * @throw Exception if the data is malformed or nested too deeply.
+         */
+        static Variant parseCbor(const void* data, size_t size);
+
     private:
 
         std::unique_ptr<VariantValue> value_;
@@ -0,0 +1,96 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#include <oblivion/core/aligned_buffer.h>
+
+#include <cstdlib>
+#include <utility>
+
+#include <oblivion/core/exception.h>
+
+#ifdef WIN32
+#include <malloc.h>
+#endif
+
+namespace oblivion {
+
+/*****************************************************************************/
+
+const size_t AlignedBuffer::DEFAULT_ALIGNMENT;
+
+/*****************************************************************************/
+
+AlignedBuffer::AlignedBuffer()
+    : data_(nullptr),
+      size_(0),
+      alignment_(DEFAULT_ALIGNMENT) {
+}
+
+/*****************************************************************************/
+
+AlignedBuffer::AlignedBuffer(size_t size, size_t alignment)
+    : data_(nullptr),
+      size_(size),
+      alignment_(alignment) {
+    if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0) {
+        OB_THROW("Invalid alignment: %llu", static_cast<unsigned long long>(alignment));
+    }
+
+    if (size == 0) {
+        return;
+    }
+
+#ifdef WIN32
+    data_ = static_cast<char*>(_aligned_malloc(size, alignment));
+    if (!data_) {
+#else
+    void* data = nullptr;
+    if (posix_memalign(&data, alignment, size) != 0) {
+#endif
+        OB_THROW("Unable to allocate %llu aligned bytes", static_cast<unsigned long long>(size));
+    }
+
+#ifndef WIN32
+    data_ = static_cast<char*>(data);
+#endif
+}
+
+/*****************************************************************************/
+
+AlignedBuffer::AlignedBuffer(AlignedBuffer&& other)
+    : data_(other.data_),
+      size_(other.size_),
+      alignment_(other.alignment_) {
+    other.data_ = nullptr;
+    other.size_ = 0;
+}
+
+/*****************************************************************************/
+
+AlignedBuffer::~AlignedBuffer() {
+#ifdef WIN32
+    _aligned_free(data_);
+#else
+    free(data_);
+#endif
+}
+
+/*****************************************************************************/
+
+AlignedBuffer& AlignedBuffer::operator =(AlignedBuffer&& other) {
+    if (this != &other) {
+        AlignedBuffer old(std::move(*this));
+
+        data_ = other.data_;
+        size_ = other.size_;
+        alignment_ = other.alignment_;
+
+        other.data_ = nullptr;
+        other.size_ = 0;
+    }
+
+    return *this;
+}
+
+/*****************************************************************************/
+
+}
@@ -0,0 +1,108 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#include <oblivion/core/aligned_buffer_pool.h>
+
+#include <utility>
+
+#include <oblivion/core/exception.h>
+
+namespace oblivion {
+
+/*****************************************************************************/
+
+AlignedBufferPool::Lease::Lease(AlignedBufferPool* pool, AlignedBuffer&& buffer)
+    : pool_(pool),
+      buffer_(std::move(buffer)) {
+}
+
+/*****************************************************************************/
+
+AlignedBufferPool::Lease::Lease(Lease&& other)
+    : pool_(other.pool_),
+      buffer_(std::move(other.buffer_)) {
+    other.pool_ = nullptr;
+}
+
+/*****************************************************************************/
+
+AlignedBufferPool::Lease::~Lease() {
+    release();
+}
+
+/*****************************************************************************/
+
+AlignedBufferPool::Lease& AlignedBufferPool::Lease::operator =(Lease&& other) {
+    if (this != &other) {
+        release();
+
+        pool_ = other.pool_;
+        buffer_ = std::move(other.buffer_);
+        other.pool_ = nullptr;
+    }
+
+    return *this;
+}
+
+/*****************************************************************************/
+
+void AlignedBufferPool::Lease::release() {
+    if (pool_) {
+        pool_->release(std::move(buffer_));
+        pool_ = nullptr;
+    }
+}
+
+/*****************************************************************************/
+
+AlignedBufferPool::AlignedBufferPool(size_t bufferSize, size_t alignment, size_t maxIdle)
+    : bufferSize_(bufferSize),
+      alignment_(alignment),
+      maxIdle_(maxIdle) {
+    if (bufferSize == 0) {
+        OB_THROW("Invalid buffer size");
+    }
+
+    if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0) {
+        OB_THROW("Invalid alignment: %llu", static_cast<unsigned long long>(alignment));
+    }
+
+    idle_.reserve(maxIdle);
+}
+
+/*****************************************************************************/
+
+AlignedBufferPool::Lease AlignedBufferPool::acquire() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        if (!idle_.empty()) {
+            AlignedBuffer buffer(std::move(idle_.back()));
+            idle_.pop_back();
+            return Lease(this, std::move(buffer));
+        }
+    }
+
+    // Allocate outside the lock; other threads can keep reusing idle buffers.
+    return Lease(this, AlignedBuffer(bufferSize_, alignment_));
+}
+
+/*****************************************************************************/
+
+size_t AlignedBufferPool::idle() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return idle_.size();
+}
+
+/*****************************************************************************/
+
+void AlignedBufferPool::release(AlignedBuffer&& buffer) {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    if (idle_.size() < maxIdle_) {
+        idle_.push_back(std::move(buffer));
+    }
+}
+
+/*****************************************************************************/
+
+}
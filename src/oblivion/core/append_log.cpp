@@ -0,0 +1,308 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#include <oblivion/core/append_log.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+
+#include <oblivion/core/exception.h>
+#include <oblivion/core/file_util.h>
+#include <oblivion/core/string_util.h>
+
+namespace oblivion {
+
+/*****************************************************************************/
+
+/**
+ * The most bytes the flusher lets build up before writing without waiting
+ * for the interval.
+ */
+static const size_t FLUSH_THRESHOLD = 1 << 20;
+
+/*****************************************************************************/
+
+/**
+ * Gets the directory part of a path.
+ */
+static std::string directoryOf(const std::string& path) {
+    auto lastSlash = path.find_last_of("\\/");
+    return lastSlash == std::string::npos ? std::string(".") : path.substr(0, lastSlash + 1);
+}
+
+/*****************************************************************************/
+
+AppendLog::Options::Options()
+    : durability(Durability::Commit),
+      interval(100),
+      segmentSize(64ull << 20),
+      preallocate(true),
+      maxPending(64 << 20) {
+}
+
+/*****************************************************************************/
+
+AppendLog::AppendLog(const std::string& path, const Options& options)
+    : path_(path),
+      options_(options),
+      flushThreshold_(std::min(FLUSH_THRESHOLD, options.maxPending)),
+      appended_(0),
+      written_(0),
+      durable_(0),
+      syncTarget_(0),
+      blocked_(0),
+      stopping_(false),
+      segment_(0),
+      segmentOffset_(0) {
+    if (options.interval <= 0 || options.segmentSize == 0 || options.maxPending == 0) {
+        OB_THROW("Invalid append log options: %s", path.c_str());
+    }
+
+    // Continue after the highest existing segment rather than appending to a
+    // file whose tail may be torn.
+    auto prefix = FileUtil::getFileName(path) + ".";
+    int32 last = 0;
+
+    for (auto& file : FileUtil::listFiles(directoryOf(path))) {
+        auto name = FileUtil::getFileName(file);
+        if (!StringUtil::startsWith(name, prefix) || name.size() == prefix.size()) {
+            continue;
+        }
+
+        auto suffix = name.substr(prefix.size());
+        if (suffix.find_first_not_of("0123456789") == std::string::npos) {
+            last = std::max(last, static_cast<int32>(atoi(suffix.c_str())));
+        }
+    }
+
+    openSegment(last + 1);
+
+    pending_.reserve(flushThreshold_);
+    writing_.reserve(flushThreshold_);
+
+    flusher_ = std::thread(&AppendLog::run, this);
+}
+
+/*****************************************************************************/
+
+AppendLog::~AppendLog() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+
+    work_.notify_one();
+    flusher_.join();
+}
+
+/*****************************************************************************/
+
+uint64 AppendLog::append(const void* data, size_t size) {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    if (!pending_.empty() && pending_.size() + size > options_.maxPending) {
+        ++blocked_;
+        work_.notify_one();
+
+        done_.wait(lock, [&] {
+            return !error_.empty() || pending_.empty() || pending_.size() + size <= options_.maxPending;
+        });
+
+        --blocked_;
+    }
+
+    check();
+
+    // Wake the flusher only on the transitions it waits for, not on every append.
+    bool wake = options_.durability == Durability::Commit ? pending_.empty() :
+        pending_.size() < flushThreshold_ && pending_.size() + size >= flushThreshold_;
+
+    pending_.append(static_cast<const char*>(data), size);
+    appended_ += size;
+
+    auto end = appended_;
+
+    if (wake) {
+        work_.notify_one();
+    }
+
+    if (options_.durability == Durability::Commit) {
+        done_.wait(lock, [&] { return durable_ >= end || !error_.empty(); });
+        check();
+    }
+
+    return end;
+}
+
+/*****************************************************************************/
+
+uint64 AppendLog::append(const std::string& record) {
+    return append(record.data(), record.size());
+}
+
+/*****************************************************************************/
+
+void AppendLog::sync() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    check();
+
+    auto target = appended_;
+    if (durable_ >= target) {
+        return;
+    }
+
+    syncTarget_ = std::max(syncTarget_, target);
+    work_.notify_one();
+
+    done_.wait(lock, [&] { return durable_ >= target || !error_.empty(); });
+    check();
+}
+
+/*****************************************************************************/
+
+uint64 AppendLog::position() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return appended_;
+}
+
+/*****************************************************************************/
+
+uint64 AppendLog::durablePosition() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return durable_;
+}
+
+/*****************************************************************************/
+
+int32 AppendLog::segment() const {
+    return segment_.load();
+}
+
+/*****************************************************************************/
+
+std::string AppendLog::segmentPath(int32 index) const {
+    return StringUtil::formatString("%s.%06d", path_.c_str(), index);
+}
+
+/*****************************************************************************/
+
+bool AppendLog::ready() const {
+    if (stopping_ || syncTarget_ > durable_) {
+        return true;
+    }
+
+    return !pending_.empty() && (blocked_ > 0 || pending_.size() >= flushThreshold_ ||
+        options_.durability == Durability::Commit);
+}
+
+/*****************************************************************************/
+
+void AppendLog::check() const {
+    if (!error_.empty()) {
+        OB_THROW("Append log %s failed: %s", path_.c_str(), error_.c_str());
+    }
+}
+
+/*****************************************************************************/
+
+void AppendLog::run() {
+    typedef std::chrono::steady_clock Clock;
+
+    auto interval = std::chrono::milliseconds(options_.interval);
+    auto nextTick = Clock::now() + interval;
+
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    for (;;) {
+        work_.wait_until(lock, nextTick, [this] { return ready(); });
+
+        auto now = Clock::now();
+        bool tick = now >= nextTick;
+        if (tick) {
+            nextTick = now + interval;
+        }
+
+        bool write = !pending_.empty() && (tick || ready());
+        auto end = write ? appended_ : written_;
+        bool sync = end > durable_ && (syncTarget_ > durable_ ||
+            (options_.durability != Durability::None &&
+                (options_.durability == Durability::Commit || tick || stopping_)));
+
+        if (!write && !sync) {
+            if (stopping_) {
+                return;
+            }
+
+            continue;
+        }
+
+        if (write) {
+            writing_.swap(pending_);
+            done_.notify_all();
+        }
+
+        // Appends continue into the other buffer while this batch is written.
+        lock.unlock();
+
+        try {
+            if (write) {
+                this->write(writing_);
+            }
+
+            if (sync) {
+                file_->sync(true);
+            }
+        } catch (const std::exception& e) {
+            lock.lock();
+            error_ = e.what();
+            done_.notify_all();
+            return;
+        }
+
+        lock.lock();
+        writing_.clear();
+        written_ = end;
+
+        if (sync) {
+            durable_ = end;
+        }
+
+        done_.notify_all();
+    }
+}
+
+/*****************************************************************************/
+
+void AppendLog::write(const std::string& batch) {
+    if (segmentOffset_ > 0 && segmentOffset_ + batch.size() > options_.segmentSize) {
+        // Everything in the finished segment must be durable before positions
+        // past it can be, since only the current segment is synced.
+        file_->sync(true);
+        openSegment(segment_.load() + 1);
+    }
+
+    file_->writeAt(segmentOffset_, batch.size(), batch.data());
+    segmentOffset_ += batch.size();
+}
+
+/*****************************************************************************/
+
+void AppendLog::openSegment(int32 index) {
+    std::unique_ptr<File> file(new File(segmentPath(index), "wb"));
+
+    if (options_.preallocate) {
+        file->allocate(options_.segmentSize);
+    }
+
+    // Without this the new file itself could vanish in a crash after its
+    // records were synced.
+    FileUtil::syncDirectory(directoryOf(path_));
+
+    file_ = std::move(file);
+    segment_ = index;
+    segmentOffset_ = 0;
+}
+
+/*****************************************************************************/
+
+}
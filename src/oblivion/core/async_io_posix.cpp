@@ -0,0 +1,1053 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#include <oblivion/core/async_io.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+#include <oblivion/core/exception.h>
+
+#if defined(__linux__) && defined(__NR_io_uring_setup)
+#define OB_HAS_IO_URING 1
+#endif
+
+namespace oblivion {
+
+/*****************************************************************************/
+
+enum class IoOp {
+    Open,
+    Read,
+    Write,
+    ReadFixed,
+    WriteFixed,
+    Sync,
+    DataSync,
+    Close
+};
+
+/*****************************************************************************/
+
+struct AsyncIo::Request {
+
+    Request(IoOp op, int fd, const void* buffer, size_t size, uint64 offset, Callback&& callback)
+        : op(op),
+          fd(fd),
+          buffer(const_cast<void*>(buffer)),
+          size(size),
+          offset(offset),
+          flags(0),
+          mode(0),
+          bufferIndex(0),
+          callback(std::move(callback)) {
+    }
+
+    /**
+     * Passes the result to the callback. A callback that throws must not take
+     * down the completion thread, so the exception is dropped.
+     */
+    void complete(int64 result) {
+        if (callback) {
+            try {
+                callback(result);
+            } catch (...) {
+            }
+        }
+    }
+
+    IoOp op;
+
+    int fd;
+
+    void* buffer;
+
+    size_t size;
+
+    uint64 offset;
+
+    int flags;
+
+    int mode;
+
+    int32 bufferIndex;
+
+    std::string path;
+
+    Callback callback;
+
+};
+
+/*****************************************************************************/
+
+struct AsyncIo::Impl {
+
+    virtual ~Impl() {
+    }
+
+    virtual IoBackend backend() const = 0;
+
+    /**
+     * Takes ownership of a request and queues it.
+     */
+    virtual void enqueue(Request* request) = 0;
+
+    virtual int32 submit() = 0;
+
+    virtual void drain() = 0;
+
+    virtual void registerBuffers(const std::vector<IoBuffer>& buffers) = 0;
+
+};
+
+/*****************************************************************************/
+
+/**
+ * Runs each request as a blocking system call on one of a fixed set of threads.
+ */
+struct AsyncIo::ThreadPool : AsyncIo::Impl {
+
+    ThreadPool(int32 queueDepth, int32 threadCount);
+
+    ~ThreadPool();
+
+    IoBackend backend() const;
+
+    void enqueue(Request* request);
+
+    int32 submit();
+
+    void drain();
+
+    void registerBuffers(const std::vector<IoBuffer>& buffers);
+
+    /**
+     * Moves the queued requests to the workers. The mutex must be held.
+     */
+    int32 submitLocked();
+
+    /**
+     * The body of each worker thread.
+     */
+    void run();
+
+    /**
+     * Performs a request.
+     * @return The result, or a negative errno.
+     */
+    static int64 execute(const Request& request);
+
+    std::mutex mutex_;
+
+    std::condition_variable work_;
+
+    std::condition_variable idle_;
+
+    /**
+     * Requests that have been queued but not submitted.
+     */
+    std::vector<std::unique_ptr<Request>> queued_;
+
+    /**
+     * Requests that have been submitted but not started.
+     */
+    std::deque<std::unique_ptr<Request>> ready_;
+
+    /**
+     * The number of requests submitted but not completed.
+     */
+    int64 outstanding_;
+
+    size_t queueDepth_;
+
+    bool stopping_;
+
+    std::vector<std::thread> threads_;
+
+};
+
+/*****************************************************************************/
+
+AsyncIo::ThreadPool::ThreadPool(int32 queueDepth, int32 threadCount)
+    : outstanding_(0),
+      queueDepth_(static_cast<size_t>(queueDepth)),
+      stopping_(false) {
+    queued_.reserve(queueDepth_);
+
+    for (int32 i = 0; i < threadCount; ++i) {
+        threads_.push_back(std::thread(&ThreadPool::run, this));
+    }
+}
+
+/*****************************************************************************/
+
+AsyncIo::ThreadPool::~ThreadPool() {
+    drain();
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+
+    work_.notify_all();
+
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+}
+
+/*****************************************************************************/
+
+IoBackend AsyncIo::ThreadPool::backend() const {
+    return IoBackend::ThreadPool;
+}
+
+/*****************************************************************************/
+
+void AsyncIo::ThreadPool::enqueue(Request* request) {
+    std::unique_ptr<Request> owned(request);
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    queued_.push_back(std::move(owned));
+
+    if (queued_.size() >= queueDepth_) {
+        submitLocked();
+    }
+}
+
+/*****************************************************************************/
+
+int32 AsyncIo::ThreadPool::submit() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return submitLocked();
+}
+
+/*****************************************************************************/
+
+int32 AsyncIo::ThreadPool::submitLocked() {
+    auto count = static_cast<int32>(queued_.size());
+
+    for (auto& request : queued_) {
+        ready_.push_back(std::move(request));
+    }
+
+    queued_.clear();
+    outstanding_ += count;
+
+    if (count == 1) {
+        work_.notify_one();
+    } else if (count > 1) {
+        work_.notify_all();
+    }
+
+    return count;
+}
+
+/*****************************************************************************/
+
+void AsyncIo::ThreadPool::drain() {
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    // Callbacks may queue more requests without submitting them. A callback
+    // runs before its request stops counting as outstanding, so once nothing
+    // is outstanding the queue holds everything left to do.
+    do {
+        submitLocked();
+        idle_.wait(lock, [this] { return outstanding_ == 0; });
+    } while (!queued_.empty());
+}
+
+/*****************************************************************************/
+
+void AsyncIo::ThreadPool::registerBuffers(const std::vector<IoBuffer>&) {
+    // Blocking calls gain nothing from registration; fixed requests simply
+    // use the buffer they name.
+    drain();
+}
+
+/*****************************************************************************/
+
+void AsyncIo::ThreadPool::run() {
+    for (;;) {
+        std::unique_ptr<Request> request;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_.wait(lock, [this] { return stopping_ || !ready_.empty(); });
+
+            if (ready_.empty()) {
+                return;
+            }
+
+            request = std::move(ready_.front());
+            ready_.pop_front();
+        }
+
+        request->complete(execute(*request));
+        request.reset();
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--outstanding_ == 0) {
+            idle_.notify_all();
+        }
+    }
+}
+
+/*****************************************************************************/
+
+int64 AsyncIo::ThreadPool::execute(const Request& request) {
+    ssize_t result;
+
+    do {
+        switch (request.op) {
+        case IoOp::Open:
+            result = ::open(request.path.c_str(), request.flags, request.mode);
+            break;
+        case IoOp::Read:
+        case IoOp::ReadFixed:
+            result = pread(request.fd, request.buffer, request.size, static_cast<off_t>(request.offset));
+            break;
+        case IoOp::Write:
+        case IoOp::WriteFixed:
+            result = pwrite(request.fd, request.buffer, request.size, static_cast<off_t>(request.offset));
+            break;
+        case IoOp::DataSync:
+#ifdef __APPLE__
+            result = fsync(request.fd);
+#else
+            result = fdatasync(request.fd);
+#endif
+            break;
+        case IoOp::Sync:
+            result = fsync(request.fd);
+            break;
+        case IoOp::Close:
+            // A close that is interrupted has still released the descriptor.
+            return ::close(request.fd) == 0 || errno == EINTR ? 0 : -errno;
+        default:
+            return -EINVAL;
+        }
+    } while (result < 0 && errno == EINTR);
+
+    return result < 0 ? -errno : static_cast<int64>(result);
+}
+
+/*****************************************************************************/
+
+#ifdef OB_HAS_IO_URING
+
+/**
+ * Submits requests through an io_uring submission queue and reaps their
+ * completions on a single thread. The ring is driven with raw system calls.
+ */
+struct AsyncIo::IoUring : AsyncIo::Impl {
+
+    /**
+     * Sets up a ring.
+     * @return The backend, or nullptr if the kernel lacks io_uring or an operation it needs.
+     */
+    static IoUring* create(int32 queueDepth);
+
+    explicit IoUring(int ring);
+
+    ~IoUring();
+
+    IoBackend backend() const;
+
+    void enqueue(Request* request);
+
+    int32 submit();
+
+    void drain();
+
+    void registerBuffers(const std::vector<IoBuffer>& buffers);
+
+    /**
+     * Maps the rings shared with the kernel.
+     * @return True if the rings were mapped.
+     */
+    bool map(const io_uring_params& params);
+
+    /**
+     * Writes a request into the next submission queue entry. The mutex must
+     * be held and the queue must have room.
+     */
+    void prepare(Request* request);
+
+    /**
+     * Hands the prepared entries to the kernel. The mutex must be held.
+     */
+    int32 submitLocked();
+
+    /**
+     * Submits until nothing is queued or in flight. The lock must hold the mutex.
+     * @throw Exception if the completion thread has failed.
+     */
+    void waitIdle(std::unique_lock<std::mutex>& lock);
+
+    /**
+     * Throws if the completion thread has failed. The mutex must be held.
+     */
+    void checkReaper() const;
+
+    /**
+     * The body of the completion thread.
+     */
+    void reap();
+
+    int ring_;
+
+    void* sqRing_;
+
+    size_t sqRingSize_;
+
+    void* cqRing_;
+
+    size_t cqRingSize_;
+
+    io_uring_sqe* sqes_;
+
+    size_t sqesSize_;
+
+    unsigned* sqHead_;
+
+    unsigned* sqTail_;
+
+    unsigned* sqArray_;
+
+    unsigned sqMask_;
+
+    unsigned sqEntries_;
+
+    unsigned* cqHead_;
+
+    unsigned* cqTail_;
+
+    io_uring_cqe* cqes_;
+
+    unsigned cqMask_;
+
+    unsigned cqEntries_;
+
+    std::mutex mutex_;
+
+    std::condition_variable idle_;
+
+    /**
+     * Entries prepared but not yet handed to the kernel.
+     */
+    unsigned queued_;
+
+    /**
+     * Entries handed to the kernel but not completed. Kept below the size of
+     * the completion queue so completions can never be dropped.
+     */
+    unsigned inflight_;
+
+    unsigned queueDepth_;
+
+    /**
+     * The errno that stopped the completion thread, or 0 while it runs.
+     */
+    int error_;
+
+    std::thread reaper_;
+
+};
+
+/*****************************************************************************/
+
+static int ioUringSetup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+/*****************************************************************************/
+
+static int ioUringEnter(int ring, unsigned toSubmit, unsigned minComplete, unsigned flags) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, ring, toSubmit, minComplete, flags, nullptr, 0));
+}
+
+/*****************************************************************************/
+
+static int ioUringRegister(int ring, unsigned opcode, const void* arg, unsigned count) {
+    return static_cast<int>(syscall(__NR_io_uring_register, ring, opcode, arg, count));
+}
+
+/*****************************************************************************/
+
+AsyncIo::IoUring* AsyncIo::IoUring::create(int32 queueDepth) {
+    io_uring_params params;
+    memset(&params, 0, sizeof(params));
+
+    int ring = ioUringSetup(static_cast<unsigned>(queueDepth), &params);
+    if (ring < 0) {
+        return nullptr;
+    }
+
+    std::unique_ptr<IoUring> result(new IoUring(ring));
+    result->queueDepth_ = static_cast<unsigned>(queueDepth);
+
+    if (!(params.features & IORING_FEAT_NODROP) || !result->map(params)) {
+        return nullptr;
+    }
+
+    // Kernels before 5.6 have rings but not every operation used here.
+    const unsigned char required[] = {
+        IORING_OP_OPENAT, IORING_OP_CLOSE, IORING_OP_READ, IORING_OP_WRITE,
+        IORING_OP_READ_FIXED, IORING_OP_WRITE_FIXED, IORING_OP_FSYNC, IORING_OP_NOP
+    };
+
+    const unsigned probeOps = 256;
+    std::vector<char> probeBuffer(sizeof(io_uring_probe) + probeOps * sizeof(io_uring_probe_op), 0);
+    auto probe = reinterpret_cast<io_uring_probe*>(probeBuffer.data());
+
+    if (ioUringRegister(ring, IORING_REGISTER_PROBE, probe, probeOps) < 0) {
+        return nullptr;
+    }
+
+    for (auto op : required) {
+        if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+            return nullptr;
+        }
+    }
+
+    result->reaper_ = std::thread(&IoUring::reap, result.get());
+    return result.release();
+}
+
+/*****************************************************************************/
+
+AsyncIo::IoUring::IoUring(int ring)
+    : ring_(ring),
+      sqRing_(MAP_FAILED),
+      sqRingSize_(0),
+      cqRing_(MAP_FAILED),
+      cqRingSize_(0),
+      sqes_(static_cast<io_uring_sqe*>(MAP_FAILED)),
+      sqesSize_(0),
+      queued_(0),
+      inflight_(0),
+      queueDepth_(0),
+      error_(0) {
+}
+
+/*****************************************************************************/
+
+AsyncIo::IoUring::~IoUring() {
+    if (reaper_.joinable()) {
+        std::unique_lock<std::mutex> lock(mutex_);
+
+        try {
+            waitIdle(lock);
+        } catch (const Exception&) {
+            // The completion thread has already stopped; requests still in
+            // flight are cancelled when the ring is closed.
+        }
+
+        // A no-op without a request tells the completion thread to stop.
+        if (error_ == 0) {
+            auto tail = *sqTail_;
+            auto index = tail & sqMask_;
+            auto sqe = &sqes_[index];
+
+            memset(sqe, 0, sizeof(*sqe));
+            sqe->opcode = IORING_OP_NOP;
+            sqArray_[index] = index;
+            __atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+            ++queued_;
+            submitLocked();
+        }
+
+        lock.unlock();
+        reaper_.join();
+    }
+
+    if (sqes_ != MAP_FAILED) {
+        munmap(sqes_, sqesSize_);
+    }
+
+    if (cqRing_ != MAP_FAILED && cqRing_ != sqRing_) {
+        munmap(cqRing_, cqRingSize_);
+    }
+
+    if (sqRing_ != MAP_FAILED) {
+        munmap(sqRing_, sqRingSize_);
+    }
+
+    ::close(ring_);
+}
+
+/*****************************************************************************/
+
+bool AsyncIo::IoUring::map(const io_uring_params& params) {
+    sqRingSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqRingSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+    bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single) {
+        sqRingSize_ = cqRingSize_ = std::max(sqRingSize_, cqRingSize_);
+    }
+
+    sqRing_ = mmap(nullptr, sqRingSize_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+        ring_, IORING_OFF_SQ_RING);
+    if (sqRing_ == MAP_FAILED) {
+        return false;
+    }
+
+    cqRing_ = single ? sqRing_ : mmap(nullptr, cqRingSize_, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, ring_, IORING_OFF_CQ_RING);
+    if (cqRing_ == MAP_FAILED) {
+        return false;
+    }
+
+    sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe*>(mmap(nullptr, sqesSize_, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, ring_, IORING_OFF_SQES));
+    if (sqes_ == MAP_FAILED) {
+        return false;
+    }
+
+    auto sq = static_cast<char*>(sqRing_);
+    sqHead_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqArray_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    sqMask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sqEntries_ = params.sq_entries;
+
+    auto cq = static_cast<char*>(cqRing_);
+    cqHead_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+    cqMask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqEntries_ = params.cq_entries;
+
+    return true;
+}
+
+/*****************************************************************************/
+
+IoBackend AsyncIo::IoUring::backend() const {
+    return IoBackend::IoUring;
+}
+
+/*****************************************************************************/
+
+void AsyncIo::IoUring::enqueue(Request* request) {
+    std::unique_ptr<Request> owned(request);
+    std::unique_lock<std::mutex> lock(mutex_);
+
+    // Leave room in the completion queue for every request in flight. A
+    // callback queueing more work cannot wait for itself; the kernel holds
+    // any overflow until the completion thread catches up.
+    while (queued_ + inflight_ >= cqEntries_ - 1 && std::this_thread::get_id() != reaper_.get_id()) {
+        checkReaper();
+        submitLocked();
+        idle_.wait(lock);
+    }
+
+    if (queued_ == sqEntries_) {
+        submitLocked();
+    }
+
+    prepare(owned.release());
+
+    if (queued_ >= queueDepth_) {
+        submitLocked();
+    }
+}
+
+/*****************************************************************************/
+
+void AsyncIo::IoUring::prepare(Request* request) {
+    auto tail = *sqTail_;
+    auto index = tail & sqMask_;
+    auto sqe = &sqes_[index];
+
+    // The kernel limits a single read or write to just under 2 GiB; larger
+    // requests complete partially, as they would with pread.
+    auto size = static_cast<unsigned>(std::min<size_t>(request->size, 0x7FFFF000u));
+
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->fd = request->fd;
+    sqe->off = request->offset;
+    sqe->addr = reinterpret_cast<uint64>(request->buffer);
+    sqe->len = size;
+    sqe->user_data = reinterpret_cast<uint64>(request);
+
+    switch (request->op) {
+    case IoOp::Open:
+        sqe->opcode = IORING_OP_OPENAT;
+        sqe->fd = AT_FDCWD;
+        sqe->addr = reinterpret_cast<uint64>(request->path.c_str());
+        sqe->len = static_cast<unsigned>(request->mode);
+        sqe->open_flags = static_cast<unsigned>(request->flags);
+        break;
+    case IoOp::Read:
+        sqe->opcode = IORING_OP_READ;
+        break;
+    case IoOp::Write:
+        sqe->opcode = IORING_OP_WRITE;
+        break;
+    case IoOp::ReadFixed:
+        sqe->opcode = IORING_OP_READ_FIXED;
+        sqe->buf_index = static_cast<uint16>(request->bufferIndex);
+        break;
+    case IoOp::WriteFixed:
+        sqe->opcode = IORING_OP_WRITE_FIXED;
+        sqe->buf_index = static_cast<uint16>(request->bufferIndex);
+        break;
+    case IoOp::Sync:
+    case IoOp::DataSync:
+        sqe->opcode = IORING_OP_FSYNC;
+        sqe->addr = 0;
+        sqe->len = 0;
+        sqe->off = 0;
+        sqe->fsync_flags = request->op == IoOp::DataSync ? IORING_FSYNC_DATASYNC : 0;
+        break;
+    case IoOp::Close:
+        sqe->opcode = IORING_OP_CLOSE;
+        sqe->addr = 0;
+        sqe->len = 0;
+        sqe->off = 0;
+        break;
+    }
+
+    sqArray_[index] = index;
+    __atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+    ++queued_;
+}
+
+/*****************************************************************************/
+
+int32 AsyncIo::IoUring::submit() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return submitLocked();
+}
+
+/*****************************************************************************/
+
+int32 AsyncIo::IoUring::submitLocked() {
+    int32 total = 0;
+
+    while (queued_ > 0) {
+        int submitted = ioUringEnter(ring_, queued_, 0, 0);
+
+        if (submitted < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            OB_THROW("Unable to submit I/O requests: %s", strerror(errno));
+        }
+
+        queued_ -= static_cast<unsigned>(submitted);
+        inflight_ += static_cast<unsigned>(submitted);
+        total += submitted;
+    }
+
+    return total;
+}
+
+/*****************************************************************************/
+
+void AsyncIo::IoUring::drain() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    waitIdle(lock);
+}
+
+/*****************************************************************************/
+
+void AsyncIo::IoUring::registerBuffers(const std::vector<IoBuffer>& buffers) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    waitIdle(lock);
+
+    // Unregistering fails harmlessly when nothing is registered.
+    ioUringRegister(ring_, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+
+    if (buffers.empty()) {
+        return;
+    }
+
+    std::vector<iovec> vectors(buffers.size());
+    for (size_t i = 0; i < buffers.size(); ++i) {
+        vectors[i].iov_base = buffers[i].data;
+        vectors[i].iov_len = buffers[i].size;
+    }
+
+    if (ioUringRegister(ring_, IORING_REGISTER_BUFFERS, vectors.data(),
+            static_cast<unsigned>(vectors.size())) < 0) {
+        OB_THROW("Unable to register buffers: %s", strerror(errno));
+    }
+}
+
+/*****************************************************************************/
+
+void AsyncIo::IoUring::waitIdle(std::unique_lock<std::mutex>& lock) {
+    // Callbacks may queue more requests without submitting them. A callback
+    // runs before its request leaves inflight_, so once nothing is in flight
+    // the queue holds everything left to do.
+    do {
+        checkReaper();
+        submitLocked();
+        idle_.wait(lock, [this] { return inflight_ == 0 || error_ != 0; });
+        checkReaper();
+    } while (queued_ > 0);
+}
+
+/*****************************************************************************/
+
+void AsyncIo::IoUring::checkReaper() const {
+    if (error_ != 0) {
+        OB_THROW("Unable to wait for I/O completions: %s", strerror(error_));
+    }
+}
+
+/*****************************************************************************/
+
+void AsyncIo::IoUring::reap() {
+    for (;;) {
+        if (ioUringEnter(ring_, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+            // Nothing will complete any more, so wake the waiters to report it
+            // rather than letting them wait forever.
+            std::lock_guard<std::mutex> lock(mutex_);
+            error_ = errno;
+            idle_.notify_all();
+            return;
+        }
+
+        auto head = *cqHead_;
+        auto tail = __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE);
+        unsigned completed = 0;
+        bool stop = false;
+
+        while (head != tail) {
+            auto& cqe = cqes_[head & cqMask_];
+            auto request = reinterpret_cast<Request*>(cqe.user_data);
+            auto result = cqe.res;
+
+            // Free the slot before running the callback, which may queue more.
+            __atomic_store_n(cqHead_, ++head, __ATOMIC_RELEASE);
+
+            if (request) {
+                request->complete(result);
+                delete request;
+            } else {
+                stop = true;
+            }
+
+            ++completed;
+        }
+
+        if (completed > 0) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            inflight_ -= completed;
+            idle_.notify_all();
+        }
+
+        if (stop) {
+            return;
+        }
+    }
+}
+
+#endif
+
+/*****************************************************************************/
+
+AsyncIo::AsyncIo(IoBackend backend, int32 queueDepth, int32 threadCount) {
+    if (queueDepth < 1 || queueDepth > 4096) {
+        OB_THROW("Invalid queue depth: %d", queueDepth);
+    }
+
+    if (threadCount < 1) {
+        OB_THROW("Invalid thread count: %d", threadCount);
+    }
+
+#ifdef OB_HAS_IO_URING
+    if (backend != IoBackend::ThreadPool) {
+        impl_.reset(IoUring::create(queueDepth));
+    }
+#endif
+
+    if (!impl_) {
+        if (backend == IoBackend::IoUring) {
+            OB_THROW("io_uring is not available");
+        }
+
+        impl_.reset(new ThreadPool(queueDepth, threadCount));
+    }
+}
+
+/*****************************************************************************/
+
+AsyncIo::~AsyncIo() {
+}
+
+/*****************************************************************************/
+
+IoBackend AsyncIo::backend() const {
+    return impl_->backend();
+}
+
+/*****************************************************************************/
+
+void AsyncIo::enqueue(Request* request) {
+    impl_->enqueue(request);
+}
+
+/*****************************************************************************/
+
+void AsyncIo::open(const std::string& path, int flags, int mode, Callback callback) {
+    auto request = new Request(IoOp::Open, -1, nullptr, 0, 0, std::move(callback));
+    request->path = path;
+    request->flags = flags;
+    request->mode = mode;
+    enqueue(request);
+}
+
+/*****************************************************************************/
+
+void AsyncIo::read(int fd, void* buffer, size_t size, uint64 offset, Callback callback) {
+    enqueue(new Request(IoOp::Read, fd, buffer, size, offset, std::move(callback)));
+}
+
+/*****************************************************************************/
+
+void AsyncIo::write(int fd, const void* buffer, size_t size, uint64 offset, Callback callback) {
+    enqueue(new Request(IoOp::Write, fd, buffer, size, offset, std::move(callback)));
+}
+
+/*****************************************************************************/
+
+void AsyncIo::readFixed(int fd, int32 bufferIndex, void* buffer, size_t size, uint64 offset, Callback callback) {
+    checkFixed(bufferIndex, buffer, size);
+
+    auto request = new Request(IoOp::ReadFixed, fd, buffer, size, offset, std::move(callback));
+    request->bufferIndex = bufferIndex;
+    enqueue(request);
+}
+
+/*****************************************************************************/
+
+void AsyncIo::writeFixed(int fd, int32 bufferIndex, const void* buffer, size_t size, uint64 offset,
+        Callback callback) {
+    checkFixed(bufferIndex, buffer, size);
+
+    auto request = new Request(IoOp::WriteFixed, fd, buffer, size, offset, std::move(callback));
+    request->bufferIndex = bufferIndex;
+    enqueue(request);
+}
+
+/*****************************************************************************/
+
+void AsyncIo::sync(int fd, bool dataOnly, Callback callback) {
+    enqueue(new Request(dataOnly ? IoOp::DataSync : IoOp::Sync, fd, nullptr, 0, 0, std::move(callback)));
+}
+
+/*****************************************************************************/
+
+void AsyncIo::close(int fd, Callback callback) {
+    enqueue(new Request(IoOp::Close, fd, nullptr, 0, 0, std::move(callback)));
+}
+
+/*****************************************************************************/
+
+/**
+ * Makes a callback that fulfils a promise.
+ */
+static AsyncIo::Callback fulfil(const std::shared_ptr<std::promise<int64>>& promise) {
+    return [promise](int64 result) { promise->set_value(result); };
+}
+
+/*****************************************************************************/
+
+std::future<int64> AsyncIo::open(const std::string& path, int flags, int mode) {
+    auto promise = std::make_shared<std::promise<int64>>();
+    open(path, flags, mode, fulfil(promise));
+    return promise->get_future();
+}
+
+/*****************************************************************************/
+
+std::future<int64> AsyncIo::read(int fd, void* buffer, size_t size, uint64 offset) {
+    auto promise = std::make_shared<std::promise<int64>>();
+    read(fd, buffer, size, offset, fulfil(promise));
+    return promise->get_future();
+}
+
+/*****************************************************************************/
+
+std::future<int64> AsyncIo::write(int fd, const void* buffer, size_t size, uint64 offset) {
+    auto promise = std::make_shared<std::promise<int64>>();
+    write(fd, buffer, size, offset, fulfil(promise));
+    return promise->get_future();
+}
+
+/*****************************************************************************/
+
+std::future<int64> AsyncIo::sync(int fd, bool dataOnly) {
+    auto promise = std::make_shared<std::promise<int64>>();
+    sync(fd, dataOnly, fulfil(promise));
+    return promise->get_future();
+}
+
+/*****************************************************************************/
+
+std::future<int64> AsyncIo::close(int fd) {
+    auto promise = std::make_shared<std::promise<int64>>();
+    close(fd, fulfil(promise));
+    return promise->get_future();
+}
+
+/*****************************************************************************/
+
+void AsyncIo::registerBuffers(const std::vector<IoBuffer>& buffers) {
+    impl_->registerBuffers(buffers);
+    buffers_ = buffers;
+}
+
+/*****************************************************************************/
+
+int32 AsyncIo::submit() {
+    return impl_->submit();
+}
+
+/*****************************************************************************/
+
+void AsyncIo::drain() {
+    impl_->drain();
+}
+
+/*****************************************************************************/
+
+void AsyncIo::checkFixed(int32 bufferIndex, const void* buffer, size_t size) const {
+    if (bufferIndex < 0 || static_cast<size_t>(bufferIndex) >= buffers_.size()) {
+        OB_THROW("Invalid registered buffer: %d", bufferIndex);
+    }
+
+    auto& registered = buffers_[bufferIndex];
+    auto start = static_cast<const char*>(registered.data);
+    auto data = static_cast<const char*>(buffer);
+
+    if (data < start || data + size > start + registered.size) {
+        OB_THROW("Buffer is outside registered buffer %d", bufferIndex);
+    }
+}
+
+/*****************************************************************************/
+
+}
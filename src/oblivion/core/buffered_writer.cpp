@@ -0,0 +1,281 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#include <oblivion/core/buffered_writer.h>
+
+#include <cmath>
+#include <cstdio>
+
+#include <oblivion/core/exception.h>
+
+namespace oblivion {
+
+/*****************************************************************************/
+
+const size_t BufferedWriter::DEFAULT_BUFFER_SIZE;
+
+/*****************************************************************************/
+
+/**
+ * The decimal digits of 0 to 99, two characters each.
+ */
+static const char DIGIT_PAIRS[] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+/**
+ * The powers of ten up to the largest supported precision.
+ */
+static const uint64 POWERS_OF_TEN[] = {
+    1ull, 10ull, 100ull, 1000ull, 10000ull, 100000ull,
+    1000000ull, 10000000ull, 100000000ull, 1000000000ull
+};
+
+static const int32 MAX_PRECISION = 9;
+
+/**
+ * The largest magnitude formatted without printf. Its integer part fits in a
+ * uint64 and a double still resolves the requested decimal places.
+ */
+static const double MAX_FAST_DOUBLE = 1e15;
+
+/*****************************************************************************/
+
+/**
+ * Writes an integer in decimal so that it ends just before a position.
+ * @return The first character written.
+ */
+static char* formatDecimal(char* end, uint64 value) {
+    while (value >= 100) {
+        auto pair = static_cast<size_t>(value % 100) * 2;
+        value /= 100;
+        *--end = DIGIT_PAIRS[pair + 1];
+        *--end = DIGIT_PAIRS[pair];
+    }
+
+    if (value >= 10) {
+        auto pair = static_cast<size_t>(value) * 2;
+        *--end = DIGIT_PAIRS[pair + 1];
+        *--end = DIGIT_PAIRS[pair];
+    } else {
+        *--end = static_cast<char>('0' + value);
+    }
+
+    return end;
+}
+
+/*****************************************************************************/
+
+/**
+ * Creates the file for a writer, checking the buffer size first so that an
+ * invalid one leaves no file behind.
+ */
+static File* createFile(const std::string& path, size_t bufferSize) {
+    if (bufferSize == 0) {
+        OB_THROW("Invalid buffer size: %s", path.c_str());
+    }
+
+    return new File(path, "wb");
+}
+
+/*****************************************************************************/
+
+BufferedWriter::BufferedWriter(File& file, size_t bufferSize, FlushPolicy policy)
+    : file_(&file),
+      buffer_(bufferSize),
+      policy_(policy) {
+    if (bufferSize == 0) {
+        OB_THROW("Invalid buffer size");
+    }
+
+    position_ = buffer_.data();
+    end_ = position_ + buffer_.size();
+}
+
+/*****************************************************************************/
+
+BufferedWriter::BufferedWriter(const std::string& path, size_t bufferSize, FlushPolicy policy)
+    : ownedFile_(createFile(path, bufferSize)),
+      file_(ownedFile_.get()),
+      buffer_(bufferSize),
+      policy_(policy) {
+    position_ = buffer_.data();
+    end_ = position_ + buffer_.size();
+}
+
+/*****************************************************************************/
+
+BufferedWriter::~BufferedWriter() {
+    try {
+        flush();
+    } catch (...) {
+    }
+}
+
+/*****************************************************************************/
+
+BufferedWriter& BufferedWriter::append(int value) {
+    return append(static_cast<long long>(value));
+}
+
+/*****************************************************************************/
+
+BufferedWriter& BufferedWriter::append(long value) {
+    return append(static_cast<long long>(value));
+}
+
+/*****************************************************************************/
+
+BufferedWriter& BufferedWriter::append(long long value) {
+    char text[24];
+    auto end = text + sizeof(text);
+
+    // Negate as unsigned so that the smallest value does not overflow.
+    auto magnitude = static_cast<uint64>(value);
+    auto start = formatDecimal(end, value < 0 ? 0 - magnitude : magnitude);
+
+    if (value < 0) {
+        *--start = '-';
+    }
+
+    return append(start, static_cast<size_t>(end - start));
+}
+
+/*****************************************************************************/
+
+BufferedWriter& BufferedWriter::append(unsigned int value) {
+    return append(static_cast<unsigned long long>(value));
+}
+
+/*****************************************************************************/
+
+BufferedWriter& BufferedWriter::append(unsigned long value) {
+    return append(static_cast<unsigned long long>(value));
+}
+
+/*****************************************************************************/
+
+BufferedWriter& BufferedWriter::append(unsigned long long value) {
+    char text[24];
+    auto end = text + sizeof(text);
+    auto start = formatDecimal(end, value);
+    return append(start, static_cast<size_t>(end - start));
+}
+
+/*****************************************************************************/
+
+BufferedWriter& BufferedWriter::append(double value, int32 precision) {
+    if (precision < 0 || precision > MAX_PRECISION) {
+        OB_THROW("Invalid precision: %d", precision);
+    }
+
+    auto magnitude = std::fabs(value);
+
+    if (!(magnitude < MAX_FAST_DOUBLE)) {
+        // Infinity, NaN and huge values, where printf's exact expansion matters.
+        char text[512];
+        auto size = snprintf(text, sizeof(text), "%.*f", precision, value);
+        return append(text, static_cast<size_t>(size));
+    }
+
+    auto scale = POWERS_OF_TEN[precision];
+    auto integer = static_cast<uint64>(magnitude);
+    auto fraction = static_cast<uint64>((magnitude - static_cast<double>(integer)) *
+        static_cast<double>(scale) + 0.5);
+
+    if (fraction >= scale) {
+        ++integer;
+        fraction -= scale;
+    }
+
+    char text[48];
+    auto end = text + sizeof(text);
+    auto start = end;
+
+    if (precision > 0) {
+        start = formatDecimal(end, fraction);
+        while (end - start < precision) {
+            *--start = '0';
+        }
+
+        *--start = '.';
+    }
+
+    start = formatDecimal(start, integer);
+
+    // Like printf, keep the sign of negative values that round to zero.
+    if (std::signbit(value)) {
+        *--start = '-';
+    }
+
+    return append(start, static_cast<size_t>(end - start));
+}
+
+/*****************************************************************************/
+
+BufferedWriter& BufferedWriter::appendLine(const std::string& line) {
+    append(line);
+    return newline();
+}
+
+/*****************************************************************************/
+
+BufferedWriter& BufferedWriter::newline() {
+    append('\n');
+
+    if (policy_ == FlushPolicy::EveryLine) {
+        flush();
+    }
+
+    return *this;
+}
+
+/*****************************************************************************/
+
+void BufferedWriter::flush(bool sync) {
+    flushBuffer();
+    file_->flush();
+
+    if (sync) {
+        file_->sync();
+    }
+}
+
+/*****************************************************************************/
+
+BufferedWriter& BufferedWriter::appendSlow(const char* data, size_t size) {
+    flushBuffer();
+
+    if (size >= buffer_.size()) {
+        // Copying a block this large would only split it into more writes.
+        file_->write(size, const_cast<char*>(data));
+        return *this;
+    }
+
+    memcpy(position_, data, size);
+    position_ += size;
+    return *this;
+}
+
+/*****************************************************************************/
+
+void BufferedWriter::flushBuffer() {
+    auto size = buffered();
+    if (size == 0) {
+        return;
+    }
+
+    file_->write(size, buffer_.data());
+    position_ = buffer_.data();
+}
+
+/*****************************************************************************/
+
+}
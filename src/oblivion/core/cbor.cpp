@@ -0,0 +1,525 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#include <oblivion/core/cbor.h>
+
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#include <oblivion/core/exception.h>
+#include <oblivion/core/file.h>
+#include <oblivion/core/variant.h>
+
+namespace oblivion {
+
+/*****************************************************************************/
+
+const uint8 CBOR_UNSIGNED = 0;
+const uint8 CBOR_NEGATIVE = 1;
+const uint8 CBOR_BYTES = 2;
+const uint8 CBOR_TEXT = 3;
+const uint8 CBOR_ARRAY = 4;
+const uint8 CBOR_MAP = 5;
+const uint8 CBOR_TAG = 6;
+const uint8 CBOR_SIMPLE = 7;
+
+const uint8 CBOR_INDEFINITE = 31;
+const uint8 CBOR_BREAK = 0xff;
+
+/**
+ * Output is handed to the file once this much has been buffered.
+ */
+const size_t CBOR_FILE_BUFFER_SIZE = 64 * 1024;
+
+/*****************************************************************************/
+
+static real64 halfToReal(uint16 half) {
+    auto exponent = (half >> 10) & 0x1f;
+    auto mantissa = half & 0x3ff;
+
+    real64 result;
+    if (exponent == 0) {
+        result = std::ldexp(mantissa, -24);
+    } else if (exponent != 31) {
+        result = std::ldexp(mantissa + 1024, exponent - 25);
+    } else {
+        result = mantissa == 0 ? std::numeric_limits<real64>::infinity() : std::numeric_limits<real64>::quiet_NaN();
+    }
+
+    return (half & 0x8000) ? -result : result;
+}
+
+/*****************************************************************************/
+
+CborWriter::CborWriter(std::string& buffer)
+    : buffer_(&buffer),
+      file_(nullptr) {
+}
+
+/*****************************************************************************/
+
+CborWriter::CborWriter(File& file)
+    : buffer_(nullptr),
+      file_(&file) {
+
+    pending_.reserve(CBOR_FILE_BUFFER_SIZE);
+}
+
+/*****************************************************************************/
+
+CborWriter::~CborWriter() {
+    try {
+        flush();
+    } catch (...) {
+    }
+}
+
+/*****************************************************************************/
+
+void CborWriter::writeNull() {
+    writeHead(CBOR_SIMPLE, 22);
+}
+
+/*****************************************************************************/
+
+void CborWriter::writeBool(bool value) {
+    writeHead(CBOR_SIMPLE, value ? 21 : 20);
+}
+
+/*****************************************************************************/
+
+void CborWriter::writeInt(int64 value) {
+    if (value >= 0) {
+        writeHead(CBOR_UNSIGNED, static_cast<uint64>(value));
+    } else {
+        writeHead(CBOR_NEGATIVE, static_cast<uint64>(-(value + 1)));
+    }
+}
+
+/*****************************************************************************/
+
+void CborWriter::writeReal(real64 value) {
+    // Narrowing a finite value that float cannot hold is undefined, so only
+    // values within its range are tried in single precision.
+    auto narrow = !std::isfinite(value) || std::fabs(value) <= std::numeric_limits<real32>::max();
+    auto single = narrow ? static_cast<real32>(value) : 0.0f;
+
+    if (narrow && single == value) {
+        uint32 bits;
+        std::memcpy(&bits, &single, sizeof(bits));
+
+        uint8 bytes[] = {
+            0xfa,
+            static_cast<uint8>(bits >> 24),
+            static_cast<uint8>(bits >> 16),
+            static_cast<uint8>(bits >> 8),
+            static_cast<uint8>(bits)
+        };
+        append(bytes, sizeof(bytes));
+    } else {
+        uint64 bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+
+        uint8 bytes[9];
+        bytes[0] = 0xfb;
+        for (auto i = 0; i < 8; ++i) {
+            bytes[i + 1] = static_cast<uint8>(bits >> (56 - i * 8));
+        }
+
+        append(bytes, sizeof(bytes));
+    }
+}
+
+/*****************************************************************************/
+
+void CborWriter::writeString(const char* data, size_t size) {
+    writeHead(CBOR_TEXT, size);
+    append(data, size);
+}
+
+/*****************************************************************************/
+
+void CborWriter::writeString(const std::string& value) {
+    writeString(value.data(), value.size());
+}
+
+/*****************************************************************************/
+
+void CborWriter::beginArray() {
+    uint8 head = (CBOR_ARRAY << 5) | CBOR_INDEFINITE;
+    append(&head, 1);
+}
+
+/*****************************************************************************/
+
+void CborWriter::beginArray(uint64 size) {
+    writeHead(CBOR_ARRAY, size);
+}
+
+/*****************************************************************************/
+
+void CborWriter::beginMap() {
+    uint8 head = (CBOR_MAP << 5) | CBOR_INDEFINITE;
+    append(&head, 1);
+}
+
+/*****************************************************************************/
+
+void CborWriter::beginMap(uint64 size) {
+    writeHead(CBOR_MAP, size);
+}
+
+/*****************************************************************************/
+
+void CborWriter::end() {
+    append(&CBOR_BREAK, 1);
+}
+
+/*****************************************************************************/
+
+void CborWriter::write(const Variant& variant) {
+    switch (variant.type()) {
+    case VariantType::Null:
+        writeNull();
+        break;
+    case VariantType::Integer:
+        writeInt(variant.intValue());
+        break;
+    case VariantType::Real:
+        writeReal(variant.realValue());
+        break;
+    case VariantType::Bool:
+        writeBool(variant.boolValue());
+        break;
+    case VariantType::String:
+        writeString(variant.stringValue());
+        break;
+    case VariantType::Array:
+        beginArray(variant.size());
+        for (auto i = 0; i < variant.size(); ++i) {
+            write(variant[i]);
+        }
+        break;
+    case VariantType::Map:
+        beginMap(variant.size());
+        for (auto& key : variant.mapKeys()) {
+            writeString(key);
+            write(variant[key]);
+        }
+        break;
+    }
+}
+
+/*****************************************************************************/
+
+void CborWriter::flush() {
+    if (file_ && !pending_.empty()) {
+        file_->write(pending_.size(), &pending_[0]);
+        pending_.clear();
+    }
+}
+
+/*****************************************************************************/
+
+void CborWriter::writeHead(uint8 majorType, uint64 value) {
+    uint8 bytes[9];
+    size_t argumentSize;
+
+    if (value < 24) {
+        bytes[0] = static_cast<uint8>((majorType << 5) | value);
+        argumentSize = 0;
+    } else if (value <= 0xff) {
+        bytes[0] = (majorType << 5) | 24;
+        argumentSize = 1;
+    } else if (value <= 0xffff) {
+        bytes[0] = (majorType << 5) | 25;
+        argumentSize = 2;
+    } else if (value <= 0xffffffff) {
+        bytes[0] = (majorType << 5) | 26;
+        argumentSize = 4;
+    } else {
+        bytes[0] = (majorType << 5) | 27;
+        argumentSize = 8;
+    }
+
+    for (auto i = 0u; i < argumentSize; ++i) {
+        bytes[i + 1] = static_cast<uint8>(value >> ((argumentSize - i - 1) * 8));
+    }
+
+    append(bytes, argumentSize + 1);
+}
+
+/*****************************************************************************/
+
+void CborWriter::append(const void* data, size_t size) {
+    if (buffer_) {
+        buffer_->append(static_cast<const char*>(data), size);
+        return;
+    }
+
+    if (pending_.size() + size > CBOR_FILE_BUFFER_SIZE) {
+        flush();
+    }
+
+    if (size >= CBOR_FILE_BUFFER_SIZE) {
+        file_->write(size, const_cast<void*>(data));
+    } else {
+        pending_.append(static_cast<const char*>(data), size);
+    }
+}
+
+/*****************************************************************************/
+
+CborReader::CborReader(const void* data, size_t size)
+    : data_(static_cast<const uint8*>(data)),
+      size_(size),
+      position_(0),
+      bool_(false),
+      int_(0),
+      real_(0),
+      string_(nullptr),
+      stringSize_(0) {
+}
+
+/*****************************************************************************/
+
+CborToken CborReader::next() {
+    if (!remaining_.empty() && remaining_.back() == 0) {
+        remaining_.pop_back();
+        return CborToken::End;
+    }
+
+    if (position_ == size_) {
+        if (!remaining_.empty()) {
+            OB_THROW("Truncated CBOR data");
+        }
+
+        return CborToken::EndOfInput;
+    }
+
+    auto initial = readByte();
+    bool tagged = false;
+
+    // Tags are skipped in a loop rather than by recursion, so a long run of
+    // them cannot exhaust the stack. Each must be followed by a data item.
+    while (initial >> 5 == CBOR_TAG) {
+        readArgument(initial & 0x1f);
+        initial = readByte();
+        tagged = true;
+    }
+
+    if (initial == CBOR_BREAK) {
+        if (tagged || remaining_.empty() || remaining_.back() != -1) {
+            OB_THROW("Unexpected CBOR break at offset %d", static_cast<int32>(position_ - 1));
+        }
+
+        remaining_.pop_back();
+        return CborToken::End;
+    }
+
+    uint8 majorType = initial >> 5;
+    uint8 info = initial & 0x1f;
+
+    if (!remaining_.empty() && remaining_.back() > 0) {
+        --remaining_.back();
+    }
+
+    const auto maxInt = static_cast<uint64>(std::numeric_limits<int64>::max());
+
+    switch (majorType) {
+    case CBOR_UNSIGNED: {
+        auto value = readArgument(info);
+        if (value > maxInt) {
+            real_ = static_cast<real64>(value);
+            return CborToken::Real;
+        }
+
+        int_ = static_cast<int64>(value);
+        return CborToken::Integer;
+    }
+    case CBOR_NEGATIVE: {
+        auto value = readArgument(info);
+        if (value > maxInt) {
+            real_ = -1.0 - static_cast<real64>(value);
+            return CborToken::Real;
+        }
+
+        int_ = -1 - static_cast<int64>(value);
+        return CborToken::Integer;
+    }
+    case CBOR_BYTES:
+    case CBOR_TEXT:
+        if (info == CBOR_INDEFINITE) {
+            readChunkedString(majorType);
+        } else {
+            auto size = readArgument(info);
+            string_ = reinterpret_cast<const char*>(readBytes(size));
+            stringSize_ = size;
+        }
+
+        return CborToken::String;
+    case CBOR_ARRAY:
+    case CBOR_MAP: {
+        if (info == CBOR_INDEFINITE) {
+            int_ = -1;
+            remaining_.push_back(-1);
+        } else {
+            auto size = readArgument(info);
+            if (size > maxInt / 2) {
+                OB_THROW("CBOR container too large");
+            }
+
+            int_ = static_cast<int64>(size);
+            remaining_.push_back(majorType == CBOR_MAP ? int_ * 2 : int_);
+        }
+
+        return majorType == CBOR_MAP ? CborToken::MapBegin : CborToken::ArrayBegin;
+    }
+    default:
+        break;
+    }
+
+    switch (info) {
+    case 20:
+    case 21:
+        bool_ = info == 21;
+        return CborToken::Bool;
+    case 22:
+    case 23:
+        return CborToken::Null;
+    case 25:
+        real_ = halfToReal(static_cast<uint16>(readArgument(info)));
+        return CborToken::Real;
+    case 26: {
+        auto bits = static_cast<uint32>(readArgument(info));
+        real32 value;
+        std::memcpy(&value, &bits, sizeof(value));
+
+        real_ = value;
+        return CborToken::Real;
+    }
+    case 27: {
+        auto bits = readArgument(info);
+        std::memcpy(&real_, &bits, sizeof(real_));
+
+        return CborToken::Real;
+    }
+    default:
+        OB_THROW("Unsupported CBOR simple value: %d", static_cast<int32>(info));
+    }
+}
+
+/*****************************************************************************/
+
+bool CborReader::boolValue() const {
+    return bool_;
+}
+
+/*****************************************************************************/
+
+int64 CborReader::intValue() const {
+    return int_;
+}
+
+/*****************************************************************************/
+
+real64 CborReader::realValue() const {
+    return real_;
+}
+
+/*****************************************************************************/
+
+const char* CborReader::stringData() const {
+    return string_;
+}
+
+/*****************************************************************************/
+
+size_t CborReader::stringSize() const {
+    return stringSize_;
+}
+
+/*****************************************************************************/
+
+int64 CborReader::containerSize() const {
+    return int_;
+}
+
+/*****************************************************************************/
+
+size_t CborReader::position() const {
+    return position_;
+}
+
+/*****************************************************************************/
+
+uint8 CborReader::readByte() {
+    return *readBytes(1);
+}
+
+/*****************************************************************************/
+
+uint64 CborReader::readArgument(uint8 info) {
+    if (info < 24) {
+        return info;
+    }
+
+    size_t size;
+    switch (info) {
+    case 24: size = 1; break;
+    case 25: size = 2; break;
+    case 26: size = 4; break;
+    case 27: size = 8; break;
+    default:
+        OB_THROW("Invalid CBOR argument: %d", static_cast<int32>(info));
+    }
+
+    auto bytes = readBytes(size);
+
+    uint64 result = 0;
+    for (auto i = 0u; i < size; ++i) {
+        result = (result << 8) | bytes[i];
+    }
+
+    return result;
+}
+
+/*****************************************************************************/
+
+const uint8* CborReader::readBytes(size_t size) {
+    if (size > size_ - position_) {
+        OB_THROW("Truncated CBOR data");
+    }
+
+    auto result = data_ + position_;
+    position_ += size;
+
+    return result;
+}
+
+/*****************************************************************************/
+
+void CborReader::readChunkedString(uint8 majorType) {
+    chunks_.clear();
+
+    for (;;) {
+        auto initial = readByte();
+        if (initial == CBOR_BREAK) {
+            break;
+        }
+
+        if ((initial >> 5) != majorType || (initial & 0x1f) == CBOR_INDEFINITE) {
+            OB_THROW("Invalid CBOR string chunk");
+        }
+
+        auto size = readArgument(initial & 0x1f);
+        chunks_.append(reinterpret_cast<const char*>(readBytes(size)), size);
+    }
+
+    string_ = chunks_.data();
+    stringSize_ = chunks_.size();
+}
+
+/*****************************************************************************/
+
+}
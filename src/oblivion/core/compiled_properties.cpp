@@ -0,0 +1,378 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#include <oblivion/core/compiled_properties.h>
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include <oblivion/core/exception.h>
+#include <oblivion/core/file_util.h>
+
+namespace oblivion {
+
+/*****************************************************************************/
+
+struct CompiledProperties::Header {
+
+    char magic[8];
+
+    uint32 byteOrder;
+
+    uint32 version;
+
+    uint32 count;
+
+    uint32 bucketCount;
+
+    uint64 stringsSize;
+
+};
+
+/*****************************************************************************/
+
+struct CompiledProperties::Entry {
+
+    uint32 nameOffset;
+
+    uint32 nameSize;
+
+    uint32 valueOffset;
+
+    uint32 valueSize;
+
+};
+
+/*****************************************************************************/
+
+static const char MAGIC[8] = { 'O', 'B', 'P', 'R', 'O', 'P', 'S', '\0' };
+
+static const uint32 BYTE_ORDER_MARK = 0x01020304;
+
+static const uint32 VERSION = 1;
+
+/**
+ * Marks a displacement that holds the slot of a single-name bucket directly.
+ */
+static const uint32 DIRECT_SLOT = 0x80000000u;
+
+/**
+ * The number of displacements to try for a bucket before giving up.
+ */
+static const uint32 MAX_DISPLACEMENT = 1u << 24;
+
+/*****************************************************************************/
+
+static inline uint64 hashName(const char* name, size_t size) {
+    uint64 hash = 14695981039346656037ull;
+
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<uint8>(name[i]);
+        hash *= 1099511628211ull;
+    }
+
+    return hash;
+}
+
+/*****************************************************************************/
+
+static inline uint32 slotFor(uint64 hash, uint32 displacement, uint32 count) {
+    if (displacement & DIRECT_SLOT) {
+        return displacement & ~DIRECT_SLOT;
+    }
+
+    uint64 x = hash + displacement * 0x9E3779B97F4A7C15ull;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+    x ^= x >> 31;
+
+    return static_cast<uint32>(x % count);
+}
+
+/*****************************************************************************/
+
+void CompiledProperties::compile(const Properties& properties, const std::string& path) {
+    auto count = static_cast<uint32>(properties.size());
+    auto bucketCount = count / 4 + 1;
+
+    std::vector<Entry> entries;
+    std::vector<uint64> hashes;
+    std::string strings;
+
+    entries.reserve(count);
+    hashes.reserve(count);
+
+    for (auto& property : properties.view("")) {
+        auto& name = property.first;
+        auto& value = property.second;
+
+        if (strings.size() + name.size() + value.size() + 2 > 0xFFFFFFFFu) {
+            OB_THROW("Properties are too large to compile");
+        }
+
+        Entry entry;
+        entry.nameOffset = static_cast<uint32>(strings.size());
+        entry.nameSize = static_cast<uint32>(name.size());
+        strings.append(name.c_str(), name.size() + 1);
+
+        entry.valueOffset = static_cast<uint32>(strings.size());
+        entry.valueSize = static_cast<uint32>(value.size());
+        strings.append(value.c_str(), value.size() + 1);
+
+        entries.push_back(entry);
+        hashes.push_back(hashName(name.data(), name.size()));
+    }
+
+    // Build a minimal perfect hash by hash and displace: place the largest
+    // buckets first, searching for a displacement that sends every name in
+    // the bucket to a free slot. Single-name buckets take a free slot directly.
+    std::vector<std::vector<uint32>> buckets(bucketCount);
+    for (uint32 i = 0; i < count; ++i) {
+        buckets[hashes[i] % bucketCount].push_back(i);
+    }
+
+    std::vector<uint32> order(bucketCount);
+    for (uint32 i = 0; i < bucketCount; ++i) {
+        order[i] = i;
+    }
+
+    std::stable_sort(order.begin(), order.end(), [&](uint32 a, uint32 b) {
+        return buckets[a].size() > buckets[b].size();
+    });
+
+    std::vector<uint32> displacements(bucketCount, 0);
+    std::vector<uint32> slots(count, 0);
+    std::vector<bool> used(count, false);
+    std::vector<uint32> candidate;
+    uint32 nextFree = 0;
+
+    for (auto bucketIndex : order) {
+        auto& bucket = buckets[bucketIndex];
+
+        if (bucket.empty()) {
+            break;
+        }
+
+        if (bucket.size() == 1) {
+            while (used[nextFree]) {
+                ++nextFree;
+            }
+
+            used[nextFree] = true;
+            slots[nextFree] = bucket[0];
+            displacements[bucketIndex] = DIRECT_SLOT | nextFree;
+            continue;
+        }
+
+        uint32 displacement = 0;
+        for (; displacement < MAX_DISPLACEMENT; ++displacement) {
+            candidate.clear();
+
+            bool placed = true;
+            for (auto entryIndex : bucket) {
+                auto slot = slotFor(hashes[entryIndex], displacement, count);
+                if (used[slot] || std::find(candidate.begin(), candidate.end(), slot) != candidate.end()) {
+                    placed = false;
+                    break;
+                }
+
+                candidate.push_back(slot);
+            }
+
+            if (placed) {
+                break;
+            }
+        }
+
+        if (displacement == MAX_DISPLACEMENT) {
+            OB_THROW("Unable to build a perfect hash for %s", path.c_str());
+        }
+
+        for (size_t i = 0; i < bucket.size(); ++i) {
+            used[candidate[i]] = true;
+            slots[candidate[i]] = bucket[i];
+        }
+
+        displacements[bucketIndex] = displacement;
+    }
+
+    Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.byteOrder = BYTE_ORDER_MARK;
+    header.version = VERSION;
+    header.count = count;
+    header.bucketCount = bucketCount;
+    header.stringsSize = strings.size();
+
+    std::string contents;
+    contents.reserve(sizeof(Header) + sizeof(uint32) * (bucketCount + count) +
+        sizeof(Entry) * count + strings.size());
+
+    contents.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    contents.append(reinterpret_cast<const char*>(displacements.data()), sizeof(uint32) * bucketCount);
+    contents.append(reinterpret_cast<const char*>(slots.data()), sizeof(uint32) * count);
+    contents.append(reinterpret_cast<const char*>(entries.data()), sizeof(Entry) * count);
+    contents.append(strings);
+
+    // Readers map the file, so it is never rewritten in place: truncating it
+    // would fault every live mapping. The new file replaces it by rename and
+    // existing readers keep the old one until they reopen.
+    auto temporary = path + ".tmp";
+
+    try {
+        FileUtil::writeAll(temporary, contents, true);
+    } catch (...) {
+        if (FileUtil::exists(temporary)) {
+            FileUtil::remove(temporary);
+        }
+
+        throw;
+    }
+
+    FileUtil::rename(temporary, path);
+}
+
+/*****************************************************************************/
+
+CompiledProperties::CompiledProperties(const std::string& path)
+    : file_(path) {
+    attach();
+}
+
+/*****************************************************************************/
+
+void CompiledProperties::attach() {
+    auto data = file_.data();
+    auto size = file_.size();
+
+    if (size < sizeof(Header)) {
+        OB_THROW("Invalid compiled properties: truncated header");
+    }
+
+    header_ = reinterpret_cast<const Header*>(data);
+
+    if (memcmp(header_->magic, MAGIC, sizeof(MAGIC)) != 0) {
+        OB_THROW("Invalid compiled properties: bad magic");
+    }
+
+    if (header_->byteOrder != BYTE_ORDER_MARK) {
+        OB_THROW("Invalid compiled properties: compiled with a different byte order");
+    }
+
+    if (header_->version != VERSION) {
+        OB_THROW("Invalid compiled properties: unsupported version %u", header_->version);
+    }
+
+    uint64 count = header_->count;
+    uint64 bucketCount = header_->bucketCount;
+    uint64 expected = sizeof(Header) + sizeof(uint32) * (bucketCount + count) +
+        sizeof(Entry) * count + header_->stringsSize;
+
+    if (bucketCount == 0 || header_->stringsSize > size || expected != size) {
+        OB_THROW("Invalid compiled properties: size mismatch");
+    }
+
+    displacements_ = reinterpret_cast<const uint32*>(data + sizeof(Header));
+    slots_ = displacements_ + bucketCount;
+    entries_ = reinterpret_cast<const Entry*>(slots_ + count);
+    strings_ = reinterpret_cast<const char*>(entries_ + count);
+
+    // Check the tables so a lookup can never read outside the mapping. The
+    // string blob itself is only paged in as it is used.
+    auto stringsSize = header_->stringsSize;
+    if (stringsSize > 0 && strings_[stringsSize - 1] != '\0') {
+        OB_THROW("Invalid compiled properties: unterminated strings");
+    }
+
+    for (uint64 i = 0; i < bucketCount; ++i) {
+        auto displacement = displacements_[i];
+        if ((displacement & DIRECT_SLOT) && (displacement & ~DIRECT_SLOT) >= count) {
+            OB_THROW("Invalid compiled properties: bad displacement");
+        }
+    }
+
+    for (uint64 i = 0; i < count; ++i) {
+        auto& entry = entries_[i];
+
+        if (slots_[i] >= count ||
+            uint64(entry.nameOffset) + entry.nameSize >= stringsSize ||
+            uint64(entry.valueOffset) + entry.valueSize >= stringsSize) {
+            OB_THROW("Invalid compiled properties: bad entry");
+        }
+    }
+}
+
+/*****************************************************************************/
+
+const char* CompiledProperties::find(const char* name, size_t size) const {
+    auto count = header_->count;
+    if (count == 0) {
+        return nullptr;
+    }
+
+    auto hash = hashName(name, size);
+    auto slot = slotFor(hash, displacements_[hash % header_->bucketCount], count);
+    auto& entry = entries_[slots_[slot]];
+
+    if (entry.nameSize != size || memcmp(strings_ + entry.nameOffset, name, size) != 0) {
+        return nullptr;
+    }
+
+    return strings_ + entry.valueOffset;
+}
+
+/*****************************************************************************/
+
+const char* CompiledProperties::find(const std::string& name) const {
+    return find(name.data(), name.size());
+}
+
+/*****************************************************************************/
+
+bool CompiledProperties::contains(const std::string& name) const {
+    return find(name) != nullptr;
+}
+
+/*****************************************************************************/
+
+std::string CompiledProperties::getProperty(const std::string& name) const {
+    auto value = find(name);
+    return value ? std::string(value) : std::string();
+}
+
+/*****************************************************************************/
+
+int32 CompiledProperties::size() const {
+    return static_cast<int32>(header_->count);
+}
+
+/*****************************************************************************/
+
+const char* CompiledProperties::name(int32 index) const {
+    return strings_ + entries_[index].nameOffset;
+}
+
+/*****************************************************************************/
+
+const char* CompiledProperties::value(int32 index) const {
+    return strings_ + entries_[index].valueOffset;
+}
+
+/*****************************************************************************/
+
+Properties CompiledProperties::toProperties() const {
+    Properties result;
+
+    for (int32 i = 0; i < size(); ++i) {
+        auto& entry = entries_[i];
+        result.setProperty(std::string(strings_ + entry.nameOffset, entry.nameSize),
+            std::string(strings_ + entry.valueOffset, entry.valueSize));
+    }
+
+    return result;
+}
+
+/*****************************************************************************/
+
+}
@@ -0,0 +1,218 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#include <oblivion/core/compressed_reader.h>
+
+#include <algorithm>
+#include <cstring>
+
+#include <oblivion/core/compressed_format.h>
+#include <oblivion/core/exception.h>
+#include <oblivion/core/lz4.h>
+
+namespace oblivion {
+
+/*****************************************************************************/
+
+static uint32 load32(const char* in) {
+    auto bytes = reinterpret_cast<const uint8*>(in);
+    return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (static_cast<uint32>(bytes[3]) << 24);
+}
+
+/*****************************************************************************/
+
+static uint64 load64(const char* in) {
+    return load32(in) | (static_cast<uint64>(load32(in + 4)) << 32);
+}
+
+/*****************************************************************************/
+
+CompressedReader::CompressedReader(const std::string& path)
+    : path_(path),
+      file_(path, "rb"),
+      size_(0),
+      position_(0),
+      cached_(static_cast<size_t>(-1)) {
+    auto fileSize = file_.size();
+    if (fileSize < CompressedFormat::HEADER_SIZE + CompressedFormat::FOOTER_SIZE) {
+        OB_THROW("Not a compressed file: %s", path.c_str());
+    }
+
+    char header[CompressedFormat::HEADER_SIZE];
+    char footer[CompressedFormat::FOOTER_SIZE];
+
+    if (file_.readAt(0, sizeof(header), header) != sizeof(header) ||
+        file_.readAt(fileSize - sizeof(footer), sizeof(footer), footer) != sizeof(footer)) {
+        OB_THROW("Unable to read compressed file: %s", path.c_str());
+    }
+
+    if (load32(header) != CompressedFormat::MAGIC || load32(footer + 28) != CompressedFormat::MAGIC) {
+        OB_THROW("Not a compressed file, or not closed: %s", path.c_str());
+    }
+
+    if (load32(header + 4) != CompressedFormat::VERSION) {
+        OB_THROW("Unsupported compressed file version %u: %s", load32(header + 4), path.c_str());
+    }
+
+    auto blockSize = load32(header + 8);
+    auto indexOffset = load64(footer);
+    auto blockCount = load64(footer + 8);
+    size_ = load64(footer + 16);
+
+    auto indexEnd = fileSize - CompressedFormat::FOOTER_SIZE;
+    if (indexOffset < CompressedFormat::HEADER_SIZE || indexOffset > indexEnd ||
+        blockCount != (indexEnd - indexOffset) / CompressedFormat::INDEX_ENTRY_SIZE ||
+        (indexEnd - indexOffset) % CompressedFormat::INDEX_ENTRY_SIZE != 0 ||
+        blockSize > CompressedFormat::MAX_BLOCK_SIZE) {
+        OB_THROW("Corrupt compressed file index: %s", path.c_str());
+    }
+
+    std::vector<char> index(static_cast<size_t>(indexEnd - indexOffset));
+    if (!index.empty() && file_.readAt(indexOffset, index.size(), &index[0]) != index.size()) {
+        OB_THROW("Unable to read compressed file: %s", path.c_str());
+    }
+
+    blocks_.resize(static_cast<size_t>(blockCount));
+    uint64 rawOffset = 0;
+
+    for (size_t i = 0; i < blocks_.size(); ++i) {
+        auto entry = &index[i * CompressedFormat::INDEX_ENTRY_SIZE];
+        auto& block = blocks_[i];
+
+        block.offset = load64(entry);
+        block.storedSize = load32(entry + 8) & ~CompressedFormat::STORED_FLAG;
+        block.stored = (load32(entry + 8) & CompressedFormat::STORED_FLAG) != 0;
+        block.rawSize = load32(entry + 12);
+        block.rawOffset = rawOffset;
+
+        if (block.rawSize == 0 || block.rawSize > blockSize || block.offset < CompressedFormat::HEADER_SIZE ||
+            block.offset > indexOffset ||
+            indexOffset - block.offset < CompressedFormat::BLOCK_HEADER_SIZE + block.storedSize ||
+            (block.stored && block.storedSize != block.rawSize)) {
+            OB_THROW("Corrupt compressed file index: %s", path.c_str());
+        }
+
+        rawOffset += block.rawSize;
+    }
+
+    if (rawOffset != size_) {
+        OB_THROW("Corrupt compressed file index: %s", path.c_str());
+    }
+}
+
+/*****************************************************************************/
+
+size_t CompressedReader::read(size_t size, void* out) {
+    auto count = readAt(position_, size, out);
+    position_ += count;
+    return count;
+}
+
+/*****************************************************************************/
+
+size_t CompressedReader::readAt(uint64 offset, size_t size, void* out) {
+    if (offset >= size_) {
+        return 0;
+    }
+
+    size = static_cast<size_t>(std::min<uint64>(size, size_ - offset));
+
+    auto next = std::upper_bound(blocks_.begin(), blocks_.end(), offset,
+        [](uint64 value, const Block& block) { return value < block.rawOffset; });
+    auto index = static_cast<size_t>(next - blocks_.begin()) - 1;
+
+    auto target = static_cast<char*>(out);
+    size_t done = 0;
+
+    while (done < size) {
+        auto& block = blocks_[index];
+        auto skip = static_cast<size_t>(offset + done - block.rawOffset);
+        auto count = std::min<size_t>(block.rawSize - skip, size - done);
+
+        // Whole blocks are decompressed straight into the caller's buffer.
+        if (count == block.rawSize && cached_ != index) {
+            decompress(index, target + done);
+        } else {
+            memcpy(target + done, load(index) + skip, count);
+        }
+
+        done += count;
+        ++index;
+    }
+
+    return size;
+}
+
+/*****************************************************************************/
+
+std::string CompressedReader::readAll() {
+    std::string result(static_cast<size_t>(size_), '\0');
+    if (!result.empty()) {
+        readAt(0, result.size(), &result[0]);
+    }
+
+    return result;
+}
+
+/*****************************************************************************/
+
+void CompressedReader::seek(uint64 offset) {
+    position_ = offset;
+}
+
+/*****************************************************************************/
+
+void CompressedReader::decompress(size_t index, char* out) {
+    auto& block = blocks_[index];
+
+    if (block.stored) {
+        auto offset = block.offset + CompressedFormat::BLOCK_HEADER_SIZE;
+        if (file_.readAt(offset, block.rawSize, out) != block.rawSize) {
+            OB_THROW("Unable to read compressed file: %s", path_.c_str());
+        }
+
+        return;
+    }
+
+    auto size = CompressedFormat::BLOCK_HEADER_SIZE + block.storedSize;
+    packed_.resize(size);
+
+    if (file_.readAt(block.offset, size, &packed_[0]) != size) {
+        OB_THROW("Unable to read compressed file: %s", path_.c_str());
+    }
+
+    // The header repeats the index entry, which catches a misplaced index.
+    if (load32(&packed_[0]) != block.storedSize || load32(&packed_[4]) != block.rawSize) {
+        OB_THROW("Corrupt compressed file block %llu: %s", static_cast<unsigned long long>(index), path_.c_str());
+    }
+
+    try {
+        auto count = Lz4::decompress(&packed_[CompressedFormat::BLOCK_HEADER_SIZE], block.storedSize,
+            out, block.rawSize);
+
+        if (count == block.rawSize) {
+            return;
+        }
+    } catch (const Exception&) {
+    }
+
+    OB_THROW("Corrupt compressed file block %llu: %s", static_cast<unsigned long long>(index), path_.c_str());
+}
+
+/*****************************************************************************/
+
+const char* CompressedReader::load(size_t index) {
+    if (cached_ != index) {
+        // Forget the old block first, so a failed read cannot leave it marked as cached.
+        cached_ = static_cast<size_t>(-1);
+
+        cache_.resize(blocks_[index].rawSize);
+        decompress(index, &cache_[0]);
+        cached_ = index;
+    }
+
+    return &cache_[0];
+}
+
+/*****************************************************************************/
+
+}
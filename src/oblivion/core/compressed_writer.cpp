@@ -0,0 +1,300 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#include <oblivion/core/compressed_writer.h>
+
+#include <algorithm>
+
+#include <oblivion/core/compressed_format.h>
+#include <oblivion/core/exception.h>
+#include <oblivion/core/lz4.h>
+
+namespace oblivion {
+
+/*****************************************************************************/
+
+const uint32 CompressedFormat::MAGIC;
+const uint32 CompressedFormat::VERSION;
+const size_t CompressedFormat::HEADER_SIZE;
+const size_t CompressedFormat::BLOCK_HEADER_SIZE;
+const size_t CompressedFormat::INDEX_ENTRY_SIZE;
+const size_t CompressedFormat::FOOTER_SIZE;
+const uint32 CompressedFormat::STORED_FLAG;
+const size_t CompressedFormat::MAX_BLOCK_SIZE;
+
+/*****************************************************************************/
+
+static const size_t MIN_BLOCK_SIZE = 4096;
+
+/*****************************************************************************/
+
+static void store32(char* out, uint32 value) {
+    for (auto i = 0; i < 4; ++i) {
+        out[i] = static_cast<char>(value >> (8 * i));
+    }
+}
+
+/*****************************************************************************/
+
+static void store64(char* out, uint64 value) {
+    store32(out, static_cast<uint32>(value));
+    store32(out + 4, static_cast<uint32>(value >> 32));
+}
+
+/*****************************************************************************/
+
+CompressedWriter::Options::Options()
+    : blockSize(1 << 20),
+      threadCount(0) {
+}
+
+/*****************************************************************************/
+
+CompressedWriter::CompressedWriter(const std::string& path, const Options& options)
+    : path_(path),
+      blockSize_(options.blockSize),
+      stopping_(false),
+      offset_(CompressedFormat::HEADER_SIZE),
+      size_(0) {
+    if (options.blockSize < MIN_BLOCK_SIZE || options.blockSize > CompressedFormat::MAX_BLOCK_SIZE ||
+        options.threadCount < 0) {
+        OB_THROW("Invalid compressed file options: %s", path.c_str());
+    }
+
+    file_.reset(new File(path, "wb"));
+
+    char header[CompressedFormat::HEADER_SIZE] = {};
+    store32(header, CompressedFormat::MAGIC);
+    store32(header + 4, CompressedFormat::VERSION);
+    store32(header + 8, static_cast<uint32>(blockSize_));
+    file_->write(sizeof(header), header);
+
+    current_.reset(new Block());
+    current_->raw.reserve(blockSize_);
+
+    auto threadCount = options.threadCount;
+    if (threadCount == 0) {
+        threadCount = std::max(1, static_cast<int32>(std::thread::hardware_concurrency()));
+    }
+
+    for (auto i = 0; i < threadCount; ++i) {
+        threads_.push_back(std::thread(&CompressedWriter::run, this));
+    }
+}
+
+/*****************************************************************************/
+
+CompressedWriter::~CompressedWriter() {
+    try {
+        close();
+    } catch (...) {
+    }
+
+    stop();
+}
+
+/*****************************************************************************/
+
+void CompressedWriter::write(const void* data, size_t size) {
+    if (!file_) {
+        OB_THROW("Compressed file is closed: %s", path_.c_str());
+    }
+
+    auto bytes = static_cast<const char*>(data);
+
+    while (size > 0) {
+        auto count = std::min(size, blockSize_ - current_->raw.size());
+        current_->raw.append(bytes, count);
+
+        bytes += count;
+        size -= count;
+        size_ += count;
+
+        if (current_->raw.size() == blockSize_) {
+            submit();
+        }
+    }
+}
+
+/*****************************************************************************/
+
+void CompressedWriter::write(const std::string& text) {
+    write(text.data(), text.size());
+}
+
+/*****************************************************************************/
+
+void CompressedWriter::close(bool sync) {
+    if (!file_) {
+        return;
+    }
+
+    try {
+        if (!current_->raw.empty()) {
+            submit();
+        }
+
+        drain(0);
+        stop();
+
+        std::string trailer(index_.size() * CompressedFormat::INDEX_ENTRY_SIZE + CompressedFormat::FOOTER_SIZE, '\0');
+        auto out = &trailer[0];
+
+        for (auto& entry : index_) {
+            store64(out, entry.offset);
+            store32(out + 8, entry.storedSize);
+            store32(out + 12, entry.rawSize);
+            out += CompressedFormat::INDEX_ENTRY_SIZE;
+        }
+
+        store64(out, offset_);
+        store64(out + 8, index_.size());
+        store64(out + 16, size_);
+        store32(out + 28, CompressedFormat::MAGIC);
+
+        file_->write(trailer.size(), &trailer[0]);
+
+        if (sync) {
+            file_->sync();
+        } else {
+            file_->flush();
+        }
+    } catch (...) {
+        file_.reset();
+        throw;
+    }
+
+    file_.reset();
+}
+
+/*****************************************************************************/
+
+void CompressedWriter::run() {
+    for (;;) {
+        Block* block;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            work_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+
+            if (queue_.empty()) {
+                return;
+            }
+
+            block = queue_.front();
+            queue_.pop_front();
+        }
+
+        auto& raw = block->raw;
+        block->stored = true;
+
+        try {
+            block->packed.resize(Lz4::compressBound(raw.size()));
+            auto size = Lz4::compress(raw.data(), raw.size(), &block->packed[0]);
+
+            if (size < raw.size()) {
+                block->packed.resize(size);
+                block->stored = false;
+            }
+        } catch (...) {
+            // Without memory for the output the block is stored as is.
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            block->done = true;
+        }
+
+        done_.notify_all();
+    }
+}
+
+/*****************************************************************************/
+
+void CompressedWriter::submit() {
+    current_->done = false;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(current_.get());
+    }
+
+    work_.notify_one();
+    inFlight_.push_back(std::move(current_));
+
+    if (spare_.empty()) {
+        current_.reset(new Block());
+        current_->raw.reserve(blockSize_);
+    } else {
+        current_ = std::move(spare_.back());
+        spare_.pop_back();
+        current_->raw.clear();
+    }
+
+    // Two blocks per thread keep every thread busy while bounding memory.
+    drain(2 * threads_.size());
+}
+
+/*****************************************************************************/
+
+void CompressedWriter::drain(size_t limit) {
+    while (!inFlight_.empty()) {
+        auto& block = *inFlight_.front();
+
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+
+            if (!block.done && inFlight_.size() <= limit) {
+                return;
+            }
+
+            done_.wait(lock, [&] { return block.done; });
+        }
+
+        writeBlock(block);
+
+        spare_.push_back(std::move(inFlight_.front()));
+        inFlight_.pop_front();
+    }
+}
+
+/*****************************************************************************/
+
+void CompressedWriter::writeBlock(const Block& block) {
+    auto& body = block.stored ? block.raw : block.packed;
+
+    IndexEntry entry;
+    entry.offset = offset_;
+    entry.storedSize = static_cast<uint32>(body.size()) | (block.stored ? CompressedFormat::STORED_FLAG : 0);
+    entry.rawSize = static_cast<uint32>(block.raw.size());
+
+    char header[CompressedFormat::BLOCK_HEADER_SIZE];
+    store32(header, entry.storedSize);
+    store32(header + 4, entry.rawSize);
+
+    file_->write(sizeof(header), header);
+    file_->write(body.size(), const_cast<char*>(body.data()));
+
+    index_.push_back(entry);
+    offset_ += sizeof(header) + body.size();
+}
+
+/*****************************************************************************/
+
+void CompressedWriter::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+
+    work_.notify_all();
+
+    for (auto& thread : threads_) {
+        thread.join();
+    }
+
+    threads_.clear();
+}
+
+/*****************************************************************************/
+
+}
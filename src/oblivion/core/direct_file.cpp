@@ -0,0 +1,140 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#include <oblivion/core/direct_file.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace oblivion {
+
+/*****************************************************************************/
+
+const size_t DirectFile::ALIGNMENT;
+
+const size_t DirectFile::BOUNCE_SIZE;
+
+/*****************************************************************************/
+
+/**
+ * Rounds a size up to a whole number of blocks.
+ */
+static uint64 roundUp(uint64 size) {
+    return (size + DirectFile::ALIGNMENT - 1) / DirectFile::ALIGNMENT * DirectFile::ALIGNMENT;
+}
+
+/*****************************************************************************/
+
+size_t DirectFile::readAt(uint64 offset, size_t size, void* out) {
+    if (size == 0) {
+        return 0;
+    }
+
+    if (aligned(offset, size, out) || !direct()) {
+        return readFully(offset, size, out);
+    }
+
+    auto target = static_cast<char*>(out);
+    size_t done = 0;
+
+    // When only the tail is unaligned, the whole blocks still go straight to the device.
+    if (aligned(offset, ALIGNMENT, out) && size > ALIGNMENT) {
+        done = size - size % ALIGNMENT;
+
+        auto count = readFully(offset, done, out);
+        if (count < done) {
+            return count;
+        }
+    }
+
+    auto lease = bounce_->acquire();
+
+    while (done < size) {
+        auto position = offset + done;
+        auto skip = static_cast<size_t>(position % ALIGNMENT);
+        auto length = static_cast<size_t>(std::min<uint64>(lease.size(), roundUp(skip + size - done)));
+
+        auto count = readFully(position - skip, length, lease.data());
+        if (count <= skip) {
+            break;
+        }
+
+        auto copied = std::min(count - skip, size - done);
+        memcpy(target + done, lease.data() + skip, copied);
+        done += copied;
+
+        if (count < length) {
+            break;
+        }
+    }
+
+    return done;
+}
+
+/*****************************************************************************/
+
+void DirectFile::writeAt(uint64 offset, size_t size, const void* data) {
+    if (size == 0) {
+        return;
+    }
+
+    if (aligned(offset, size, data) || !direct()) {
+        writeFully(offset, size, data);
+        return;
+    }
+
+    auto source = static_cast<const char*>(data);
+    auto fileSize = this->size();
+    size_t done = 0;
+
+    if (aligned(offset, ALIGNMENT, data) && size > ALIGNMENT) {
+        done = size - size % ALIGNMENT;
+        writeFully(offset, done, data);
+    }
+
+    auto lease = bounce_->acquire();
+    auto buffer = lease.data();
+    uint64 written = 0;
+
+    while (done < size) {
+        auto position = offset + done;
+        auto start = position - position % ALIGNMENT;
+        auto skip = static_cast<size_t>(position - start);
+        auto count = std::min(size - done, lease.size() - skip);
+        auto length = static_cast<size_t>(roundUp(skip + count));
+
+        // Keep the bytes of partially covered blocks at either end. Past the
+        // end of the file they read as zeros.
+        if (skip > 0) {
+            auto got = readFully(start, ALIGNMENT, buffer);
+            memset(buffer + got, 0, ALIGNMENT - got);
+        }
+
+        if (skip + count < length && (length > ALIGNMENT || skip == 0)) {
+            auto tail = buffer + length - ALIGNMENT;
+            auto got = readFully(start + length - ALIGNMENT, ALIGNMENT, tail);
+            memset(tail + got, 0, ALIGNMENT - got);
+        }
+
+        memcpy(buffer + skip, source + done, count);
+        writeFully(start, length, buffer);
+
+        written = start + length;
+        done += count;
+    }
+
+    // The padding of the last block may have grown the file past the write.
+    if (written > fileSize) {
+        truncate(std::max(fileSize, offset + size));
+    }
+}
+
+/*****************************************************************************/
+
+bool DirectFile::aligned(uint64 offset, size_t size, const void* data) const {
+    return (offset | size | reinterpret_cast<uintptr_t>(data)) % ALIGNMENT == 0;
+}
+
+/*****************************************************************************/
+
+}
@@ -0,0 +1,219 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#include <oblivion/core/direct_file.h>
+
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+
+#include <oblivion/core/exception.h>
+
+namespace oblivion {
+
+/**
+ * The private implementation of DirectFile for posix.
+ */
+struct DirectFile::Impl {
+
+    /**
+     * Opens the file.
+     * @see DirectFile::DirectFile.
+     */
+    Impl(const std::string& path, DirectMode mode);
+
+    /**
+     * Closes the file.
+     */
+    ~Impl();
+
+    std::string path_;
+
+    int fd_;
+
+    bool direct_;
+
+};
+
+/*****************************************************************************/
+
+DirectFile::DirectFile(const std::string& path, DirectMode mode)
+    : impl_(new Impl(path, mode)),
+      bounce_(new AlignedBufferPool(BOUNCE_SIZE, ALIGNMENT, 4)) {
+}
+
+/*****************************************************************************/
+
+DirectFile::DirectFile(DirectFile&& other)
+    : impl_(std::move(other.impl_)),
+      bounce_(std::move(other.bounce_)) {
+}
+
+/*****************************************************************************/
+
+DirectFile::~DirectFile() {
+}
+
+/*****************************************************************************/
+
+DirectFile& DirectFile::operator =(DirectFile&& other) {
+    impl_ = std::move(other.impl_);
+    bounce_ = std::move(other.bounce_);
+    return *this;
+}
+
+/*****************************************************************************/
+
+void DirectFile::sync(bool dataOnly) {
+#ifdef __APPLE__
+    (void) dataOnly;
+    if (fsync(impl().fd_) != 0) {
+#else
+    if ((dataOnly ? fdatasync(impl().fd_) : fsync(impl().fd_)) != 0) {
+#endif
+        OB_THROW("Unable to sync file: %s", impl().path_.c_str());
+    }
+}
+
+/*****************************************************************************/
+
+uint64 DirectFile::size() const {
+    struct stat status;
+    if (fstat(impl().fd_, &status) != 0) {
+        OB_THROW("Unable to stat file: %s", impl().path_.c_str());
+    }
+
+    return static_cast<uint64>(status.st_size);
+}
+
+/*****************************************************************************/
+
+void DirectFile::truncate(uint64 size) {
+    if (ftruncate(impl().fd_, static_cast<off_t>(size)) != 0) {
+        OB_THROW("Unable to resize file: %s", impl().path_.c_str());
+    }
+}
+
+/*****************************************************************************/
+
+bool DirectFile::direct() const {
+    return impl().direct_;
+}
+
+/*****************************************************************************/
+
+const std::string& DirectFile::path() const {
+    return impl().path_;
+}
+
+/*****************************************************************************/
+
+size_t DirectFile::readFully(uint64 offset, size_t size, void* out) {
+    auto target = static_cast<char*>(out);
+    size_t done = 0;
+
+    while (done < size) {
+        auto count = pread(impl().fd_, target + done, size - done, static_cast<off_t>(offset + done));
+
+        if (count < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            OB_THROW("Unable to read file: %s", impl().path_.c_str());
+        }
+
+        if (count == 0) {
+            break;
+        }
+
+        done += static_cast<size_t>(count);
+    }
+
+    return done;
+}
+
+/*****************************************************************************/
+
+void DirectFile::writeFully(uint64 offset, size_t size, const void* data) {
+    auto source = static_cast<const char*>(data);
+    size_t done = 0;
+
+    while (done < size) {
+        auto count = pwrite(impl().fd_, source + done, size - done, static_cast<off_t>(offset + done));
+
+        if (count <= 0) {
+            if (count < 0 && errno == EINTR) {
+                continue;
+            }
+
+            OB_THROW("Unable to write file: %s", impl().path_.c_str());
+        }
+
+        done += static_cast<size_t>(count);
+    }
+}
+
+/*****************************************************************************/
+
+DirectFile::Impl& DirectFile::impl() const {
+    if (!impl_) {
+        OB_THROW("Direct file has been moved from");
+    }
+
+    return *impl_;
+}
+
+/*****************************************************************************/
+
+DirectFile::Impl::Impl(const std::string& path, DirectMode mode)
+    : path_(path),
+      fd_(-1),
+      direct_(false) {
+    int flags = O_CLOEXEC;
+    switch (mode) {
+    case DirectMode::Read:
+        flags |= O_RDONLY;
+        break;
+    case DirectMode::ReadWrite:
+        flags |= O_RDWR;
+        break;
+    default:
+        flags |= O_RDWR | O_CREAT | O_TRUNC;
+        break;
+    }
+
+#ifdef O_DIRECT
+    fd_ = open(path.c_str(), flags | O_DIRECT, 0666);
+
+    // File systems without direct I/O refuse the flag; fall back to the page cache.
+    direct_ = fd_ >= 0;
+    if (!direct_ && errno == EINVAL) {
+        fd_ = open(path.c_str(), flags, 0666);
+    }
+#else
+    fd_ = open(path.c_str(), flags, 0666);
+
+#ifdef F_NOCACHE
+    // OS X has no O_DIRECT, but can turn off caching for a descriptor.
+    direct_ = fd_ >= 0 && fcntl(fd_, F_NOCACHE, 1) == 0;
+#endif
+#endif
+
+    if (fd_ < 0) {
+        OB_THROW("Unable to open file: %s", path.c_str());
+    }
+}
+
+/*****************************************************************************/
+
+DirectFile::Impl::~Impl() {
+    if (fd_ >= 0) {
+        close(fd_);
+    }
+}
+
+/*****************************************************************************/
+
+}
@@ -0,0 +1,209 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#include <oblivion/core/direct_file.h>
+
+#include <algorithm>
+#include <utility>
+
+#include <oblivion/core/exception.h>
+#include <oblivion/core/windows.h>
+
+namespace oblivion {
+
+/**
+ * The private implementation of DirectFile for windows.
+ */
+struct DirectFile::Impl {
+
+    /**
+     * Opens the file.
+     * @see DirectFile::DirectFile.
+     */
+    Impl(const std::string& path, DirectMode mode);
+
+    /**
+     * Closes the file.
+     */
+    ~Impl();
+
+    std::string path_;
+
+    HANDLE file_;
+
+};
+
+/*****************************************************************************/
+
+/**
+ * The most bytes passed to one ReadFile or WriteFile call. A multiple of the
+ * alignment, so split requests stay aligned.
+ */
+static const DWORD MAX_TRANSFER = 1u << 30;
+
+/*****************************************************************************/
+
+DirectFile::DirectFile(const std::string& path, DirectMode mode)
+    : impl_(new Impl(path, mode)),
+      bounce_(new AlignedBufferPool(BOUNCE_SIZE, ALIGNMENT, 4)) {
+}
+
+/*****************************************************************************/
+
+DirectFile::DirectFile(DirectFile&& other)
+    : impl_(std::move(other.impl_)),
+      bounce_(std::move(other.bounce_)) {
+}
+
+/*****************************************************************************/
+
+DirectFile::~DirectFile() {
+}
+
+/*****************************************************************************/
+
+DirectFile& DirectFile::operator =(DirectFile&& other) {
+    impl_ = std::move(other.impl_);
+    bounce_ = std::move(other.bounce_);
+    return *this;
+}
+
+/*****************************************************************************/
+
+void DirectFile::sync(bool) {
+    if (!FlushFileBuffers(impl().file_)) {
+        OB_THROW("Unable to sync file: %s", impl().path_.c_str());
+    }
+}
+
+/*****************************************************************************/
+
+uint64 DirectFile::size() const {
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(impl().file_, &size)) {
+        OB_THROW("Unable to stat file: %s", impl().path_.c_str());
+    }
+
+    return static_cast<uint64>(size.QuadPart);
+}
+
+/*****************************************************************************/
+
+void DirectFile::truncate(uint64 size) {
+    FILE_END_OF_FILE_INFO info;
+    info.EndOfFile.QuadPart = static_cast<LONGLONG>(size);
+
+    if (!SetFileInformationByHandle(impl().file_, FileEndOfFileInfo, &info, sizeof(info))) {
+        OB_THROW("Unable to resize file: %s", impl().path_.c_str());
+    }
+}
+
+/*****************************************************************************/
+
+bool DirectFile::direct() const {
+    // Throws if this file has been moved from.
+    impl();
+    return true;
+}
+
+/*****************************************************************************/
+
+const std::string& DirectFile::path() const {
+    return impl().path_;
+}
+
+/*****************************************************************************/
+
+size_t DirectFile::readFully(uint64 offset, size_t size, void* out) {
+    auto target = static_cast<char*>(out);
+    size_t done = 0;
+
+    while (done < size) {
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = static_cast<DWORD>(offset + done);
+        overlapped.OffsetHigh = static_cast<DWORD>((offset + done) >> 32);
+
+        auto chunk = static_cast<DWORD>(std::min<size_t>(size - done, MAX_TRANSFER));
+        DWORD transferred = 0;
+
+        if (!ReadFile(impl().file_, target + done, chunk, &transferred, &overlapped)) {
+            if (GetLastError() == ERROR_HANDLE_EOF) {
+                break;
+            }
+
+            OB_THROW("Unable to read file: %s", impl().path_.c_str());
+        }
+
+        if (transferred == 0) {
+            break;
+        }
+
+        done += transferred;
+    }
+
+    return done;
+}
+
+/*****************************************************************************/
+
+void DirectFile::writeFully(uint64 offset, size_t size, const void* data) {
+    auto source = static_cast<const char*>(data);
+    size_t done = 0;
+
+    while (done < size) {
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = static_cast<DWORD>(offset + done);
+        overlapped.OffsetHigh = static_cast<DWORD>((offset + done) >> 32);
+
+        auto chunk = static_cast<DWORD>(std::min<size_t>(size - done, MAX_TRANSFER));
+        DWORD transferred = 0;
+
+        if (!WriteFile(impl().file_, source + done, chunk, &transferred, &overlapped) || transferred == 0) {
+            OB_THROW("Unable to write file: %s", impl().path_.c_str());
+        }
+
+        done += transferred;
+    }
+}
+
+/*****************************************************************************/
+
+DirectFile::Impl& DirectFile::impl() const {
+    if (!impl_) {
+        OB_THROW("Direct file has been moved from");
+    }
+
+    return *impl_;
+}
+
+/*****************************************************************************/
+
+DirectFile::Impl::Impl(const std::string& path, DirectMode mode)
+    : path_(path) {
+    DWORD access = GENERIC_READ;
+    DWORD disposition = OPEN_EXISTING;
+
+    if (mode != DirectMode::Read) {
+        access |= GENERIC_WRITE;
+    }
+
+    if (mode == DirectMode::Create) {
+        disposition = CREATE_ALWAYS;
+    }
+
+    file_ = CreateFileA(path.c_str(), access, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL,
+        disposition, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_NO_BUFFERING, NULL);
+
+    if (file_ == INVALID_HANDLE_VALUE) {
+        OB_THROW("Unable to open file: %s", path.c_str());
+    }
+}
+
+/*****************************************************************************/
+
+DirectFile::Impl::~Impl() {
+    CloseHandle(file_);
+}
+
+/*****************************************************************************/
+
+}
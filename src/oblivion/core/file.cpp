@@ -2,11 +2,26 @@
 
 #include <oblivion/core/file.h>
 
+#include <algorithm>
+#include <cerrno>
 #include <cstdarg>
 #include <string>
+#include <vector>
 
 #include <oblivion/core/exception.h>
 
+#ifdef WIN32
+#include <io.h>
+#include <sys/stat.h>
+#include <oblivion/core/windows.h>
+#else
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
 namespace oblivion {
 
 /*****************************************************************************/
@@ -56,16 +71,79 @@ void File::flush() {
 
 /*****************************************************************************/
 
-void File::seek(long int offset, int origin) {
-    if (fseek(file_, offset, origin) != 0) {
+void File::sync(bool dataOnly) {
+    if (fflush(file_) != 0) {
+        OB_THROW("fflush failed");
+    }
+
+#if defined(WIN32)
+    (void) dataOnly;
+    if (_commit(_fileno(file_)) != 0) {
+#elif defined(__APPLE__)
+    (void) dataOnly;
+    if (fsync(fileno(file_)) != 0) {
+#else
+    if ((dataOnly ? fdatasync(fileno(file_)) : fsync(fileno(file_))) != 0) {
+#endif
+        OB_THROW("fsync failed");
+    }
+}
+
+/*****************************************************************************/
+
+bool File::allocate(uint64 size) {
+#if defined(WIN32)
+    FILE_ALLOCATION_INFO info;
+    info.AllocationSize.QuadPart = static_cast<LONGLONG>(size);
+
+    auto handle = reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(file_)));
+    if (!SetFileInformationByHandle(handle, FileAllocationInfo, &info, sizeof(info))) {
+        OB_THROW("Unable to allocate %llu bytes", static_cast<unsigned long long>(size));
+    }
+
+    return true;
+#elif defined(__linux__)
+    int result;
+    do {
+        result = fallocate(fileno(file_), FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(size));
+    } while (result != 0 && errno == EINTR);
+
+    if (result != 0) {
+        if (errno == EOPNOTSUPP || errno == ENOSYS) {
+            return false;
+        }
+
+        OB_THROW("Unable to allocate %llu bytes", static_cast<unsigned long long>(size));
+    }
+
+    return true;
+#else
+    // posix_fallocate would grow the file, so there is no portable equivalent.
+    (void) size;
+    return false;
+#endif
+}
+
+/*****************************************************************************/
+
+void File::seek(int64 offset, int origin) {
+#ifdef WIN32
+    if (_fseeki64(file_, offset, origin) != 0) {
+#else
+    if (fseeko(file_, static_cast<off_t>(offset), origin) != 0) {
+#endif
         OB_THROW("fseek failed");
     }
 }
 
 /*****************************************************************************/
 
-long int File::position() {
-    auto result = ftell(file_);
+int64 File::position() {
+#ifdef WIN32
+    int64 result = _ftelli64(file_);
+#else
+    int64 result = ftello(file_);
+#endif
 
     if (result == -1) {
         OB_THROW("ftell failed");
@@ -88,17 +166,195 @@ size_t File::read(size_t size, void* out) {
 
 /*****************************************************************************/
 
+#ifdef WIN32
+
+/**
+ * Reads or writes at an offset through the underlying handle. Windows has no
+ * pread, so the offset travels in an OVERLAPPED structure instead. On the
+ * synchronous handle under the stream that would still move the file pointer
+ * and desynchronise the stream buffer, so the transfer goes through a second,
+ * overlapped handle to the same file, which has no file pointer of its own.
+ */
+static size_t transferAt(FILE* file, uint64 offset, size_t size, void* data, bool write) {
+    auto stream = reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(file)));
+    auto handle = ReOpenFile(stream, write ? GENERIC_WRITE : GENERIC_READ,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, FILE_FLAG_OVERLAPPED);
+
+    if (handle == INVALID_HANDLE_VALUE) {
+        OB_THROW("ReOpenFile failed");
+    }
+
+    auto bytes = static_cast<char*>(data);
+    size_t done = 0;
+    bool failed = false;
+
+    while (done < size) {
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = static_cast<DWORD>(offset + done);
+        overlapped.OffsetHigh = static_cast<DWORD>((offset + done) >> 32);
+
+        auto chunk = static_cast<DWORD>(std::min<size_t>(size - done, 1u << 30));
+        DWORD transferred = 0;
+        BOOL success = write ? WriteFile(handle, bytes + done, chunk, NULL, &overlapped) :
+            ReadFile(handle, bytes + done, chunk, NULL, &overlapped);
+
+        if (success || GetLastError() == ERROR_IO_PENDING) {
+            success = GetOverlappedResult(handle, &overlapped, &transferred, TRUE);
+        }
+
+        if (!success) {
+            failed = write || GetLastError() != ERROR_HANDLE_EOF;
+            break;
+        }
+
+        if (transferred == 0) {
+            break;
+        }
+
+        done += transferred;
+    }
+
+    CloseHandle(handle);
+
+    if (failed) {
+        OB_THROW(write ? "WriteFile failed" : "ReadFile failed");
+    }
+
+    return done;
+}
+
+#else
+
+/**
+ * Skips the first bytes of a list of vectors after a partial transfer.
+ * @return The number of vectors left.
+ */
+static int advance(iovec*& vectors, int count, size_t bytes) {
+    while (count > 0 && bytes >= vectors->iov_len) {
+        bytes -= vectors->iov_len;
+        ++vectors;
+        --count;
+    }
+
+    if (count > 0) {
+        vectors->iov_base = static_cast<char*>(vectors->iov_base) + bytes;
+        vectors->iov_len -= bytes;
+    }
+
+    return count;
+}
+
+/*****************************************************************************/
+
+/**
+ * Reads or writes a list of buffers at an offset, continuing after partial
+ * transfers. A read stops early only at the end of the file.
+ */
+static size_t transferAt(FILE* file, uint64 offset, const IoBuffer* buffers, size_t count, bool write) {
+    auto fd = fileno(file);
+
+    // The vectors are modified as the transfer progresses, so work on a copy;
+    // short lists, the common case, stay on the stack.
+    iovec local[8];
+    std::vector<iovec> storage;
+    auto vectors = local;
+
+    if (count > sizeof(local) / sizeof(local[0])) {
+        storage.resize(count);
+        vectors = storage.data();
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        vectors[i].iov_base = buffers[i].data;
+        vectors[i].iov_len = buffers[i].size;
+    }
+
+    // Skipping empty leading buffers means a transfer of 0 bytes always signals the end.
+    auto remaining = advance(vectors, static_cast<int>(count), 0);
+    size_t done = 0;
+
+    while (remaining > 0) {
+        auto batch = std::min(remaining, IOV_MAX);
+        auto position = static_cast<off_t>(offset + done);
+        auto result = write ? pwritev(fd, vectors, batch, position) : preadv(fd, vectors, batch, position);
+
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            OB_THROW(write ? "pwritev failed" : "preadv failed");
+        }
+
+        if (result == 0) {
+            if (write) {
+                OB_THROW("pwritev failed");
+            }
+
+            break;
+        }
+
+        done += static_cast<size_t>(result);
+        remaining = advance(vectors, remaining, static_cast<size_t>(result));
+    }
+
+    return done;
+}
+
+#endif
+
+/*****************************************************************************/
+
+size_t File::readAt(uint64 offset, size_t size, void* out) {
+#ifdef WIN32
+    return transferAt(file_, offset, size, out, false);
+#else
+    IoBuffer buffer = { out, size };
+    return transferAt(file_, offset, &buffer, 1, false);
+#endif
+}
+
+/*****************************************************************************/
+
+size_t File::readv(uint64 offset, const IoBuffer* buffers, size_t count) {
+#ifdef WIN32
+    size_t total = 0;
+
+    for (size_t i = 0; i < count; ++i) {
+        auto result = transferAt(file_, offset + total, buffers[i].size, buffers[i].data, false);
+        total += result;
+
+        if (result < buffers[i].size) {
+            break;
+        }
+    }
+
+    return total;
+#else
+    return transferAt(file_, offset, buffers, count, false);
+#endif
+}
+
+/*****************************************************************************/
+
 std::string File::readLine() {
+    std::string result;
     char buffer[MAX_LINE_SIZE];
-    if (!fgets(buffer, sizeof(buffer), file_)) {
-        if (feof(file_)) {
-            return "";
+
+    // Keep reading until the newline so long lines are not split.
+    do {
+        if (!fgets(buffer, sizeof(buffer), file_)) {
+            if (feof(file_)) {
+                break;
+            }
+
+            OB_THROW("fgets failed");
         }
 
-        OB_THROW("fgets failed");
-    }
+        result += buffer;
+    } while (!result.empty() && result.back() != '\n');
 
-    return buffer;
+    return result;
 }
 
 /*****************************************************************************/
@@ -111,6 +367,30 @@ void File::write(size_t size, void* data) {
 
 /*****************************************************************************/
 
+void File::writeAt(uint64 offset, size_t size, const void* data) {
+#ifdef WIN32
+    transferAt(file_, offset, size, const_cast<void*>(data), true);
+#else
+    IoBuffer buffer = { const_cast<void*>(data), size };
+    transferAt(file_, offset, &buffer, 1, true);
+#endif
+}
+
+/*****************************************************************************/
+
+void File::writev(uint64 offset, const IoBuffer* buffers, size_t count) {
+#ifdef WIN32
+    for (size_t i = 0; i < count; ++i) {
+        transferAt(file_, offset, buffers[i].size, buffers[i].data, true);
+        offset += buffers[i].size;
+    }
+#else
+    transferAt(file_, offset, buffers, count, true);
+#endif
+}
+
+/*****************************************************************************/
+
 void File::printf(const char* format, ...) {
     va_list args;
     va_start(args, format);
@@ -121,25 +401,39 @@ void File::printf(const char* format, ...) {
 /*****************************************************************************/
 
 void File::write(const std::string& text) {
-    this->printf("%s", text.c_str());
+    if (!text.empty() && fwrite(text.data(), text.size(), 1, file_) != 1) {
+        OB_THROW("fwrite failed");
+    }
 }
 
 /*****************************************************************************/
 
 void File::writeLine(const std::string& line) {
-    this->printf("%s\n", line.c_str());
+    write(line);
+
+    if (fputc('\n', file_) == EOF) {
+        OB_THROW("fputc failed");
+    }
 }
 
 /*****************************************************************************/
 
-size_t File::size() {
-    auto current = position();
+uint64 File::size() {
+    if (fflush(file_) != 0) {
+        OB_THROW("fflush failed");
+    }
 
-    seek(0, SEEK_END);
-    auto result = position();
-    seek(current, SEEK_SET);
+#ifdef WIN32
+    struct _stat64 status;
+    if (_fstat64(_fileno(file_), &status) != 0) {
+#else
+    struct stat status;
+    if (fstat(fileno(file_), &status) != 0) {
+#endif
+        OB_THROW("fstat failed");
+    }
 
-    return result;
+    return static_cast<uint64>(status.st_size);
 }
 
 /*****************************************************************************/
@@ -17,6 +17,12 @@ void FileUtil::remove(const std::string& path) {
 
 /*****************************************************************************/
 
+void FileUtil::writeAll(const std::string& path, const std::string& contents, bool sync) {
+    writeAll(path, contents.data(), contents.size(), sync);
+}
+
+/*****************************************************************************/
+
 std::string FileUtil::getExtension(const std::string& path) {
     auto fileName = getFileName(path);
 
@@ -2,14 +2,226 @@
 
 #include <oblivion/core/file_util.h>
 
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
 #include <dirent.h>
+#include <fcntl.h>
+#include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/fs.h>
+#include <sys/sendfile.h>
+#include <sys/syscall.h>
+#endif
+
+#include <oblivion/core/exception.h>
+#include <oblivion/core/types.h>
 
 namespace oblivion {
 
 /*****************************************************************************/
 
+/**
+ * The alignment of buffers, offsets and sizes for O_DIRECT.
+ */
+static const size_t DIRECT_ALIGNMENT = 4096;
+
+/**
+ * The size of the bounce buffer used to align O_DIRECT writes.
+ */
+static const size_t DIRECT_BUFFER_SIZE = 1 << 20;
+
+/**
+ * The size of the buffer used to copy files the kernel cannot copy itself.
+ */
+static const size_t COPY_BUFFER_SIZE = 1 << 20;
+
+/*****************************************************************************/
+
+/**
+ * Closes a file descriptor when it goes out of scope.
+ */
+struct Descriptor {
+
+    explicit Descriptor(int fd) : fd(fd) {
+    }
+
+    ~Descriptor() {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    int fd;
+
+};
+
+/*****************************************************************************/
+
+/**
+ * Writes a buffer at an offset, continuing after partial writes.
+ */
+static void writeFully(int fd, const char* data, size_t size, off_t offset, const std::string& path) {
+    while (size > 0) {
+        auto result = pwrite(fd, data, size, offset);
+
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            OB_THROW("Unable to write file: %s", path.c_str());
+        }
+
+        data += result;
+        size -= static_cast<size_t>(result);
+        offset += result;
+    }
+}
+
+/*****************************************************************************/
+
+/**
+ * Writes a buffer to a file opened with O_DIRECT. Data that is not already
+ * aligned goes through an aligned bounce buffer, and the last block is
+ * padded and then truncated away.
+ */
+static void writeDirect(int fd, const char* data, size_t size, const std::string& path) {
+    size_t done = 0;
+
+    if (reinterpret_cast<uintptr_t>(data) % DIRECT_ALIGNMENT == 0) {
+        done = size - size % DIRECT_ALIGNMENT;
+        writeFully(fd, data, done, 0, path);
+    }
+
+    if (done == size) {
+        return;
+    }
+
+    void* buffer = nullptr;
+    if (posix_memalign(&buffer, DIRECT_ALIGNMENT, DIRECT_BUFFER_SIZE) != 0) {
+        OB_THROW("Unable to allocate a direct I/O buffer");
+    }
+
+    std::unique_ptr<void, void (*)(void*)> owner(buffer, free);
+    auto bounce = static_cast<char*>(buffer);
+
+    while (done < size) {
+        auto chunk = std::min(size - done, DIRECT_BUFFER_SIZE);
+        auto padded = (chunk + DIRECT_ALIGNMENT - 1) / DIRECT_ALIGNMENT * DIRECT_ALIGNMENT;
+
+        memcpy(bounce, data + done, chunk);
+        memset(bounce + chunk, 0, padded - chunk);
+
+        writeFully(fd, bounce, padded, static_cast<off_t>(done), path);
+        done += chunk;
+    }
+
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        OB_THROW("Unable to truncate file: %s", path.c_str());
+    }
+}
+
+/*****************************************************************************/
+
+/**
+ * The ways of copying data between files, from most to least efficient.
+ */
+enum class CopyMethod {
+    CopyFileRange,
+    SendFile,
+    Buffer
+};
+
+/*****************************************************************************/
+
+/**
+ * Copies a range of one file to the same offset in another, stepping down to
+ * a less efficient method whenever the current one is not supported for the
+ * pair of files. Copying stops early at the end of the source.
+ * @return The number of bytes copied.
+ */
+static uint64 copyRange(int in, int out, uint64 offset, uint64 length, CopyMethod& method,
+        std::unique_ptr<char[]>& buffer, const std::string& path) {
+    uint64 done = 0;
+
+    while (done < length) {
+        auto chunk = static_cast<size_t>(std::min<uint64>(length - done, 1u << 30));
+        ssize_t result = -1;
+
+        if (method == CopyMethod::CopyFileRange) {
+#if defined(__linux__) && defined(SYS_copy_file_range)
+            // Called directly so C libraries without the wrapper still build.
+            loff_t inOffset = static_cast<loff_t>(offset + done);
+            loff_t outOffset = inOffset;
+            result = syscall(SYS_copy_file_range, in, &inOffset, out, &outOffset, chunk, 0u);
+
+            // Some file systems only report that they cannot copy on the first call.
+            if (result < 0 && errno != EINTR && errno != EIO && errno != ENOSPC) {
+                method = CopyMethod::SendFile;
+                continue;
+            }
+#else
+            method = CopyMethod::SendFile;
+            continue;
+#endif
+        } else if (method == CopyMethod::SendFile) {
+#ifdef __linux__
+            off_t inOffset = static_cast<off_t>(offset + done);
+            if (lseek(out, inOffset, SEEK_SET) < 0) {
+                OB_THROW("Unable to seek file: %s", path.c_str());
+            }
+
+            result = sendfile(out, in, &inOffset, chunk);
+
+            if (result < 0 && errno != EINTR && errno != EIO && errno != ENOSPC) {
+                method = CopyMethod::Buffer;
+                continue;
+            }
+#else
+            method = CopyMethod::Buffer;
+            continue;
+#endif
+        } else {
+            if (!buffer) {
+                buffer.reset(new char[COPY_BUFFER_SIZE]);
+            }
+
+            result = pread(in, buffer.get(), std::min(chunk, COPY_BUFFER_SIZE), static_cast<off_t>(offset + done));
+
+            if (result > 0) {
+                writeFully(out, buffer.get(), static_cast<size_t>(result), static_cast<off_t>(offset + done), path);
+            }
+        }
+
+        if (result < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            OB_THROW("Unable to copy file: %s", path.c_str());
+        }
+
+        if (result == 0) {
+            break;
+        }
+
+        done += static_cast<uint64>(result);
+    }
+
+    return done;
+}
+
+/*****************************************************************************/
+
 bool FileUtil::exists(const std::string& path) {
     struct stat st;
     return stat(path.c_str(), &st) == 0;
@@ -28,6 +240,233 @@ bool FileUtil::isDirectory(const std::string& path) {
 
 /**************************************************************************/
 
+void FileUtil::rename(const std::string& from, const std::string& to) {
+    if (std::rename(from.c_str(), to.c_str()) != 0) {
+        OB_THROW("Unable to rename file: %s", from.c_str());
+    }
+
+    auto lastSlash = to.find_last_of('/');
+    syncDirectory(lastSlash == std::string::npos ? std::string(".") : to.substr(0, lastSlash + 1));
+}
+
+/**************************************************************************/
+
+void FileUtil::copy(const std::string& from, const std::string& to, bool sparse) {
+    Descriptor in(open(from.c_str(), O_RDONLY | O_CLOEXEC));
+
+    if (in.fd < 0) {
+        OB_THROW("Unable to open file: %s", from.c_str());
+    }
+
+    struct stat status;
+    if (fstat(in.fd, &status) != 0) {
+        OB_THROW("Unable to stat file: %s", from.c_str());
+    }
+
+    // Truncating on open would destroy the source if both paths name the same
+    // file, so compare them first.
+    Descriptor out(open(to.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC, status.st_mode & 07777));
+
+    if (out.fd < 0) {
+        OB_THROW("Unable to open file: %s", to.c_str());
+    }
+
+    struct stat target;
+    if (fstat(out.fd, &target) != 0) {
+        OB_THROW("Unable to stat file: %s", to.c_str());
+    }
+
+    if (target.st_dev == status.st_dev && target.st_ino == status.st_ino) {
+        OB_THROW("Unable to copy a file onto itself: %s", to.c_str());
+    }
+
+    try {
+        // The mode given to open is masked by the umask and ignored for an
+        // existing file.
+        if (ftruncate(out.fd, 0) != 0 || fchmod(out.fd, status.st_mode & 07777) != 0) {
+            OB_THROW("Unable to prepare file: %s", to.c_str());
+        }
+
+#ifdef FICLONE
+        // A reflink shares the source's blocks, copying nothing until either
+        // file is modified. It also keeps holes.
+        if (ioctl(out.fd, FICLONE, in.fd) == 0) {
+            return;
+        }
+#endif
+
+        auto size = static_cast<uint64>(status.st_size);
+        auto method = CopyMethod::CopyFileRange;
+        std::unique_ptr<char[]> buffer;
+        uint64 offset = 0;
+
+#ifdef SEEK_HOLE
+        if (sparse && size > 0) {
+            // Copy each run of data, leaving the holes between them unwritten.
+            for (;;) {
+                auto data = lseek(in.fd, static_cast<off_t>(offset), SEEK_DATA);
+                if (data < 0) {
+                    if (errno == ENXIO) {
+                        break;
+                    }
+
+                    OB_THROW("Unable to find data in file: %s", from.c_str());
+                }
+
+                auto hole = lseek(in.fd, data, SEEK_HOLE);
+                if (hole < 0) {
+                    OB_THROW("Unable to find a hole in file: %s", from.c_str());
+                }
+
+                copyRange(in.fd, out.fd, static_cast<uint64>(data), static_cast<uint64>(hole - data),
+                    method, buffer, from);
+                offset = static_cast<uint64>(hole);
+            }
+
+            if (ftruncate(out.fd, static_cast<off_t>(size)) != 0) {
+                OB_THROW("Unable to resize file: %s", to.c_str());
+            }
+
+            return;
+        }
+#else
+        (void) sparse;
+#endif
+
+        offset = copyRange(in.fd, out.fd, 0, size, method, buffer, from);
+
+        // Special files report a size of 0 and other files may have grown since
+        // fstat; copy whatever remains up to the end.
+        method = CopyMethod::Buffer;
+        while (auto copied = copyRange(in.fd, out.fd, offset, COPY_BUFFER_SIZE, method, buffer, from)) {
+            offset += copied;
+        }
+    } catch (...) {
+        unlink(to.c_str());
+        throw;
+    }
+}
+
+/**************************************************************************/
+
+void FileUtil::syncDirectory(const std::string& path) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+/**************************************************************************/
+
+std::string FileUtil::readAll(const std::string& path) {
+    Descriptor file(open(path.c_str(), O_RDONLY | O_CLOEXEC));
+
+    if (file.fd < 0) {
+        OB_THROW("Unable to open file: %s", path.c_str());
+    }
+
+    struct stat status;
+    if (fstat(file.fd, &status) != 0) {
+        OB_THROW("Unable to stat file: %s", path.c_str());
+    }
+
+    auto size = static_cast<size_t>(status.st_size);
+
+#ifdef POSIX_FADV_SEQUENTIAL
+    posix_fadvise(file.fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+
+    // Large files are read rather than mapped too: a mapping faults with SIGBUS
+    // if another process truncates the file while it is being copied.
+    std::string result;
+    result.resize(size);
+    size_t done = 0;
+
+    // Read to the end rather than trusting the size: it is 0 for many special
+    // files and the file may have grown since fstat.
+    for (;;) {
+        char probe[4096];
+        auto full = done == result.size();
+        auto target = full ? probe : &result[done];
+        auto count = full ? sizeof(probe) : result.size() - done;
+        auto bytes = read(file.fd, target, count);
+
+        if (bytes < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            OB_THROW("Unable to read file: %s", path.c_str());
+        }
+
+        if (bytes == 0) {
+            break;
+        }
+
+        if (full) {
+            result.append(probe, static_cast<size_t>(bytes));
+        }
+
+        done += static_cast<size_t>(bytes);
+    }
+
+    result.resize(done);
+    return result;
+}
+
+/**************************************************************************/
+
+void FileUtil::writeAll(const std::string& path, const void* data, size_t size, bool sync, bool direct) {
+    auto flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+    Descriptor file(-1);
+
+#ifdef O_DIRECT
+    // File systems without direct I/O refuse the flag; fall back to the page cache.
+    if (direct && size > 0) {
+        file.fd = open(path.c_str(), flags | O_DIRECT, 0666);
+    }
+#endif
+
+    auto isDirect = file.fd >= 0;
+    if (!isDirect) {
+        file.fd = open(path.c_str(), flags, 0666);
+    }
+
+    if (file.fd < 0) {
+        OB_THROW("Unable to open file: %s", path.c_str());
+    }
+
+#ifdef __linux__
+    if (size > 0) {
+        fallocate(file.fd, 0, 0, static_cast<off_t>(size));
+    }
+#endif
+
+    if (isDirect) {
+        writeDirect(file.fd, static_cast<const char*>(data), size, path);
+    } else {
+        writeFully(file.fd, static_cast<const char*>(data), size, 0, path);
+    }
+
+#ifdef __APPLE__
+    if (sync && fsync(file.fd) != 0) {
+#else
+    if (sync && fdatasync(file.fd) != 0) {
+#endif
+        OB_THROW("Unable to sync file: %s", path.c_str());
+    }
+
+    auto fd = file.fd;
+    file.fd = -1;
+
+    if (close(fd) != 0) {
+        OB_THROW("Unable to close file: %s", path.c_str());
+    }
+}
+
+/**************************************************************************/
+
 void FileUtil::createDirectory(const std::string& path) {
     mkdir(path.c_str(), S_IRWXU | S_IRWXG | S_IROTH | S_IXOTH);
 }
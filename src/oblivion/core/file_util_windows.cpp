@@ -2,6 +2,8 @@
 
 #include <oblivion/core/file_util.h>
 
+#include <oblivion/core/exception.h>
+#include <oblivion/core/file.h>
 #include <oblivion/core/windows.h>
 
 namespace oblivion {
@@ -27,6 +29,56 @@ bool FileUtil::isDirectory(const std::string& path) {
 
 /**************************************************************************/
 
+void FileUtil::rename(const std::string& from, const std::string& to) {
+    if (!MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+        OB_THROW("Unable to rename file: %s", from.c_str());
+    }
+}
+
+/**************************************************************************/
+
+std::string FileUtil::readAll(const std::string& path) {
+    File file(path, "rb");
+    std::string result(static_cast<size_t>(file.size()), '\0');
+
+    if (!result.empty()) {
+        result.resize(file.read(result.size(), &result[0]));
+    }
+
+    return result;
+}
+
+/**************************************************************************/
+
+void FileUtil::writeAll(const std::string& path, const void* data, size_t size, bool sync, bool) {
+    File file(path, "wb");
+
+    if (size > 0) {
+        file.allocate(size);
+        file.write(size, const_cast<void*>(data));
+    }
+
+    if (sync) {
+        file.sync(true);
+    }
+}
+
+/**************************************************************************/
+
+void FileUtil::copy(const std::string& from, const std::string& to, bool) {
+    if (!CopyFileA(from.c_str(), to.c_str(), FALSE)) {
+        OB_THROW("Unable to copy file: %s", from.c_str());
+    }
+}
+
+/**************************************************************************/
+
+void FileUtil::syncDirectory(const std::string&) {
+    // NTFS makes directory entries durable with the file metadata.
+}
+
+/**************************************************************************/
+
 void FileUtil::createDirectory(const std::string& path) {
     CreateDirectory(path.c_str(), nullptr);
 }
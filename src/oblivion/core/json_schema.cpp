@@ -0,0 +1,773 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#include <oblivion/core/json_schema.h>
+
+#include <cmath>
+#include <limits>
+#include <regex>
+#include <unordered_map>
+
+#include <oblivion/core/exception.h>
+#include <oblivion/core/string_util.h>
+#include <oblivion/core/variant.h>
+
+namespace oblivion {
+
+/*****************************************************************************/
+
+const uint32 TYPE_NULL = 1 << 0;
+const uint32 TYPE_BOOLEAN = 1 << 1;
+const uint32 TYPE_INTEGER = 1 << 2;
+const uint32 TYPE_NUMBER = 1 << 3;
+const uint32 TYPE_STRING = 1 << 4;
+const uint32 TYPE_ARRAY = 1 << 5;
+const uint32 TYPE_OBJECT = 1 << 6;
+
+/**
+ * Keywords that change validation but are not compiled. These are rejected
+ * rather than silently ignored.
+ */
+static const char* UNSUPPORTED_KEYWORDS[] = {
+    "$ref", "$dynamicRef", "$anchor", "$dynamicAnchor", "$defs", "patternProperties",
+    "propertyNames", "dependentRequired", "dependentSchemas", "prefixItems", "contains",
+    "minContains", "maxContains", "if", "then", "else", "unevaluatedItems",
+    "unevaluatedProperties"
+};
+
+/*****************************************************************************/
+
+/**
+ * A compiled schema.
+ */
+struct JsonSchema::Node {
+
+    /**
+     * A property that is named in properties or required. Names that are
+     * only required are not declared, so additionalProperties still applies
+     * to them.
+     */
+    struct Slot {
+        std::string name;
+        std::unique_ptr<Node> schema;
+        bool declared;
+        bool required;
+    };
+
+    Node()
+        : alwaysFails(false),
+          types(0),
+          hasConst(false),
+          hasMinimum(false),
+          hasMaximum(false),
+          exclusiveMinimum(false),
+          exclusiveMaximum(false),
+          minimum(0),
+          maximum(0),
+          multipleOf(0),
+          minLength(-1),
+          maxLength(-1),
+          requiredCount(0),
+          additionalAllowed(true),
+          minProperties(-1),
+          maxProperties(-1),
+          minItems(-1),
+          maxItems(-1),
+          uniqueItems(false) {
+    }
+
+    bool alwaysFails;
+
+    uint32 types;
+
+    std::vector<Variant> enumValues;
+
+    bool hasConst;
+    Variant constValue;
+
+    bool hasMinimum;
+    bool hasMaximum;
+    bool exclusiveMinimum;
+    bool exclusiveMaximum;
+    real64 minimum;
+    real64 maximum;
+    real64 multipleOf;
+
+    int64 minLength;
+    int64 maxLength;
+    std::unique_ptr<std::regex> pattern;
+    std::string patternSource;
+
+    std::vector<Slot> slots;
+    std::unordered_map<std::string, int32> slotIndex;
+    int32 requiredCount;
+    std::unique_ptr<Node> additionalProperties;
+    bool additionalAllowed;
+    int64 minProperties;
+    int64 maxProperties;
+
+    std::unique_ptr<Node> items;
+    int64 minItems;
+    int64 maxItems;
+    bool uniqueItems;
+
+    std::vector<std::unique_ptr<Node>> allOf;
+    std::vector<std::unique_ptr<Node>> anyOf;
+    std::vector<std::unique_ptr<Node>> oneOf;
+    std::unique_ptr<Node> notSchema;
+
+};
+
+/*****************************************************************************/
+
+static bool isNumber(const Variant& value) {
+    return value.type() == VariantType::Integer || value.type() == VariantType::Real;
+}
+
+/*****************************************************************************/
+
+static bool equals(const Variant& a, const Variant& b) {
+    if (isNumber(a) && isNumber(b)) {
+        return a.realValue() == b.realValue();
+    }
+
+    if (a.type() != b.type()) {
+        return false;
+    }
+
+    switch (a.type()) {
+    case VariantType::Null:
+        return true;
+    case VariantType::Bool:
+        return a.boolValue() == b.boolValue();
+    case VariantType::String:
+        return a.stringValue() == b.stringValue();
+    case VariantType::Array:
+        if (a.size() != b.size()) {
+            return false;
+        }
+
+        for (auto i = 0; i < a.size(); ++i) {
+            if (!equals(a[i], b[i])) {
+                return false;
+            }
+        }
+
+        return true;
+    case VariantType::Map: {
+        if (a.size() != b.size()) {
+            return false;
+        }
+
+        for (auto& key : a.mapKeys()) {
+            if (!b.containsKey(key) || !equals(a[key], b[key])) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+/*****************************************************************************/
+
+static uint32 typeMask(const std::string& name) {
+    if (name == "null") return TYPE_NULL;
+    if (name == "boolean") return TYPE_BOOLEAN;
+    if (name == "integer") return TYPE_INTEGER;
+    if (name == "number") return TYPE_NUMBER;
+    if (name == "string") return TYPE_STRING;
+    if (name == "array") return TYPE_ARRAY;
+    if (name == "object") return TYPE_OBJECT;
+
+    OB_THROW("Unknown JSON Schema type: " + name);
+}
+
+/*****************************************************************************/
+
+static uint32 valueTypeMask(const Variant& value) {
+    switch (value.type()) {
+    case VariantType::Null:
+        return TYPE_NULL;
+    case VariantType::Bool:
+        return TYPE_BOOLEAN;
+    case VariantType::Integer:
+        return TYPE_INTEGER | TYPE_NUMBER;
+    case VariantType::Real: {
+        auto real = value.realValue();
+        return std::floor(real) == real ? (TYPE_INTEGER | TYPE_NUMBER) : TYPE_NUMBER;
+    }
+    case VariantType::String:
+        return TYPE_STRING;
+    case VariantType::Array:
+        return TYPE_ARRAY;
+    case VariantType::Map:
+        return TYPE_OBJECT;
+    default:
+        return 0;
+    }
+}
+
+/*****************************************************************************/
+
+static int64 nonNegative(const Variant& schema, const std::string& keyword) {
+    auto& value = schema[keyword];
+    if (!isNumber(value) || value.realValue() < 0) {
+        OB_THROW(keyword + " must be a non-negative integer");
+    }
+
+    return static_cast<int64>(value.realValue());
+}
+
+/*****************************************************************************/
+
+static real64 number(const Variant& schema, const std::string& keyword) {
+    auto& value = schema[keyword];
+    if (!isNumber(value)) {
+        OB_THROW(keyword + " must be a number");
+    }
+
+    return value.realValue();
+}
+
+/*****************************************************************************/
+
+static std::unique_ptr<JsonSchema::Node> compile(const Variant& schema);
+
+/*****************************************************************************/
+
+static void compileList(const Variant& schema, const std::string& keyword, std::vector<std::unique_ptr<JsonSchema::Node>>& out) {
+    auto& list = schema[keyword];
+    if (list.type() != VariantType::Array || list.size() == 0) {
+        OB_THROW(keyword + " must be a non-empty array");
+    }
+
+    for (auto i = 0; i < list.size(); ++i) {
+        out.push_back(compile(list[i]));
+    }
+}
+
+/*****************************************************************************/
+
+static JsonSchema::Node::Slot& slotFor(JsonSchema::Node& node, const std::string& name) {
+    auto itr = node.slotIndex.find(name);
+    if (itr != node.slotIndex.end()) {
+        return node.slots[itr->second];
+    }
+
+    node.slotIndex[name] = static_cast<int32>(node.slots.size());
+
+    JsonSchema::Node::Slot slot;
+    slot.name = name;
+    slot.declared = false;
+    slot.required = false;
+    node.slots.push_back(std::move(slot));
+
+    return node.slots.back();
+}
+
+/*****************************************************************************/
+
+static std::unique_ptr<JsonSchema::Node> compile(const Variant& schema) {
+    std::unique_ptr<JsonSchema::Node> node(new JsonSchema::Node());
+
+    if (schema.type() == VariantType::Bool) {
+        node->alwaysFails = !schema.boolValue();
+        return node;
+    }
+
+    if (schema.type() != VariantType::Map) {
+        OB_THROW("A JSON Schema must be an object or a boolean");
+    }
+
+    for (auto keyword : UNSUPPORTED_KEYWORDS) {
+        if (schema.containsKey(keyword)) {
+            OB_THROW("Unsupported JSON Schema keyword: %s", keyword);
+        }
+    }
+
+    if (schema.containsKey("type")) {
+        auto& type = schema["type"];
+        if (type.type() == VariantType::Array) {
+            for (auto i = 0; i < type.size(); ++i) {
+                node->types |= typeMask(type[i].stringValue());
+            }
+        } else {
+            node->types = typeMask(type.stringValue());
+        }
+    }
+
+    if (schema.containsKey("enum")) {
+        auto& values = schema["enum"];
+        if (values.type() != VariantType::Array) {
+            OB_THROW("enum must be an array");
+        }
+
+        for (auto i = 0; i < values.size(); ++i) {
+            node->enumValues.push_back(values[i]);
+        }
+    }
+
+    if (schema.containsKey("const")) {
+        node->hasConst = true;
+        node->constValue = schema["const"];
+    }
+
+    if (schema.containsKey("minimum")) {
+        node->hasMinimum = true;
+        node->minimum = number(schema, "minimum");
+    }
+
+    if (schema.containsKey("exclusiveMinimum")) {
+        auto value = number(schema, "exclusiveMinimum");
+        if (!node->hasMinimum || value >= node->minimum) {
+            node->hasMinimum = true;
+            node->exclusiveMinimum = true;
+            node->minimum = value;
+        }
+    }
+
+    if (schema.containsKey("maximum")) {
+        node->hasMaximum = true;
+        node->maximum = number(schema, "maximum");
+    }
+
+    if (schema.containsKey("exclusiveMaximum")) {
+        auto value = number(schema, "exclusiveMaximum");
+        if (!node->hasMaximum || value <= node->maximum) {
+            node->hasMaximum = true;
+            node->exclusiveMaximum = true;
+            node->maximum = value;
+        }
+    }
+
+    if (schema.containsKey("multipleOf")) {
+        node->multipleOf = number(schema, "multipleOf");
+        if (node->multipleOf <= 0) {
+            OB_THROW("multipleOf must be greater than 0");
+        }
+    }
+
+    if (schema.containsKey("minLength")) {
+        node->minLength = nonNegative(schema, "minLength");
+    }
+
+    if (schema.containsKey("maxLength")) {
+        node->maxLength = nonNegative(schema, "maxLength");
+    }
+
+    if (schema.containsKey("pattern")) {
+        node->patternSource = schema["pattern"].stringValue();
+        try {
+            node->pattern.reset(new std::regex(node->patternSource, std::regex::ECMAScript | std::regex::optimize));
+        } catch (std::regex_error&) {
+            OB_THROW("Invalid pattern: " + node->patternSource);
+        }
+    }
+
+    if (schema.containsKey("properties")) {
+        auto& properties = schema["properties"];
+        if (properties.type() != VariantType::Map) {
+            OB_THROW("properties must be an object");
+        }
+
+        for (auto& name : properties.mapKeys()) {
+            auto& slot = slotFor(*node, name);
+            slot.schema = compile(properties[name]);
+            slot.declared = true;
+        }
+    }
+
+    if (schema.containsKey("required")) {
+        auto& required = schema["required"];
+        if (required.type() != VariantType::Array) {
+            OB_THROW("required must be an array");
+        }
+
+        for (auto i = 0; i < required.size(); ++i) {
+            auto& slot = slotFor(*node, required[i].stringValue());
+            if (!slot.required) {
+                slot.required = true;
+                ++node->requiredCount;
+            }
+        }
+    }
+
+    if (schema.containsKey("additionalProperties")) {
+        auto& additional = schema["additionalProperties"];
+        if (additional.type() == VariantType::Bool) {
+            node->additionalAllowed = additional.boolValue();
+        } else {
+            node->additionalProperties = compile(additional);
+        }
+    }
+
+    if (schema.containsKey("minProperties")) {
+        node->minProperties = nonNegative(schema, "minProperties");
+    }
+
+    if (schema.containsKey("maxProperties")) {
+        node->maxProperties = nonNegative(schema, "maxProperties");
+    }
+
+    if (schema.containsKey("items")) {
+        node->items = compile(schema["items"]);
+    }
+
+    if (schema.containsKey("minItems")) {
+        node->minItems = nonNegative(schema, "minItems");
+    }
+
+    if (schema.containsKey("maxItems")) {
+        node->maxItems = nonNegative(schema, "maxItems");
+    }
+
+    if (schema.containsKey("uniqueItems")) {
+        node->uniqueItems = schema["uniqueItems"].boolValue();
+    }
+
+    if (schema.containsKey("allOf")) {
+        compileList(schema, "allOf", node->allOf);
+    }
+
+    if (schema.containsKey("anyOf")) {
+        compileList(schema, "anyOf", node->anyOf);
+    }
+
+    if (schema.containsKey("oneOf")) {
+        compileList(schema, "oneOf", node->oneOf);
+    }
+
+    if (schema.containsKey("not")) {
+        node->notSchema = compile(schema["not"]);
+    }
+
+    return node;
+}
+
+/*****************************************************************************/
+
+/**
+ * Records a failure. Returns false so callers can "return fail(...)".
+ */
+static bool fail(std::vector<std::string>* errors, const std::string& path, const std::string& message) {
+    if (errors) {
+        errors->push_back((path.empty() ? "/" : path) + ": " + message);
+    }
+
+    return false;
+}
+
+/*****************************************************************************/
+
+static bool run(const JsonSchema::Node& node, const Variant& value, std::string& path, std::vector<std::string>* errors);
+
+/*****************************************************************************/
+
+static bool runChild(const JsonSchema::Node& node, const Variant& value, std::string& path,
+                     const std::string& segment, std::vector<std::string>* errors) {
+    if (!errors) {
+        return run(node, value, path, nullptr);
+    }
+
+    auto length = path.size();
+    path += '/';
+
+    // JSON pointer escapes the characters it uses itself.
+    for (auto c : segment) {
+        if (c == '~') {
+            path += "~0";
+        } else if (c == '/') {
+            path += "~1";
+        } else {
+            path += c;
+        }
+    }
+
+    auto result = run(node, value, path, errors);
+    path.resize(length);
+
+    return result;
+}
+
+/*****************************************************************************/
+
+static bool runObject(const JsonSchema::Node& node, const Variant& value, std::string& path, std::vector<std::string>* errors) {
+    auto valid = true;
+    auto size = value.size();
+
+    if (node.minProperties >= 0 && size < node.minProperties) {
+        valid = fail(errors, path, "expected at least " + StringUtil::toString(node.minProperties) + " properties");
+    }
+
+    if (node.maxProperties >= 0 && size > node.maxProperties) {
+        valid = fail(errors, path, "expected at most " + StringUtil::toString(node.maxProperties) + " properties");
+    }
+
+    if (!valid && !errors) {
+        return false;
+    }
+
+    if (node.slots.empty() && node.additionalAllowed && !node.additionalProperties) {
+        return valid;
+    }
+
+    std::vector<bool> seen;
+    if (errors && node.requiredCount > 0) {
+        seen.resize(node.slots.size());
+    }
+
+    auto requiredSeen = 0;
+
+    for (auto& key : value.mapKeys()) {
+        auto& child = value[key];
+        auto itr = node.slotIndex.find(key);
+        auto declared = false;
+
+        if (itr != node.slotIndex.end()) {
+            auto& slot = node.slots[itr->second];
+            if (slot.required) {
+                ++requiredSeen;
+                if (!seen.empty()) {
+                    seen[itr->second] = true;
+                }
+            }
+
+            declared = slot.declared;
+            if (slot.schema && !runChild(*slot.schema, child, path, key, errors)) {
+                valid = false;
+            }
+        }
+
+        if (!declared) {
+            if (!node.additionalAllowed) {
+                valid = fail(errors, path, "unexpected property " + key);
+            } else if (node.additionalProperties && !runChild(*node.additionalProperties, child, path, key, errors)) {
+                valid = false;
+            }
+        }
+
+        if (!valid && !errors) {
+            return false;
+        }
+    }
+
+    if (requiredSeen < node.requiredCount) {
+        if (!errors) {
+            return false;
+        }
+
+        for (auto i = 0u; i < node.slots.size(); ++i) {
+            if (node.slots[i].required && !seen[i]) {
+                fail(errors, path, "missing required property " + node.slots[i].name);
+            }
+        }
+
+        valid = false;
+    }
+
+    return valid;
+}
+
+/*****************************************************************************/
+
+static bool runArray(const JsonSchema::Node& node, const Variant& value, std::string& path, std::vector<std::string>* errors) {
+    auto valid = true;
+    auto size = value.size();
+
+    if (node.minItems >= 0 && size < node.minItems) {
+        valid = fail(errors, path, "expected at least " + StringUtil::toString(node.minItems) + " items");
+    }
+
+    if (node.maxItems >= 0 && size > node.maxItems) {
+        valid = fail(errors, path, "expected at most " + StringUtil::toString(node.maxItems) + " items");
+    }
+
+    if (!valid && !errors) {
+        return false;
+    }
+
+    for (auto i = 0; i < size; ++i) {
+        auto& element = value[i];
+
+        if (node.items && !runChild(*node.items, element, path, StringUtil::toString(i), errors)) {
+            valid = false;
+        }
+
+        if (node.uniqueItems) {
+            for (auto j = 0; j < i; ++j) {
+                if (equals(value[j], element)) {
+                    valid = fail(errors, path, "items " + StringUtil::toString(j) + " and " + StringUtil::toString(i) + " are equal");
+                    break;
+                }
+            }
+        }
+
+        if (!valid && !errors) {
+            return false;
+        }
+    }
+
+    return valid;
+}
+
+/*****************************************************************************/
+
+static bool run(const JsonSchema::Node& node, const Variant& value, std::string& path, std::vector<std::string>* errors) {
+    if (node.alwaysFails) {
+        return fail(errors, path, "no value is allowed");
+    }
+
+    auto mask = valueTypeMask(value);
+
+    if (node.types != 0 && (node.types & mask) == 0) {
+        return fail(errors, path, "unexpected type");
+    }
+
+    auto valid = true;
+
+    if (!node.enumValues.empty()) {
+        auto found = false;
+        for (auto& candidate : node.enumValues) {
+            if (equals(candidate, value)) {
+                found = true;
+                break;
+            }
+        }
+
+        if (!found) {
+            valid = fail(errors, path, "value is not one of the allowed values");
+        }
+    }
+
+    if (node.hasConst && !equals(node.constValue, value)) {
+        valid = fail(errors, path, "value is not the constant value");
+    }
+
+    if (mask & TYPE_NUMBER) {
+        auto number = value.realValue();
+
+        if (node.hasMinimum && (node.exclusiveMinimum ? number <= node.minimum : number < node.minimum)) {
+            valid = fail(errors, path, "value is below the minimum " + StringUtil::toString(node.minimum));
+        }
+
+        if (node.hasMaximum && (node.exclusiveMaximum ? number >= node.maximum : number > node.maximum)) {
+            valid = fail(errors, path, "value is above the maximum " + StringUtil::toString(node.maximum));
+        }
+
+        if (node.multipleOf > 0) {
+            auto quotient = number / node.multipleOf;
+            if (std::fabs(quotient - std::round(quotient)) > 1e-9) {
+                valid = fail(errors, path, "value is not a multiple of " + StringUtil::toString(node.multipleOf));
+            }
+        }
+    } else if (mask & TYPE_STRING) {
+        if (node.minLength >= 0 || node.maxLength >= 0 || node.pattern) {
+            auto text = value.stringValue();
+
+            int64 length = 0;
+            for (auto c : text) {
+                if ((c & 0xc0) != 0x80) {
+                    ++length;
+                }
+            }
+
+            if (node.minLength >= 0 && length < node.minLength) {
+                valid = fail(errors, path, "string is shorter than " + StringUtil::toString(node.minLength));
+            }
+
+            if (node.maxLength >= 0 && length > node.maxLength) {
+                valid = fail(errors, path, "string is longer than " + StringUtil::toString(node.maxLength));
+            }
+
+            if (node.pattern && !std::regex_search(text, *node.pattern)) {
+                valid = fail(errors, path, "string does not match " + node.patternSource);
+            }
+        }
+    } else if (mask & TYPE_OBJECT) {
+        if (!runObject(node, value, path, errors)) {
+            valid = false;
+        }
+    } else if (mask & TYPE_ARRAY) {
+        if (!runArray(node, value, path, errors)) {
+            valid = false;
+        }
+    }
+
+    if (!valid && !errors) {
+        return false;
+    }
+
+    for (auto& schema : node.allOf) {
+        if (!run(*schema, value, path, errors)) {
+            valid = false;
+            if (!errors) {
+                return false;
+            }
+        }
+    }
+
+    if (!node.anyOf.empty()) {
+        auto matched = false;
+        for (auto& schema : node.anyOf) {
+            if (run(*schema, value, path, nullptr)) {
+                matched = true;
+                break;
+            }
+        }
+
+        if (!matched) {
+            valid = fail(errors, path, "value does not match any schema in anyOf");
+        }
+    }
+
+    if (!node.oneOf.empty()) {
+        auto matches = 0;
+        for (auto& schema : node.oneOf) {
+            if (run(*schema, value, path, nullptr) && ++matches > 1) {
+                break;
+            }
+        }
+
+        if (matches != 1) {
+            valid = fail(errors, path, "value must match exactly one schema in oneOf");
+        }
+    }
+
+    if (node.notSchema && run(*node.notSchema, value, path, nullptr)) {
+        valid = fail(errors, path, "value matches the schema in not");
+    }
+
+    return valid;
+}
+
+/*****************************************************************************/
+
+JsonSchema::JsonSchema(const Variant& schema)
+    : root_(compile(schema)) {
+}
+
+/*****************************************************************************/
+
+JsonSchema::~JsonSchema() {
+}
+
+/*****************************************************************************/
+
+bool JsonSchema::validate(const Variant& value) const {
+    std::string path;
+    return run(*root_, value, path, nullptr);
+}
+
+/*****************************************************************************/
+
+bool JsonSchema::validate(const Variant& value, std::vector<std::string>& errors) const {
+    std::string path;
+    return run(*root_, value, path, &errors);
+}
+
+/*****************************************************************************/
+
+}
@@ -0,0 +1,154 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#include <oblivion/core/layered_properties.h>
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+#ifndef WIN32
+extern char** environ;
+#endif
+
+namespace oblivion {
+
+/*****************************************************************************/
+
+LayeredProperties::LayeredProperties() {
+}
+
+/*****************************************************************************/
+
+void LayeredProperties::addLayer(Layer layer) {
+    layers_.push_back(std::move(layer));
+}
+
+/*****************************************************************************/
+
+void LayeredProperties::addLayer(Properties layer) {
+    layers_.push_back(std::make_shared<Properties>(std::move(layer)));
+}
+
+/*****************************************************************************/
+
+void LayeredProperties::addEnvironmentLayer(const std::string& prefix) {
+    addLayer(environment(prefix));
+}
+
+/*****************************************************************************/
+
+int32 LayeredProperties::layerCount() const {
+    return static_cast<int32>(layers_.size());
+}
+
+/*****************************************************************************/
+
+const LayeredProperties::Layer& LayeredProperties::layer(int32 index) const {
+    return layers_[index];
+}
+
+/*****************************************************************************/
+
+void LayeredProperties::setProperty(const std::string& name, const std::string& value) {
+    runtime_.setProperty(name, value);
+}
+
+/*****************************************************************************/
+
+const std::string& LayeredProperties::getProperty(const std::string& name) const {
+    static std::string EMPTY_STRING;
+
+    const Properties* layer = nullptr;
+    auto entry = find(name, layer);
+
+    return entry ? layer->text(*entry) : EMPTY_STRING;
+}
+
+/*****************************************************************************/
+
+bool LayeredProperties::contains(const std::string& name) const {
+    const Properties* layer = nullptr;
+    return find(name, layer) != nullptr;
+}
+
+/*****************************************************************************/
+
+Properties LayeredProperties::flatten() const {
+    Properties result;
+
+    for (auto& layer : layers_) {
+        for (auto& property : *layer) {
+            result.setProperty(property.first, property.second);
+        }
+    }
+
+    for (auto& property : runtime_) {
+        result.setProperty(property.first, property.second);
+    }
+
+    return result;
+}
+
+/*****************************************************************************/
+
+Properties LayeredProperties::environment(const std::string& prefix) {
+#ifdef WIN32
+    char** variables = _environ;
+#else
+    char** variables = environ;
+#endif
+
+    Properties result;
+
+    for (auto variable = variables; variable && *variable; ++variable) {
+        auto equals = strchr(*variable, '=');
+        if (!equals || strncmp(*variable, prefix.c_str(), prefix.size()) != 0 ||
+            *variable + prefix.size() >= equals) {
+            continue;
+        }
+
+        std::string name;
+        name.reserve(equals - *variable - prefix.size());
+
+        for (auto c = *variable + prefix.size(); c < equals; ++c) {
+            if (*c == '_') {
+                if (c + 1 < equals && c[1] == '_') {
+                    name += '_';
+                    ++c;
+                } else {
+                    name += '.';
+                }
+            } else {
+                name += static_cast<char>(tolower(static_cast<unsigned char>(*c)));
+            }
+        }
+
+        result.setProperty(name, equals + 1);
+    }
+
+    return result;
+}
+
+/*****************************************************************************/
+
+const Properties::Entry* LayeredProperties::find(const std::string& name, const Properties*& layer) const {
+    auto entry = runtime_.find(name);
+    if (entry) {
+        layer = &runtime_;
+        return entry;
+    }
+
+    for (auto itr = layers_.rbegin(); itr != layers_.rend(); ++itr) {
+        entry = (*itr)->find(name);
+        if (entry) {
+            layer = itr->get();
+            return entry;
+        }
+    }
+
+    return nullptr;
+}
+
+/*****************************************************************************/
+
+}
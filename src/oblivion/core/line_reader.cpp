@@ -0,0 +1,138 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#include <oblivion/core/line_reader.h>
+
+#include <cstring>
+
+#include <oblivion/core/file.h>
+#include <oblivion/core/mapped_file.h>
+
+namespace oblivion {
+
+/*****************************************************************************/
+
+const size_t LineReader::DEFAULT_BUFFER_SIZE;
+
+/*****************************************************************************/
+
+LineReader::LineReader(File& file, size_t bufferSize)
+    : file_(&file),
+      buffer_(bufferSize > 0 ? bufferSize : 1),
+      position_(buffer_.data()),
+      end_(buffer_.data()),
+      line_(nullptr),
+      size_(0),
+      lineNumber_(0),
+      eof_(false) {
+}
+
+/*****************************************************************************/
+
+LineReader::LineReader(const MappedFile& file)
+    : file_(nullptr),
+      position_(file.data()),
+      end_(file.data() + file.size()),
+      line_(nullptr),
+      size_(0),
+      lineNumber_(0),
+      eof_(true) {
+}
+
+/*****************************************************************************/
+
+LineReader::LineReader(const char* data, size_t size)
+    : file_(nullptr),
+      position_(data),
+      end_(data + size),
+      line_(nullptr),
+      size_(0),
+      lineNumber_(0),
+      eof_(true) {
+}
+
+/*****************************************************************************/
+
+bool LineReader::next() {
+    const char* newline = nullptr;
+    size_t scanned = 0;
+
+    // memchr is vectorized by the C library, so the search runs many bytes at a time.
+    // Bytes already searched are not searched again after the buffer is refilled.
+    for (;;) {
+        if (position_ + scanned < end_) {
+            newline = static_cast<const char*>(memchr(position_ + scanned, '\n', end_ - position_ - scanned));
+            if (newline) {
+                break;
+            }
+
+            scanned = end_ - position_;
+        }
+
+        if (eof_ || !fill()) {
+            break;
+        }
+    }
+
+    if (!newline && position_ == end_) {
+        line_ = nullptr;
+        size_ = 0;
+        return false;
+    }
+
+    auto lineEnd = newline ? newline : end_;
+
+    line_ = position_;
+    size_ = lineEnd - position_;
+    position_ = newline ? newline + 1 : end_;
+
+    if (size_ > 0 && line_[size_ - 1] == '\r') {
+        --size_;
+    }
+
+    ++lineNumber_;
+
+    return true;
+}
+
+/*****************************************************************************/
+
+std::string LineReader::str() const {
+    return std::string(line_, size_);
+}
+
+/*****************************************************************************/
+
+int64 LineReader::lineNumber() const {
+    return lineNumber_;
+}
+
+/*****************************************************************************/
+
+bool LineReader::fill() {
+    auto remaining = static_cast<size_t>(end_ - position_);
+
+    if (remaining == buffer_.size()) {
+        // The current line fills the buffer, so make room for the rest of it.
+        std::vector<char> larger(buffer_.size() * 2);
+        memcpy(larger.data(), position_, remaining);
+        buffer_.swap(larger);
+    } else if (remaining > 0) {
+        memmove(buffer_.data(), position_, remaining);
+    }
+
+    auto read = file_->read(buffer_.size() - remaining, buffer_.data() + remaining);
+
+    position_ = buffer_.data();
+    end_ = buffer_.data() + remaining + read;
+
+    if (read == 0) {
+        eof_ = true;
+        return false;
+    }
+
+    return true;
+}
+
+/*****************************************************************************/
+
+}
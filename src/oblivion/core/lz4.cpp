@@ -0,0 +1,333 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#include <oblivion/core/lz4.h>
+
+#include <cstring>
+
+#include <oblivion/core/exception.h>
+#include <oblivion/core/types.h>
+
+namespace oblivion {
+
+/*****************************************************************************/
+
+/**
+ * The shortest match the format can express.
+ */
+static const size_t MIN_MATCH = 4;
+
+/**
+ * The format requires the last bytes of a block to be literals, and the last
+ * match to start this far before the end.
+ */
+static const size_t LAST_LITERALS = 5;
+
+static const size_t MATCH_START_LIMIT = 12;
+
+static const size_t MAX_OFFSET = 65535;
+
+/**
+ * The size of the match finder's hash table, as a power of two. 4096 entries
+ * stay in the L1 cache.
+ */
+static const int32 HASH_BITS = 12;
+
+/**
+ * Controls how quickly the match finder skips ahead through data that does
+ * not compress: the step grows by one for every 2^SKIP_SHIFT bytes without a match.
+ */
+static const int32 SKIP_SHIFT = 6;
+
+/*****************************************************************************/
+
+static inline uint32 load32(const char* p) {
+    uint32 value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+/*****************************************************************************/
+
+static inline uint64 load64(const char* p) {
+    uint64 value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+/*****************************************************************************/
+
+/**
+ * Counts the leading bytes two 8-byte words have in common, given that they differ.
+ */
+static inline size_t commonBytes(uint64 difference) {
+#if defined(__GNUC__) && defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    return static_cast<size_t>(__builtin_ctzll(difference)) / 8;
+#else
+    char bytes[8];
+    memcpy(bytes, &difference, sizeof(bytes));
+
+    size_t count = 0;
+    while (bytes[count] == 0) {
+        ++count;
+    }
+
+    return count;
+#endif
+}
+
+/*****************************************************************************/
+
+/**
+ * Hashes the five bytes at a position, which finds more useful matches than
+ * hashing the four a match needs.
+ */
+static inline uint32 hashAt(const char* p) {
+    return static_cast<uint32>(((load64(p) << 24) * 889523592379ull) >> (64 - HASH_BITS));
+}
+
+/*****************************************************************************/
+
+/**
+ * Writes the part of a literal or match length past the 15 held in the token.
+ */
+static inline char* writeLength(char* out, size_t length) {
+    while (length >= 255) {
+        *out++ = static_cast<char>(255);
+        length -= 255;
+    }
+
+    *out++ = static_cast<char>(length);
+    return out;
+}
+
+/*****************************************************************************/
+
+/**
+ * Reads the continuation bytes of a literal or match length.
+ */
+static inline size_t readLength(const uint8*& in, const uint8* end) {
+    size_t length = 0;
+    uint8 byte;
+
+    do {
+        if (in == end) {
+            OB_THROW("Corrupt LZ4 block");
+        }
+
+        byte = *in++;
+        length += byte;
+    } while (byte == 255);
+
+    return length;
+}
+
+/*****************************************************************************/
+
+/**
+ * Writes one sequence: literals, then a match unless length is 0.
+ */
+static inline char* writeSequence(char* out, const char* literals, size_t literalCount,
+                                  size_t offset, size_t length) {
+    auto token = out++;
+
+    if (literalCount >= 15) {
+        *token = static_cast<char>(15 << 4);
+        out = writeLength(out, literalCount - 15);
+    } else {
+        *token = static_cast<char>(literalCount << 4);
+    }
+
+    memcpy(out, literals, literalCount);
+    out += literalCount;
+
+    if (length == 0) {
+        return out;
+    }
+
+    *out++ = static_cast<char>(offset & 0xff);
+    *out++ = static_cast<char>(offset >> 8);
+
+    length -= MIN_MATCH;
+    if (length >= 15) {
+        *token |= 15;
+        out = writeLength(out, length - 15);
+    } else {
+        *token |= static_cast<char>(length);
+    }
+
+    return out;
+}
+
+/*****************************************************************************/
+
+size_t Lz4::compressBound(size_t size) {
+    return size + size / 255 + 16;
+}
+
+/*****************************************************************************/
+
+size_t Lz4::compress(const char* data, size_t size, char* out) {
+    auto start = out;
+    size_t anchor = 0;
+
+    if (size > MATCH_START_LIMIT) {
+        uint32 table[1 << HASH_BITS];
+        memset(table, 0, sizeof(table));
+
+        auto limit = size - MATCH_START_LIMIT;
+        auto matchLimit = size - LAST_LITERALS;
+        size_t position = 1;
+
+        while (position < limit) {
+            auto sequence = load32(data + position);
+            auto& slot = table[hashAt(data + position)];
+            size_t candidate = slot;
+            slot = static_cast<uint32>(position);
+
+            // Stale or colliding entries are caught by comparing the bytes.
+            if (position - candidate > MAX_OFFSET || load32(data + candidate) != sequence) {
+                position += 1 + ((position - anchor) >> SKIP_SHIFT);
+                continue;
+            }
+
+            while (position > anchor && candidate > 0 && data[position - 1] == data[candidate - 1]) {
+                --position;
+                --candidate;
+            }
+
+            auto length = MIN_MATCH;
+            while (position + length + 8 <= matchLimit) {
+                auto difference = load64(data + position + length) ^ load64(data + candidate + length);
+                if (difference != 0) {
+                    length += commonBytes(difference);
+                    break;
+                }
+
+                length += 8;
+            }
+
+            if (position + length + 8 > matchLimit) {
+                while (position + length < matchLimit && data[position + length] == data[candidate + length]) {
+                    ++length;
+                }
+            }
+
+            out = writeSequence(out, data + anchor, position - anchor, position - candidate, length);
+
+            position += length;
+            anchor = position;
+
+            // Index a position inside the match so that repeats of it are found.
+            if (position < limit) {
+                table[hashAt(data + position - 2)] = static_cast<uint32>(position - 2);
+            }
+        }
+    }
+
+    out = writeSequence(out, data + anchor, size - anchor, 0, 0);
+    return static_cast<size_t>(out - start);
+}
+
+/*****************************************************************************/
+
+size_t Lz4::decompress(const char* data, size_t size, char* out, size_t capacity) {
+    auto in = reinterpret_cast<const uint8*>(data);
+    auto inEnd = in + size;
+    auto position = out;
+    auto outEnd = out + capacity;
+
+    for (;;) {
+        if (in == inEnd) {
+            OB_THROW("Corrupt LZ4 block");
+        }
+
+        auto token = *in++;
+        size_t literals = token >> 4;
+        size_t length = token & 15;
+
+        // Most sequences are short and far from the ends of the buffers. Their
+        // literals and match are copied in fixed-size pieces without length
+        // checks; the excess is overwritten by what follows.
+        if (literals < 15 && length < 15 && inEnd - in >= 16 + 2 && outEnd - position >= 32) {
+            memcpy(position, in, 16);
+            position += literals;
+            in += literals;
+
+            size_t offset = in[0] | (in[1] << 8);
+            if (offset >= 8 && offset <= static_cast<size_t>(position - out)) {
+                auto match = position - offset;
+                memcpy(position, match, 8);
+                memcpy(position + 8, match + 8, 8);
+                memcpy(position + 16, match + 16, 2);
+
+                position += length + MIN_MATCH;
+                in += 2;
+                continue;
+            }
+        } else {
+            if (literals == 15) {
+                literals += readLength(in, inEnd);
+            }
+
+            if (literals > static_cast<size_t>(inEnd - in) || literals > static_cast<size_t>(outEnd - position)) {
+                OB_THROW("Corrupt LZ4 block");
+            }
+
+            memcpy(position, in, literals);
+            position += literals;
+            in += literals;
+
+            // The last sequence has literals only.
+            if (in == inEnd) {
+                break;
+            }
+        }
+
+        if (inEnd - in < 2) {
+            OB_THROW("Corrupt LZ4 block");
+        }
+
+        size_t offset = in[0] | (in[1] << 8);
+        in += 2;
+
+        if (offset == 0 || offset > static_cast<size_t>(position - out)) {
+            OB_THROW("Corrupt LZ4 block");
+        }
+
+        if (length == 15) {
+            length += readLength(in, inEnd);
+        }
+
+        length += MIN_MATCH;
+        if (length > static_cast<size_t>(outEnd - position)) {
+            OB_THROW("Corrupt LZ4 block");
+        }
+
+        auto match = position - offset;
+        auto stop = position + length;
+
+        // Matches may overlap their own output, which is how runs are encoded.
+        // Eight bytes at a time is safe once the source is that far behind,
+        // and may run past the match while the output has room.
+        if (offset >= 8 && outEnd - stop >= 8) {
+            do {
+                memcpy(position, match, 8);
+                position += 8;
+                match += 8;
+            } while (position < stop);
+
+            position = stop;
+            continue;
+        }
+
+        while (position < stop) {
+            *position++ = *match++;
+        }
+    }
+
+    return static_cast<size_t>(position - out);
+}
+
+/*****************************************************************************/
+
+}
@@ -0,0 +1,358 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#include <oblivion/core/mapped_file.h>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <oblivion/core/exception.h>
+
+namespace oblivion {
+
+/**
+ * The private implementation of MappedFile for posix.
+ */
+struct MappedFile::Impl {
+
+    /**
+     * Opens the file.
+     * @see MappedFile::MappedFile.
+     */
+    Impl(const std::string& path, MapMode mode);
+
+    /**
+     * Unmaps and closes the file.
+     */
+    ~Impl();
+
+    /**
+     * Maps a range, replacing the current mapping.
+     * @see MappedFile::remap.
+     */
+    void map(uint64 offset, size_t size);
+
+    /**
+     * Removes the current mapping.
+     */
+    void unmap();
+
+    /**
+     * @see MappedFile::fileSize.
+     */
+    uint64 fileSize() const;
+
+    std::string path_;
+
+    MapMode mode_;
+
+    int fd_;
+
+    /**
+     * The page-aligned start and length of the mapping.
+     */
+    char* base_;
+
+    size_t length_;
+
+    /**
+     * The requested range inside the mapping.
+     */
+    char* data_;
+
+    size_t size_;
+
+    uint64 offset_;
+
+};
+
+/*****************************************************************************/
+
+MappedFile::MappedFile(const std::string& path, MapMode mode)
+    : impl_(new Impl(path, mode)) {
+    impl_->map(0, static_cast<size_t>(impl_->fileSize()));
+}
+
+/*****************************************************************************/
+
+MappedFile::MappedFile(const std::string& path, MapMode mode, uint64 offset, size_t size)
+    : impl_(new Impl(path, mode)) {
+    impl_->map(offset, size);
+}
+
+/*****************************************************************************/
+
+MappedFile::MappedFile(MappedFile&& other)
+    : impl_(std::move(other.impl_)) {
+}
+
+/*****************************************************************************/
+
+MappedFile::~MappedFile() {
+}
+
+/*****************************************************************************/
+
+MappedFile& MappedFile::operator =(MappedFile&& other) {
+    impl_ = std::move(other.impl_);
+    return *this;
+}
+
+/*****************************************************************************/
+
+const char* MappedFile::data() const {
+    return impl_ ? impl_->data_ : nullptr;
+}
+
+/*****************************************************************************/
+
+char* MappedFile::mutableData() {
+    auto& impl = this->impl();
+    if (impl.mode_ != MapMode::ReadWrite) {
+        OB_THROW("File is mapped read-only: %s", impl.path_.c_str());
+    }
+
+    return impl.data_;
+}
+
+/*****************************************************************************/
+
+size_t MappedFile::size() const {
+    return impl_ ? impl_->size_ : 0;
+}
+
+/*****************************************************************************/
+
+bool MappedFile::empty() const {
+    return size() == 0;
+}
+
+/*****************************************************************************/
+
+const char* MappedFile::begin() const {
+    return data();
+}
+
+/*****************************************************************************/
+
+const char* MappedFile::end() const {
+    return data() + size();
+}
+
+/*****************************************************************************/
+
+char MappedFile::operator [](size_t index) const {
+    return data()[index];
+}
+
+/*****************************************************************************/
+
+uint64 MappedFile::offset() const {
+    return impl_ ? impl_->offset_ : 0;
+}
+
+/*****************************************************************************/
+
+uint64 MappedFile::fileSize() const {
+    return impl().fileSize();
+}
+
+/*****************************************************************************/
+
+const std::string& MappedFile::path() const {
+    return impl().path_;
+}
+
+/*****************************************************************************/
+
+void MappedFile::advise(MapAdvice advice, size_t offset, size_t size) {
+    if (!impl_ || !impl_->base_ || offset >= impl_->size_) {
+        return;
+    }
+
+    if (size == 0 || size > impl_->size_ - offset) {
+        size = impl_->size_ - offset;
+    }
+
+    int flag;
+    switch (advice) {
+    case MapAdvice::Sequential:
+        flag = MADV_SEQUENTIAL;
+        break;
+    case MapAdvice::Random:
+        flag = MADV_RANDOM;
+        break;
+    case MapAdvice::WillNeed:
+        flag = MADV_WILLNEED;
+        break;
+    case MapAdvice::DontNeed:
+        flag = MADV_DONTNEED;
+        break;
+    case MapAdvice::HugePage:
+#ifdef MADV_HUGEPAGE
+        flag = MADV_HUGEPAGE;
+        break;
+#else
+        return;
+#endif
+    default:
+        flag = MADV_NORMAL;
+        break;
+    }
+
+    // madvise needs a page-aligned start.
+    auto start = impl_->data_ + offset;
+    auto pageSize = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    auto aligned = impl_->base_ + ((start - impl_->base_) / pageSize) * pageSize;
+
+    madvise(aligned, size + (start - aligned), flag);
+}
+
+/*****************************************************************************/
+
+void MappedFile::remap() {
+    impl().map(0, static_cast<size_t>(impl().fileSize()));
+}
+
+/*****************************************************************************/
+
+void MappedFile::remap(uint64 offset, size_t size) {
+    impl().map(offset, size);
+}
+
+/*****************************************************************************/
+
+void MappedFile::resize(uint64 size) {
+    if (impl().mode_ != MapMode::ReadWrite) {
+        OB_THROW("File is mapped read-only: %s", impl_->path_.c_str());
+    }
+
+    if (ftruncate(impl_->fd_, static_cast<off_t>(size)) != 0) {
+        OB_THROW("Unable to resize file: %s", impl_->path_.c_str());
+    }
+
+    impl_->map(0, static_cast<size_t>(size));
+}
+
+/*****************************************************************************/
+
+void MappedFile::sync() {
+    if (impl_ && impl_->base_ && msync(impl_->base_, impl_->length_, MS_SYNC) != 0) {
+        OB_THROW("Unable to sync mapped file: %s", impl_->path_.c_str());
+    }
+}
+
+/*****************************************************************************/
+
+MappedFile::Impl& MappedFile::impl() const {
+    if (!impl_) {
+        OB_THROW("Mapped file has been moved from");
+    }
+
+    return *impl_;
+}
+
+/*****************************************************************************/
+
+MappedFile::Impl::Impl(const std::string& path, MapMode mode)
+    : path_(path),
+      mode_(mode),
+      base_(nullptr),
+      length_(0),
+      data_(nullptr),
+      size_(0),
+      offset_(0) {
+    fd_ = open(path.c_str(), (mode == MapMode::ReadWrite ? O_RDWR : O_RDONLY) | O_CLOEXEC);
+
+    if (fd_ < 0) {
+        OB_THROW("Unable to open file: %s", path.c_str());
+    }
+}
+
+/*****************************************************************************/
+
+MappedFile::Impl::~Impl() {
+    unmap();
+    close(fd_);
+}
+
+/*****************************************************************************/
+
+void MappedFile::Impl::map(uint64 offset, size_t size) {
+    auto pageSize = static_cast<uint64>(sysconf(_SC_PAGESIZE));
+    auto alignedOffset = (offset / pageSize) * pageSize;
+    auto length = static_cast<size_t>(size + (offset - alignedOffset));
+
+    if (size == 0) {
+        unmap();
+        offset_ = offset;
+        return;
+    }
+
+    // Pages past the end of the file would fault on access. As on Windows, a
+    // writable mapping grows the file to cover them and a read-only one fails.
+    if (offset + size > fileSize()) {
+        if (mode_ != MapMode::ReadWrite) {
+            OB_THROW("Unable to map past the end of file: %s", path_.c_str());
+        }
+
+        if (ftruncate(fd_, static_cast<off_t>(offset + size)) != 0) {
+            OB_THROW("Unable to resize file: %s", path_.c_str());
+        }
+    }
+
+    int protection = mode_ == MapMode::ReadWrite ? PROT_READ | PROT_WRITE : PROT_READ;
+    void* base = MAP_FAILED;
+
+#ifdef MREMAP_MAYMOVE
+    // Growing or shrinking from the same start keeps the existing page tables.
+    if (base_ && offset_ - (data_ - base_) == alignedOffset) {
+        base = mremap(base_, length_, length, MREMAP_MAYMOVE);
+    }
+#endif
+
+    if (base == MAP_FAILED) {
+        base = mmap(nullptr, length, protection, MAP_SHARED, fd_, static_cast<off_t>(alignedOffset));
+
+        if (base == MAP_FAILED) {
+            OB_THROW("Unable to map file: %s", path_.c_str());
+        }
+
+        unmap();
+    }
+
+    base_ = static_cast<char*>(base);
+    length_ = length;
+    data_ = base_ + (offset - alignedOffset);
+    size_ = size;
+    offset_ = offset;
+}
+
+/*****************************************************************************/
+
+void MappedFile::Impl::unmap() {
+    if (base_) {
+        munmap(base_, length_);
+    }
+
+    base_ = nullptr;
+    length_ = 0;
+    data_ = nullptr;
+    size_ = 0;
+}
+
+/*****************************************************************************/
+
+uint64 MappedFile::Impl::fileSize() const {
+    struct stat status;
+    if (fstat(fd_, &status) != 0) {
+        OB_THROW("Unable to stat file: %s", path_.c_str());
+    }
+
+    return static_cast<uint64>(status.st_size);
+}
+
+/*****************************************************************************/
+
+}
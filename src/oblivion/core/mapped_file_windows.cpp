@@ -0,0 +1,317 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#include <oblivion/core/mapped_file.h>
+
+#include <oblivion/core/exception.h>
+#include <oblivion/core/windows.h>
+
+namespace oblivion {
+
+/**
+ * The private implementation of MappedFile for windows.
+ */
+struct MappedFile::Impl {
+
+    /**
+     * Opens the file.
+     * @see MappedFile::MappedFile.
+     */
+    Impl(const std::string& path, MapMode mode);
+
+    /**
+     * Unmaps and closes the file.
+     */
+    ~Impl();
+
+    /**
+     * Maps a range, replacing the current mapping.
+     * @see MappedFile::remap.
+     */
+    void map(uint64 offset, size_t size);
+
+    /**
+     * Removes the current mapping.
+     */
+    void unmap();
+
+    /**
+     * @see MappedFile::fileSize.
+     */
+    uint64 fileSize() const;
+
+    std::string path_;
+
+    MapMode mode_;
+
+    HANDLE file_;
+
+    /**
+     * The view, which starts at a multiple of the allocation granularity.
+     */
+    char* base_;
+
+    /**
+     * The requested range inside the view.
+     */
+    char* data_;
+
+    size_t size_;
+
+    uint64 offset_;
+
+};
+
+/*****************************************************************************/
+
+MappedFile::MappedFile(const std::string& path, MapMode mode)
+    : impl_(new Impl(path, mode)) {
+    impl_->map(0, static_cast<size_t>(impl_->fileSize()));
+}
+
+/*****************************************************************************/
+
+MappedFile::MappedFile(const std::string& path, MapMode mode, uint64 offset, size_t size)
+    : impl_(new Impl(path, mode)) {
+    impl_->map(offset, size);
+}
+
+/*****************************************************************************/
+
+MappedFile::MappedFile(MappedFile&& other)
+    : impl_(std::move(other.impl_)) {
+}
+
+/*****************************************************************************/
+
+MappedFile::~MappedFile() {
+}
+
+/*****************************************************************************/
+
+MappedFile& MappedFile::operator =(MappedFile&& other) {
+    impl_ = std::move(other.impl_);
+    return *this;
+}
+
+/*****************************************************************************/
+
+const char* MappedFile::data() const {
+    return impl_ ? impl_->data_ : nullptr;
+}
+
+/*****************************************************************************/
+
+char* MappedFile::mutableData() {
+    auto& impl = this->impl();
+    if (impl.mode_ != MapMode::ReadWrite) {
+        OB_THROW("File is mapped read-only: %s", impl.path_.c_str());
+    }
+
+    return impl.data_;
+}
+
+/*****************************************************************************/
+
+size_t MappedFile::size() const {
+    return impl_ ? impl_->size_ : 0;
+}
+
+/*****************************************************************************/
+
+bool MappedFile::empty() const {
+    return size() == 0;
+}
+
+/*****************************************************************************/
+
+const char* MappedFile::begin() const {
+    return data();
+}
+
+/*****************************************************************************/
+
+const char* MappedFile::end() const {
+    return data() + size();
+}
+
+/*****************************************************************************/
+
+char MappedFile::operator [](size_t index) const {
+    return data()[index];
+}
+
+/*****************************************************************************/
+
+uint64 MappedFile::offset() const {
+    return impl_ ? impl_->offset_ : 0;
+}
+
+/*****************************************************************************/
+
+uint64 MappedFile::fileSize() const {
+    return impl().fileSize();
+}
+
+/*****************************************************************************/
+
+const std::string& MappedFile::path() const {
+    return impl().path_;
+}
+
+/*****************************************************************************/
+
+void MappedFile::advise(MapAdvice, size_t, size_t) {
+    // Windows has no portable equivalent of madvise for mapped views.
+}
+
+/*****************************************************************************/
+
+void MappedFile::remap() {
+    impl().map(0, static_cast<size_t>(impl().fileSize()));
+}
+
+/*****************************************************************************/
+
+void MappedFile::remap(uint64 offset, size_t size) {
+    impl().map(offset, size);
+}
+
+/*****************************************************************************/
+
+void MappedFile::resize(uint64 size) {
+    if (impl().mode_ != MapMode::ReadWrite) {
+        OB_THROW("File is mapped read-only: %s", impl_->path_.c_str());
+    }
+
+    // A file cannot be truncated while a view of it is open.
+    impl_->unmap();
+
+    LARGE_INTEGER position;
+    position.QuadPart = static_cast<LONGLONG>(size);
+
+    if (!SetFilePointerEx(impl_->file_, position, NULL, FILE_BEGIN) || !SetEndOfFile(impl_->file_)) {
+        OB_THROW("Unable to resize file: %s", impl_->path_.c_str());
+    }
+
+    impl_->map(0, static_cast<size_t>(size));
+}
+
+/*****************************************************************************/
+
+void MappedFile::sync() {
+    if (impl_ && impl_->base_ && (!FlushViewOfFile(impl_->base_, 0) || !FlushFileBuffers(impl_->file_))) {
+        OB_THROW("Unable to sync mapped file: %s", impl_->path_.c_str());
+    }
+}
+
+/*****************************************************************************/
+
+MappedFile::Impl& MappedFile::impl() const {
+    if (!impl_) {
+        OB_THROW("Mapped file has been moved from");
+    }
+
+    return *impl_;
+}
+
+/*****************************************************************************/
+
+MappedFile::Impl::Impl(const std::string& path, MapMode mode)
+    : path_(path),
+      mode_(mode),
+      base_(nullptr),
+      data_(nullptr),
+      size_(0),
+      offset_(0) {
+    DWORD access = mode == MapMode::ReadWrite ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ;
+
+    // Sharing delete lets a new file be renamed over this one while it is mapped.
+    file_ = CreateFileA(path.c_str(), access, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if (file_ == INVALID_HANDLE_VALUE) {
+        OB_THROW("Unable to open file: %s", path.c_str());
+    }
+}
+
+/*****************************************************************************/
+
+MappedFile::Impl::~Impl() {
+    unmap();
+    CloseHandle(file_);
+}
+
+/*****************************************************************************/
+
+void MappedFile::Impl::map(uint64 offset, size_t size) {
+    unmap();
+    offset_ = offset;
+
+    if (size == 0) {
+        return;
+    }
+
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+
+    auto granularity = static_cast<uint64>(info.dwAllocationGranularity);
+    auto alignedOffset = (offset / granularity) * granularity;
+    auto end = offset + size;
+
+    bool writable = mode_ == MapMode::ReadWrite;
+
+    // A writable mapping past the end of the file grows it; report a read-only
+    // one the same way as on posix.
+    if (!writable && end > fileSize()) {
+        OB_THROW("Unable to map past the end of file: %s", path_.c_str());
+    }
+
+    HANDLE mapping = CreateFileMappingA(file_, NULL, writable ? PAGE_READWRITE : PAGE_READONLY,
+        static_cast<DWORD>(end >> 32), static_cast<DWORD>(end), NULL);
+
+    if (!mapping) {
+        OB_THROW("Unable to map file: %s", path_.c_str());
+    }
+
+    void* view = MapViewOfFile(mapping, writable ? FILE_MAP_WRITE : FILE_MAP_READ,
+        static_cast<DWORD>(alignedOffset >> 32), static_cast<DWORD>(alignedOffset),
+        static_cast<SIZE_T>(end - alignedOffset));
+
+    // The view keeps the mapping alive.
+    CloseHandle(mapping);
+
+    if (!view) {
+        OB_THROW("Unable to map file: %s", path_.c_str());
+    }
+
+    base_ = static_cast<char*>(view);
+    data_ = base_ + (offset - alignedOffset);
+    size_ = size;
+}
+
+/*****************************************************************************/
+
+void MappedFile::Impl::unmap() {
+    if (base_) {
+        UnmapViewOfFile(base_);
+    }
+
+    base_ = nullptr;
+    data_ = nullptr;
+    size_ = 0;
+}
+
+/*****************************************************************************/
+
+uint64 MappedFile::Impl::fileSize() const {
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file_, &size)) {
+        OB_THROW("Unable to stat file: %s", path_.c_str());
+    }
+
+    return static_cast<uint64>(size.QuadPart);
+}
+
+/*****************************************************************************/
+
+}
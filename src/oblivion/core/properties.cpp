@@ -3,29 +3,99 @@
 
 #include <oblivion/core/properties.h>
 
-#include <iostream>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_set>
 
 #include <oblivion/core/exception.h>
-#include <oblivion/core/file.h>
+#include <oblivion/core/file_util.h>
+#include <oblivion/core/line_reader.h>
 #include <oblivion/core/string_util.h>
 
 namespace oblivion {
 
 /*****************************************************************************/
 
-Properties::Properties() {
+/**
+ * The number of references followed before the references are considered circular.
+ */
+static const int32 MAX_REFERENCE_DEPTH = 64;
+
+/*****************************************************************************/
+
+Properties::Properties()
+    : sortedCount_(0),
+      count_(0),
+      interpolation_(false) {
+}
+
+/*****************************************************************************/
+
+Properties::Properties(const Properties& other)
+    : entries_(other.entries_),
+      sortedCount_(0),
+      count_(other.count_),
+      interpolation_(other.interpolation_) {
+    // Sort first, since readers of other may be sorting it concurrently.
+    other.sort();
+    sorted_ = other.sorted_;
+    sortedCount_ = sorted_.size();
+
+    reindex();
+}
+
+/*****************************************************************************/
+
+Properties::Properties(Properties&& other)
+    : entries_(std::move(other.entries_)),
+      index_(std::move(other.index_)),
+      sorted_(std::move(other.sorted_)),
+      sortedCount_(other.sortedCount_.load()),
+      count_(other.count_),
+      interpolation_(other.interpolation_) {
+    other.sortedCount_ = 0;
+    other.count_ = 0;
 }
 
 /*****************************************************************************/
 
-Properties::Properties(const std::string& path) {
+Properties::Properties(const std::string& path)
+    : sortedCount_(0),
+      count_(0),
+      interpolation_(false) {
     load(path);
 }
 
 /*****************************************************************************/
 
+Properties& Properties::operator =(const Properties& other) {
+    if (this != &other) {
+        *this = Properties(other);
+    }
+
+    return *this;
+}
+
+/*****************************************************************************/
+
+Properties& Properties::operator =(Properties&& other) {
+    entries_ = std::move(other.entries_);
+    index_ = std::move(other.index_);
+    sorted_ = std::move(other.sorted_);
+    sortedCount_ = other.sortedCount_.load();
+    count_ = other.count_;
+    interpolation_ = other.interpolation_;
+    other.sortedCount_ = 0;
+    other.count_ = 0;
+
+    return *this;
+}
+
+/*****************************************************************************/
+
 void Properties::setProperty(const std::string& name, const std::string& value) {
-    properties_[name] = value;
+    put(name, value.data(), value.data() + value.size());
 }
 
 /*****************************************************************************/
@@ -33,9 +103,9 @@ void Properties::setProperty(const std::string& name, const std::string& value)
 const std::string& Properties::getProperty(const std::string& name) const {
     static std::string EMPTY_STRING;
 
-    auto itr = properties_.find(name);
-    if (itr != properties_.end()) {
-        return itr->second;
+    auto entry = find(name);
+    if (entry) {
+        return text(*entry);
     }
 
     return EMPTY_STRING;
@@ -43,76 +113,630 @@ const std::string& Properties::getProperty(const std::string& name) const {
 
 /*****************************************************************************/
 
+void Properties::setInterpolation(bool enabled) {
+    if (interpolation_ == enabled) {
+        return;
+    }
+
+    interpolation_ = enabled;
+
+    // Typed values were converted from the other form of the text.
+    for (auto& entry : entries_) {
+        entry.invalidate();
+    }
+}
+
+/*****************************************************************************/
+
+bool Properties::interpolation() const {
+    return interpolation_;
+}
+
+/*****************************************************************************/
+
 bool Properties::contains(const std::string& name) const {
-    return properties_.find(name) != properties_.end();
+    return find(name) != nullptr;
 }
 
 /*****************************************************************************/
 
-void Properties::save(const std::string& path) const {
-    File file(path, "wb");
-    
-    for (auto& entry : properties_) {
-        file.writeLine(entry.first + " = " + entry.second);
+static void appendProperty(std::string& contents, const Properties::value_type& property) {
+    contents.append(property.first);
+    contents.append(" = ", 3);
+    contents.append(property.second);
+    contents.push_back('\n');
+}
+
+/*****************************************************************************/
+
+void Properties::save(const std::string& path, bool sorted) const {
+    size_t size = 0;
+    for (auto& property : *this) {
+        size += property.first.size() + property.second.size() + 4;
     }
+
+    std::string contents;
+    contents.reserve(size);
+
+    if (sorted) {
+        for (auto& property : view("")) {
+            appendProperty(contents, property);
+        }
+    } else {
+        for (auto& property : *this) {
+            appendProperty(contents, property);
+        }
+    }
+
+    auto temporary = path + ".tmp";
+
+    try {
+        FileUtil::writeAll(temporary, contents, true);
+    } catch (...) {
+        if (FileUtil::exists(temporary)) {
+            FileUtil::remove(temporary);
+        }
+
+        throw;
+    }
+
+    FileUtil::rename(temporary, path);
 }
 
 /*****************************************************************************/
 
 void Properties::load(const std::string& path) {
-    File file(path, "rb");
+    auto contents = FileUtil::readAll(path);
+    parse(contents.data(), contents.size());
+}
+
+/*****************************************************************************/
+
+static inline bool isSpace(char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+/*****************************************************************************/
+
+static inline void trim(const char*& begin, const char*& end) {
+    while (begin < end && isSpace(*begin)) {
+        ++begin;
+    }
+
+    while (end > begin && isSpace(end[-1])) {
+        --end;
+    }
+}
+
+/*****************************************************************************/
+
+void Properties::parse(const char* data, size_t size) {
+    auto end = data + size;
+
+    size_t lineCount = 0;
+    for (auto p = data; p < end && (p = static_cast<const char*>(memchr(p, '\n', end - p))); ++p) {
+        ++lineCount;
+    }
+
+    index_.reserve(index_.size() + lineCount + 1);
+
+    LineReader lines(data, size);
+
+    while (lines.next()) {
+        auto lineBegin = lines.data();
+        auto lineEnd = lineBegin + lines.size();
 
-    while (!file.eof()) {
-        auto line = file.readLine();
-        StringUtil::trim(line);
+        trim(lineBegin, lineEnd);
 
-        if (StringUtil::startsWith(line, "#") || line.empty()) {
+        if (lineBegin == lineEnd || *lineBegin == '#') {
             continue;
         }
 
-        auto equalsPos = line.find_first_of("=");
-        if (equalsPos == std::string::npos) {
-            OB_THROW("Invalid property line: %s", line.c_str());
+        auto equals = static_cast<const char*>(memchr(lineBegin, '=', lineEnd - lineBegin));
+        if (!equals) {
+            OB_THROW("Invalid property line: " + std::string(lineBegin, lineEnd));
         }
 
-        auto name = line.substr(0, equalsPos);
-        StringUtil::trim(name);
+        auto nameBegin = lineBegin;
+        auto nameEnd = equals;
+        trim(nameBegin, nameEnd);
 
-        auto value = line.substr(equalsPos + 1);
-        StringUtil::trim(value);
+        auto valueBegin = equals + 1;
+        auto valueEnd = lineEnd;
+        trim(valueBegin, valueEnd);
 
-        set(name, value);
+        put(std::string(nameBegin, nameEnd), valueBegin, valueEnd);
     }
 }
 
 /*****************************************************************************/
 
+Properties::View Properties::view(const std::string& prefix) const {
+    sort();
+
+    auto compare = [this, &prefix](int32 slot) {
+        return entries_[slot].property.first.compare(0, prefix.size(), prefix);
+    };
+
+    auto begin = sorted_.data();
+    auto end = begin + sorted_.size();
+
+    // Names sharing the prefix are contiguous in sorted order.
+    auto first = std::lower_bound(begin, end, 0, [&](int32 slot, int) { return compare(slot) < 0; });
+    auto last = std::upper_bound(first, end, 0, [&](int, int32 slot) { return compare(slot) > 0; });
+
+    return View(this, prefix, first, last);
+}
+
+/*****************************************************************************/
+
 Properties::const_iterator Properties::begin() const {
-    return properties_.begin();
+    return const_iterator(entries_.begin(), entries_.end());
 }
 
 /*****************************************************************************/
 
 Properties::const_iterator Properties::end() const {
-    return properties_.end();
+    return const_iterator(entries_.end(), entries_.end());
 }
 
 /*****************************************************************************/
 
 int32 Properties::size() const {
-    return static_cast<int32>(properties_.size());
+    return count_;
 }
 
 /*****************************************************************************/
 
 bool Properties::empty() const {
-    return properties_.empty();
+    return count_ == 0;
 }
 
 /*****************************************************************************/
 
 void Properties::clear() {
-    properties_.clear();
+    for (auto& entry : entries_) {
+        std::string().swap(entry.property.second);
+        entry.present = false;
+        entry.templated = false;
+        entry.links.reset();
+        entry.invalidate();
+    }
+
+    count_ = 0;
+}
+
+/*****************************************************************************/
+
+const Properties::Entry* Properties::find(const std::string& name) const {
+    auto itr = index_.find(&name);
+    if (itr == index_.end()) {
+        return nullptr;
+    }
+
+    auto& entry = entries_[itr->second];
+    return entry.present ? &entry : nullptr;
+}
+
+/*****************************************************************************/
+
+int32 Properties::resolve(const std::string& name) {
+    auto itr = index_.find(&name);
+    if (itr != index_.end()) {
+        return itr->second;
+    }
+
+    entries_.emplace_back(name, std::string());
+    entries_.back().present = false;
+
+    auto slot = static_cast<int32>(entries_.size() - 1);
+    index_.emplace(&entries_.back().property.first, slot);
+    sorted_.push_back(slot);
+
+    return slot;
+}
+
+/*****************************************************************************/
+
+void Properties::put(std::string name, const char* valueBegin, const char* valueEnd) {
+    auto itr = index_.find(&name);
+    int32 slot;
+
+    if (itr != index_.end()) {
+        slot = itr->second;
+
+        auto& entry = entries_[slot];
+        entry.property.second.assign(valueBegin, valueEnd);
+
+        if (!entry.present) {
+            entry.present = true;
+            ++count_;
+        }
+    } else {
+        entries_.emplace_back(std::move(name), std::string(valueBegin, valueEnd));
+        slot = static_cast<int32>(entries_.size() - 1);
+        index_.emplace(&entries_.back().property.first, slot);
+        sorted_.push_back(slot);
+        ++count_;
+    }
+
+    link(slot);
+    changed(slot);
+}
+
+/*****************************************************************************/
+
+/**
+ * Splits a value into literal text and ${name} references.
+ * @param value The value to split.
+ * @param literal Called with the start and end of each run of literal text.
+ * @param reference Called with the start and end of each referenced name.
+ */
+template <typename Literal, typename Reference>
+static void scan(const std::string& value, Literal literal, Reference reference) {
+    size_t start = 0;
+    size_t i = 0;
+
+    while ((i = value.find('$', i)) != std::string::npos) {
+        if (value.compare(i, 3, "$${") == 0) {
+            // Emit the text up to and including the first $, and skip the second.
+            literal(start, i + 1);
+            start = i + 2;
+            i += 3;
+        } else if (value.compare(i, 2, "${") == 0) {
+            auto close = value.find('}', i + 2);
+            if (close == std::string::npos) {
+                break;
+            }
+
+            literal(start, i);
+            reference(i + 2, close);
+            start = i = close + 1;
+        } else {
+            ++i;
+        }
+    }
+
+    literal(start, value.size());
+}
+
+/*****************************************************************************/
+
+void Properties::link(int32 slot) {
+    auto& entry = entries_[slot];
+
+    if (entry.links) {
+        for (auto reference : entry.links->references) {
+            auto& dependents = entries_[reference].links->dependents;
+            dependents.erase(std::remove(dependents.begin(), dependents.end(), slot), dependents.end());
+        }
+
+        entry.links->references.clear();
+    }
+
+    entry.templated = entry.property.second.find("${") != std::string::npos;
+    if (!entry.templated) {
+        return;
+    }
+
+    // Copy the value, since creating slots for the references may grow entries_.
+    auto value = entry.property.second;
+
+    scan(value, [](size_t, size_t) { }, [&](size_t begin, size_t end) {
+        if (value.compare(begin, 4, "env:") == 0) {
+            return;
+        }
+
+        auto target = resolve(value.substr(begin, end - begin));
+        auto& source = entries_[slot];
+        auto& referenced = entries_[target];
+
+        if (!source.links) {
+            source.links.reset(new Entry::Links());
+        }
+
+        if (!referenced.links) {
+            referenced.links.reset(new Entry::Links());
+        }
+
+        auto& references = source.links->references;
+        if (std::find(references.begin(), references.end(), target) == references.end()) {
+            references.push_back(target);
+            referenced.links->dependents.push_back(slot);
+        }
+    });
+}
+
+/*****************************************************************************/
+
+void Properties::changed(int32 slot) {
+    auto& entry = entries_[slot];
+    entry.invalidate();
+
+    if (!entry.links || entry.links->dependents.empty()) {
+        return;
+    }
+
+    // Only the slots reached are tracked, so a change costs the size of its dependents.
+    std::unordered_set<int32> visited;
+    std::vector<int32> pending(1, slot);
+    visited.insert(slot);
+
+    while (!pending.empty()) {
+        auto current = pending.back();
+        pending.pop_back();
+
+        auto& links = entries_[current].links;
+        if (!links) {
+            continue;
+        }
+
+        for (auto dependent : links->dependents) {
+            if (visited.insert(dependent).second) {
+                entries_[dependent].invalidate();
+                pending.push_back(dependent);
+            }
+        }
+    }
+}
+
+/*****************************************************************************/
+
+const std::string& Properties::expand(const Entry& entry, int32 depth) const {
+    auto cached = entry.expanded.load(std::memory_order_acquire);
+    if (cached) {
+        return *cached;
+    }
+
+    if (depth > MAX_REFERENCE_DEPTH) {
+        OB_THROW("Circular property reference in: " + entry.property.first);
+    }
+
+    auto& value = entry.property.second;
+    std::unique_ptr<std::string> result(new std::string());
+    result->reserve(value.size());
+
+    scan(value, [&](size_t begin, size_t end) {
+        result->append(value, begin, end - begin);
+    }, [&](size_t begin, size_t end) {
+        if (value.compare(begin, 4, "env:") == 0) {
+            auto variable = getenv(value.substr(begin + 4, end - begin - 4).c_str());
+            if (variable) {
+                result->append(variable);
+            }
+
+            return;
+        }
+
+        auto referenced = find(value.substr(begin, end - begin));
+        if (referenced) {
+            result->append(referenced->templated ? expand(*referenced, depth + 1) : referenced->property.second);
+        }
+    });
+
+    // Readers of a shared const instance may race to fill the cache; the first
+    // one wins. The value is stored in the string that earlier expansions used,
+    // so references returned before a change still point at a live string.
+    std::lock_guard<std::mutex> lock(expandMutex_);
+
+    auto filled = entry.expanded.load(std::memory_order_acquire);
+    if (filled) {
+        return *filled;
+    }
+
+    if (!entry.storage) {
+        entry.storage = std::move(result);
+    } else {
+        entry.storage->swap(*result);
+    }
+
+    entry.expanded.store(entry.storage.get(), std::memory_order_release);
+    return *entry.storage;
+}
+
+/*****************************************************************************/
+
+void Properties::reindex() {
+    index_.clear();
+    index_.reserve(entries_.size());
+
+    for (auto i = 0u; i < entries_.size(); ++i) {
+        index_.emplace(&entries_[i].property.first, static_cast<int32>(i));
+    }
+}
+
+/*****************************************************************************/
+
+void Properties::sort() const {
+    if (sortedCount_.load(std::memory_order_acquire) == sorted_.size()) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(sortMutex_);
+
+    size_t first = sortedCount_.load(std::memory_order_relaxed);
+    if (first == sorted_.size()) {
+        return;
+    }
+
+    auto less = [this](int32 a, int32 b) {
+        return entries_[a].property.first < entries_[b].property.first;
+    };
+
+    std::sort(sorted_.begin() + first, sorted_.end(), less);
+
+    // Names added in order, as when copying sorted output, need no merge.
+    if (first > 0 && less(sorted_[first], sorted_[first - 1])) {
+        std::inplace_merge(sorted_.begin(), sorted_.begin() + first, sorted_.end(), less);
+    }
+
+    sortedCount_.store(sorted_.size(), std::memory_order_release);
+}
+
+/*****************************************************************************/
+
+Properties::Entry::Entry(std::string name, std::string value)
+    : property(std::move(name), std::move(value)),
+      present(true),
+      templated(false),
+      cache(nullptr),
+      expanded(nullptr) {
+}
+
+/*****************************************************************************/
+
+Properties::Entry::Entry(const Entry& other)
+    : property(other.property),
+      present(other.present),
+      templated(other.templated),
+      links(other.links ? new Links(*other.links) : nullptr),
+      cache(nullptr),
+      expanded(nullptr) {
+}
+
+/*****************************************************************************/
+
+Properties::Entry::~Entry() {
+    delete cache.load();
+}
+
+/*****************************************************************************/
+
+void Properties::Entry::invalidate() {
+    delete cache.exchange(nullptr);
+    expanded.store(nullptr, std::memory_order_relaxed);
+}
+
+/*****************************************************************************/
+
+Properties::View::View()
+    : properties_(nullptr),
+      begin_(nullptr),
+      end_(nullptr) {
+}
+
+/*****************************************************************************/
+
+Properties::View::View(const Properties* properties, std::string prefix, const int32* begin, const int32* end)
+    : properties_(properties),
+      prefix_(std::move(prefix)),
+      begin_(begin),
+      end_(end) {
+}
+
+/*****************************************************************************/
+
+const std::string& Properties::View::prefix() const {
+    return prefix_;
+}
+
+/*****************************************************************************/
+
+const std::string& Properties::View::getProperty(const std::string& name) const {
+    static std::string EMPTY_STRING;
+
+    auto entry = find(name);
+    if (entry) {
+        return properties_->text(*entry);
+    }
+
+    return EMPTY_STRING;
+}
+
+/*****************************************************************************/
+
+bool Properties::View::contains(const std::string& name) const {
+    return find(name) != nullptr;
+}
+
+/*****************************************************************************/
+
+Properties::View Properties::View::view(const std::string& prefix) const {
+    if (!properties_) {
+        return View();
+    }
+
+    auto& entries = properties_->entries_;
+    auto offset = prefix_.size();
+
+    auto compare = [&](int32 slot) {
+        return entries[slot].property.first.compare(offset, prefix.size(), prefix);
+    };
+
+    auto first = std::lower_bound(begin_, end_, 0, [&](int32 slot, int) { return compare(slot) < 0; });
+    auto last = std::upper_bound(first, end_, 0, [&](int, int32 slot) { return compare(slot) > 0; });
+
+    return View(properties_, prefix_ + prefix, first, last);
+}
+
+/*****************************************************************************/
+
+Properties Properties::View::toProperties() const {
+    Properties result;
+
+    for (auto& property : *this) {
+        result.setProperty(property.first.substr(prefix_.size()), property.second);
+    }
+
+    return result;
+}
+
+/*****************************************************************************/
+
+Properties::View::const_iterator Properties::View::begin() const {
+    return const_iterator(properties_ ? &properties_->entries_ : nullptr, begin_, end_);
+}
+
+/*****************************************************************************/
+
+Properties::View::const_iterator Properties::View::end() const {
+    return const_iterator(properties_ ? &properties_->entries_ : nullptr, end_, end_);
+}
+
+/*****************************************************************************/
+
+int32 Properties::View::size() const {
+    return static_cast<int32>(std::distance(begin(), end()));
+}
+
+/*****************************************************************************/
+
+bool Properties::View::empty() const {
+    return begin() == end();
+}
+
+/*****************************************************************************/
+
+const Properties::Entry* Properties::View::find(const std::string& name) const {
+    if (!properties_) {
+        return nullptr;
+    }
+
+    auto& entries = properties_->entries_;
+    auto offset = prefix_.size();
+
+    auto itr = std::lower_bound(begin_, end_, name, [&](int32 slot, const std::string& value) {
+        return entries[slot].property.first.compare(offset, std::string::npos, value) < 0;
+    });
+
+    if (itr == end_ || entries[*itr].property.first.compare(offset, std::string::npos, name) != 0) {
+        return nullptr;
+    }
+
+    auto& entry = entries[*itr];
+    return entry.present ? &entry : nullptr;
+}
+
+/*****************************************************************************/
+
+size_t Properties::NameHash::operator ()(const std::string* name) const {
+    return std::hash<std::string>()(*name);
+}
+
+/*****************************************************************************/
+
+bool Properties::NameEqual::operator ()(const std::string* a, const std::string* b) const {
+    return *a == *b;
 }
 
 /*****************************************************************************/
@@ -0,0 +1,320 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#include <oblivion/core/properties_watcher.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <oblivion/core/exception.h>
+#include <oblivion/core/file_util.h>
+#include <oblivion/core/shared_properties.h>
+
+namespace oblivion {
+
+/**
+ * The private implementation of PropertiesWatcher for Linux.
+ */
+struct PropertiesWatcher::Impl {
+
+    /**
+     * @see PropertiesWatcher::PropertiesWatcher.
+     */
+    Impl(SharedProperties& properties, const std::string& path, int32 debounceMillis);
+
+    /**
+     * @see PropertiesWatcher::~PropertiesWatcher.
+     */
+    ~Impl();
+
+    /**
+     * The watcher thread.
+     */
+    void run();
+
+    /**
+     * Reads all queued inotify events.
+     * @return True if any of them refer to the watched file.
+     */
+    bool drainEvents();
+
+    /**
+     * Reloads the file and notifies listeners of the changed keys.
+     */
+    void reload();
+
+    SharedProperties& properties_;
+
+    std::string path_;
+
+    std::string fileName_;
+
+    int32 debounceMillis_;
+
+    int inotifyFd_;
+
+    int stopPipe_[2];
+
+    std::mutex listenerMutex_;
+
+    std::vector<std::pair<int32, Listener>> listeners_;
+
+    int32 nextListenerId_;
+
+    std::atomic<int32> reloadCount_;
+
+    std::thread thread_;
+
+};
+
+/*****************************************************************************/
+
+static std::set<std::string> changedKeys(const Properties& before, const Properties& after) {
+    std::set<std::string> result;
+
+    // Iteration yields raw values, so both sides are compared unexpanded;
+    // getProperty would expand references and could throw on a cycle.
+    std::unordered_map<std::string, std::string> previous;
+    for (auto& entry : before) {
+        previous.emplace(entry.first, entry.second);
+    }
+
+    for (auto& entry : after) {
+        auto itr = previous.find(entry.first);
+        if (itr == previous.end()) {
+            result.insert(entry.first);
+            continue;
+        }
+
+        if (itr->second != entry.second) {
+            result.insert(entry.first);
+        }
+
+        previous.erase(itr);
+    }
+
+    // Whatever is left was removed.
+    for (auto& entry : previous) {
+        result.insert(entry.first);
+    }
+
+    return result;
+}
+
+/*****************************************************************************/
+
+PropertiesWatcher::PropertiesWatcher(SharedProperties& properties, const std::string& path, int32 debounceMillis)
+    : impl_(new Impl(properties, path, debounceMillis)) {
+}
+
+/*****************************************************************************/
+
+PropertiesWatcher::~PropertiesWatcher() {
+}
+
+/*****************************************************************************/
+
+int32 PropertiesWatcher::subscribe(Listener listener) {
+    std::lock_guard<std::mutex> lock(impl_->listenerMutex_);
+
+    auto id = impl_->nextListenerId_++;
+    impl_->listeners_.push_back(std::make_pair(id, std::move(listener)));
+
+    return id;
+}
+
+/*****************************************************************************/
+
+void PropertiesWatcher::unsubscribe(int32 id) {
+    std::lock_guard<std::mutex> lock(impl_->listenerMutex_);
+
+    auto& listeners = impl_->listeners_;
+    for (auto itr = listeners.begin(); itr != listeners.end(); ++itr) {
+        if (itr->first == id) {
+            listeners.erase(itr);
+            break;
+        }
+    }
+}
+
+/*****************************************************************************/
+
+int32 PropertiesWatcher::reloadCount() const {
+    return impl_->reloadCount_.load();
+}
+
+/*****************************************************************************/
+
+PropertiesWatcher::Impl::Impl(SharedProperties& properties, const std::string& path, int32 debounceMillis)
+    : properties_(properties),
+      path_(path),
+      fileName_(FileUtil::getFileName(path)),
+      debounceMillis_(debounceMillis),
+      nextListenerId_(1),
+      reloadCount_(0) {
+
+    auto lastSlash = path.find_last_of('/');
+    auto directory = lastSlash == std::string::npos ? std::string(".") : path.substr(0, lastSlash + 1);
+
+    inotifyFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd_ < 0) {
+        OB_THROW("inotify_init1 failed");
+    }
+
+    // Watch the directory rather than the file so that editors which replace the
+    // file by renaming a new one over it are still picked up.
+    auto mask = IN_CLOSE_WRITE | IN_MODIFY | IN_MOVED_TO | IN_CREATE | IN_DELETE;
+    if (inotify_add_watch(inotifyFd_, directory.c_str(), mask) < 0) {
+        close(inotifyFd_);
+        OB_THROW("Unable to watch directory: %s", directory.c_str());
+    }
+
+    if (pipe2(stopPipe_, O_CLOEXEC) != 0) {
+        close(inotifyFd_);
+        OB_THROW("pipe failed");
+    }
+
+    thread_ = std::thread(&Impl::run, this);
+}
+
+/*****************************************************************************/
+
+PropertiesWatcher::Impl::~Impl() {
+    char stop = 0;
+    while (write(stopPipe_[1], &stop, 1) < 0 && errno == EINTR) {
+    }
+
+    thread_.join();
+
+    close(stopPipe_[0]);
+    close(stopPipe_[1]);
+    close(inotifyFd_);
+}
+
+/*****************************************************************************/
+
+void PropertiesWatcher::Impl::run() {
+    pollfd fds[2];
+    fds[0].fd = inotifyFd_;
+    fds[0].events = POLLIN;
+    fds[1].fd = stopPipe_[0];
+    fds[1].events = POLLIN;
+
+    auto pending = false;
+    std::chrono::steady_clock::time_point deadline;
+
+    for (;;) {
+        auto timeout = -1;
+        if (pending) {
+            auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                deadline - std::chrono::steady_clock::now()).count();
+            timeout = static_cast<int>(std::max<int64>(0, remaining));
+        }
+
+        auto ready = poll(fds, 2, timeout);
+
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+
+            break;
+        }
+
+        if (fds[1].revents != 0) {
+            break;
+        }
+
+        // The wait runs from the first change, so a steady stream of events,
+        // whether for this file or others in the directory, cannot postpone it.
+        if ((fds[0].revents & POLLIN) && drainEvents() && !pending) {
+            pending = true;
+            deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(debounceMillis_);
+        }
+
+        if (pending && std::chrono::steady_clock::now() >= deadline) {
+            pending = false;
+            reload();
+        }
+    }
+}
+
+/*****************************************************************************/
+
+bool PropertiesWatcher::Impl::drainEvents() {
+    alignas(inotify_event) char buffer[4096];
+    auto matched = false;
+
+    for (;;) {
+        auto length = read(inotifyFd_, buffer, sizeof(buffer));
+        if (length <= 0) {
+            break;
+        }
+
+        for (auto offset = 0; offset < length; ) {
+            auto event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            if (event->len > 0 && fileName_ == event->name) {
+                matched = true;
+            }
+
+            offset += sizeof(inotify_event) + event->len;
+        }
+    }
+
+    return matched;
+}
+
+/*****************************************************************************/
+
+void PropertiesWatcher::Impl::reload() {
+    if (!FileUtil::exists(path_)) {
+        return;
+    }
+
+    auto before = properties_.snapshot();
+    std::set<std::string> changed;
+
+    try {
+        properties_.reload(path_);
+        changed = changedKeys(*before, *properties_.snapshot());
+    } catch (Exception&) {
+        // The file may be half written; the next event will trigger another attempt.
+        return;
+    }
+
+    ++reloadCount_;
+
+    if (changed.empty()) {
+        return;
+    }
+
+    std::vector<std::pair<int32, Listener>> listeners;
+
+    {
+        std::lock_guard<std::mutex> lock(listenerMutex_);
+        listeners = listeners_;
+    }
+
+    for (auto& listener : listeners) {
+        // An exception escaping this thread would terminate the process.
+        try {
+            listener.second(changed);
+        } catch (...) {
+        }
+    }
+}
+
+/*****************************************************************************/
+
+}
@@ -0,0 +1,170 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#include <oblivion/core/shared_properties.h>
+
+#include <atomic>
+
+namespace oblivion {
+
+/*****************************************************************************/
+
+/**
+ * A thread's reference to the snapshot it last read from one SharedProperties.
+ */
+struct LocalSnapshot {
+    uint64 owner;
+    uint64 version;
+    SharedProperties::Snapshot snapshot;
+};
+
+/**
+ * The number of SharedProperties objects a thread keeps references for. Objects
+ * whose ids share a slot take turns, refetching the snapshot when they do.
+ */
+static const size_t LOCAL_SNAPSHOT_COUNT = 8;
+
+static thread_local LocalSnapshot localSnapshots[LOCAL_SNAPSHOT_COUNT];
+
+/**
+ * The id of the next SharedProperties. 0 marks an unused LocalSnapshot.
+ */
+static std::atomic<uint64> nextId(1);
+
+/*****************************************************************************/
+
+SharedProperties::SharedProperties()
+    : id_(nextId++),
+      version_(0),
+      current_(std::make_shared<Properties>()) {
+}
+
+/*****************************************************************************/
+
+SharedProperties::SharedProperties(const std::string& path)
+    : id_(nextId++),
+      version_(0),
+      current_(std::make_shared<Properties>(path)) {
+}
+
+/*****************************************************************************/
+
+SharedProperties::Snapshot SharedProperties::snapshot() const {
+    return local();
+}
+
+/*****************************************************************************/
+
+const SharedProperties::Snapshot& SharedProperties::local() const {
+    auto version = version_.load(std::memory_order_acquire);
+    auto& local = localSnapshots[id_ % LOCAL_SNAPSHOT_COUNT];
+
+    if (local.owner != id_ || local.version != version) {
+        // The swap stores the snapshot before bumping the version, so this
+        // sees the snapshot of this version or a newer one.
+        local.snapshot = std::atomic_load(&current_);
+        local.owner = id_;
+        local.version = version;
+    }
+
+    return local.snapshot;
+}
+
+/*****************************************************************************/
+
+void SharedProperties::reload(const std::string& path) {
+    std::lock_guard<std::mutex> lock(writeMutex_);
+
+    auto next = reserved(snapshot()->interpolation());
+    next->load(path);
+
+    swap(std::move(next));
+}
+
+/*****************************************************************************/
+
+void SharedProperties::publish(Properties properties) {
+    std::lock_guard<std::mutex> lock(writeMutex_);
+    publishCopy(properties);
+}
+
+/*****************************************************************************/
+
+void SharedProperties::update(const std::function<void(Properties&)>& mutator) {
+    std::lock_guard<std::mutex> lock(writeMutex_);
+
+    // The mutator may clear names, so the result is compacted like any other write.
+    Properties next(*snapshot());
+    mutator(next);
+
+    publishCopy(next);
+}
+
+/*****************************************************************************/
+
+void SharedProperties::setProperty(const std::string& name, const std::string& value) {
+    update([&](Properties& properties) {
+        properties.setProperty(name, value);
+    });
+}
+
+/*****************************************************************************/
+
+std::string SharedProperties::getProperty(const std::string& name) const {
+    return local()->getProperty(name);
+}
+
+/*****************************************************************************/
+
+std::shared_ptr<Properties> SharedProperties::reserved(bool interpolation) const {
+    auto result = std::make_shared<Properties>();
+    result->setInterpolation(interpolation);
+
+    // A fresh collection hands out slots in order, so each name gets its index.
+    for (auto& name : handleNames_) {
+        result->handle<std::string>(name);
+    }
+
+    return result;
+}
+
+/*****************************************************************************/
+
+void SharedProperties::publishCopy(const Properties& properties) {
+    auto next = reserved(properties.interpolation());
+
+    for (auto& property : properties) {
+        next->setProperty(property.first, property.second);
+    }
+
+    swap(std::move(next));
+}
+
+/*****************************************************************************/
+
+int32 SharedProperties::reserve(const std::string& name) {
+    std::lock_guard<std::mutex> lock(writeMutex_);
+
+    auto itr = handleSlots_.find(name);
+    if (itr != handleSlots_.end()) {
+        return itr->second;
+    }
+
+    auto slot = static_cast<int32>(handleNames_.size());
+    handleNames_.push_back(name);
+    handleSlots_[name] = slot;
+
+    publishCopy(*snapshot());
+
+    return slot;
+}
+
+/*****************************************************************************/
+
+void SharedProperties::swap(Snapshot next) {
+    std::atomic_store(&current_, Snapshot(std::move(next)));
+    version_.fetch_add(1, std::memory_order_release);
+}
+
+/*****************************************************************************/
+
+}
@@ -2,14 +2,70 @@
 
 #include <oblivion/core/variant.h>
 
+#include <algorithm>
+#include <atomic>
+#include <future>
+#include <limits>
+#include <thread>
+
 #include <json/json.h>
 
 #include <oblivion/core/algorithm.h>
+#include <oblivion/core/cbor.h>
 #include <oblivion/core/exception.h>
+#include <oblivion/core/file.h>
 #include <oblivion/core/string_util.h>
 
 namespace oblivion {
 
+/*****************************************************************************/
+
+/**
+ * Arrays and maps smaller than this are serialized on the calling thread.
+ */
+const int32 MIN_PARALLEL_JSON_SIZE = 1024;
+
+/*****************************************************************************/
+
+#ifdef OBLIVION_CORE_VARIANT_STATS
+
+static std::atomic<int64> liveVariants(0);
+static std::atomic<int64> liveValues[VARIANT_TYPE_COUNT];
+static std::atomic<int64> allocations[VARIANT_TYPE_COUNT];
+
+#endif
+
+/*****************************************************************************/
+
+static inline void trackVariant(int64 delta) {
+#ifdef OBLIVION_CORE_VARIANT_STATS
+    liveVariants.fetch_add(delta, std::memory_order_relaxed);
+#endif
+}
+
+/*****************************************************************************/
+
+static inline void trackValue(VariantType type, int64 delta) {
+#ifdef OBLIVION_CORE_VARIANT_STATS
+    auto index = static_cast<int32>(type);
+    liveValues[index].fetch_add(delta, std::memory_order_relaxed);
+
+    if (delta > 0) {
+        allocations[index].fetch_add(delta, std::memory_order_relaxed);
+    }
+#endif
+}
+
+/*****************************************************************************/
+
+/**
+ * Gets the number of heap bytes owned by a string.
+ */
+static uint64 stringHeapBytes(const std::string& value) {
+    static const auto inlineCapacity = std::string().capacity();
+    return value.capacity() > inlineCapacity ? value.capacity() + 1 : 0;
+}
+
 /**
  * Interface for variant values.
  */
@@ -17,13 +73,21 @@ class VariantValue {
 
 public:
 
-    VariantValue() { }
-    virtual ~VariantValue() { }
+    explicit VariantValue(VariantType type) 
+        : trackedType_(type) {
+        trackValue(trackedType_, 1);
+    }
+
+    virtual ~VariantValue() { 
+        trackValue(trackedType_, -1);
+    }
 
     virtual VariantType type() const = 0;
 
     virtual std::unique_ptr<VariantValue> clone() const = 0;
 
+    virtual VariantMemoryUsage memoryUsage() const = 0;
+
     virtual int32 intValue() const {
         OB_THROW("Unsupported Operation");
     }
@@ -68,6 +132,10 @@ public:
         OB_THROW("Unsupported operation");
     }
 
+    virtual void add(Variant&& variant) {
+        OB_THROW("Unsupported operation");
+    }
+
     virtual bool containsKey(const std::string& key) const {
         OB_THROW("Unsupported operation");
     }
@@ -76,6 +144,24 @@ public:
         OB_THROW("Unsupported operation");
     }
 
+    virtual bool remove(const std::string& key) {
+        OB_THROW("Unsupported operation");
+    }
+
+protected:
+
+    template <typename T>
+    static VariantMemoryUsage nodeUsage(const T& value) {
+        VariantMemoryUsage usage = VariantMemoryUsage();
+        usage.nodeBytes = sizeof(value);
+
+        return usage;
+    }
+
+private:
+
+    VariantType trackedType_;
+
 };
 
 /**
@@ -85,6 +171,10 @@ class NullValue : public VariantValue {
 
 public:
 
+    NullValue()
+        : VariantValue(VariantType::Null) {
+    }
+
     VariantType type() const override {
         return VariantType::Null;
     }
@@ -93,6 +183,10 @@ public:
         return std::unique_ptr<VariantValue>(new NullValue());
     }
 
+    VariantMemoryUsage memoryUsage() const override {
+        return nodeUsage(*this);
+    }
+
 };
 
 /**
@@ -103,7 +197,8 @@ class BoolValue : public VariantValue {
 public:
 
     BoolValue(bool value = false) 
-        : value_(value) {
+        : VariantValue(VariantType::Bool),
+          value_(value) {
     }
 
     VariantType type() const override {
@@ -126,6 +221,10 @@ public:
         return std::unique_ptr<VariantValue>(new BoolValue(value_));
     }
 
+    VariantMemoryUsage memoryUsage() const override {
+        return nodeUsage(*this);
+    }
+
 private:
 
     bool value_;
@@ -140,7 +239,8 @@ class IntValue : public VariantValue {
 public:
 
     IntValue(int32 value = 0) 
-        : value_(value) {
+        : VariantValue(VariantType::Integer),
+          value_(value) {
     }
 
     VariantType type() const override {
@@ -167,6 +267,10 @@ public:
         return std::unique_ptr<VariantValue>(new IntValue(value_));
     }
 
+    VariantMemoryUsage memoryUsage() const override {
+        return nodeUsage(*this);
+    }
+
 private:
 
     int32 value_;
@@ -181,7 +285,8 @@ class RealValue : public VariantValue {
 public:
 
     RealValue(real64 value = 0) 
-        : value_(value) {
+        : VariantValue(VariantType::Real),
+          value_(value) {
     }
 
     VariantType type() const override {
@@ -204,6 +309,10 @@ public:
         return std::unique_ptr<VariantValue>(new RealValue(value_));
     }
 
+    VariantMemoryUsage memoryUsage() const override {
+        return nodeUsage(*this);
+    }
+
 private:
 
     real64 value_;
@@ -217,11 +326,13 @@ class StringValue : public VariantValue {
 
 public:
 
-    StringValue() {
+    StringValue()
+        : VariantValue(VariantType::String) {
     }
 
     StringValue(std::string value) 
-        : value_(std::move(value)) {
+        : VariantValue(VariantType::String),
+          value_(std::move(value)) {
     }
 
     VariantType type() const override {
@@ -244,6 +355,13 @@ public:
         return std::unique_ptr<VariantValue>(new StringValue(value_));
     }
 
+    VariantMemoryUsage memoryUsage() const override {
+        auto usage = nodeUsage(*this);
+        usage.stringBytes = stringHeapBytes(value_);
+
+        return usage;
+    }
+
 private:
 
     std::string value_;
@@ -257,11 +375,13 @@ class ArrayValue : public VariantValue {
 
 public:
 
-    ArrayValue() {
+    ArrayValue()
+        : VariantValue(VariantType::Array) {
     }
 
     ArrayValue(std::vector<Variant> value)
-        : value_(std::move(value)) {
+        : VariantValue(VariantType::Array),
+          value_(std::move(value)) {
     }
 
     VariantType type() const {
@@ -284,6 +404,17 @@ public:
         return std::unique_ptr<VariantValue>(new ArrayValue(value_));
     }
 
+    VariantMemoryUsage memoryUsage() const override {
+        auto usage = nodeUsage(*this);
+        usage.containerSlackBytes = (value_.capacity() - value_.size()) * sizeof(Variant);
+
+        for (auto& element : value_) {
+            usage += element.memoryUsage();
+        }
+
+        return usage;
+    }
+
     void clear() override {
         value_.clear();
     }
@@ -292,6 +423,10 @@ public:
         value_.emplace_back(variant);
     }
 
+    void add(Variant&& variant) override {
+        value_.emplace_back(std::move(variant));
+    }
+
 private:
 
     std::vector<Variant> value_;
@@ -305,11 +440,13 @@ class MapValue : public VariantValue {
 
 public:
 
-    MapValue() {
+    MapValue()
+        : VariantValue(VariantType::Map) {
     }
 
     MapValue(std::map<std::string, Variant> value)
-        : value_(std::move(value)) {
+        : VariantValue(VariantType::Map),
+          value_(std::move(value)) {
     }
 
     VariantType type() const override {
@@ -338,6 +475,21 @@ public:
         return std::unique_ptr<VariantValue>(new MapValue(value_));
     }
 
+    VariantMemoryUsage memoryUsage() const override {
+        // Each tree node holds the color and three links ahead of the key and value.
+        const uint64 treeNodeHeader = 4 * sizeof(void*);
+
+        auto usage = nodeUsage(*this);
+
+        for (auto& entry : value_) {
+            usage.nodeBytes += treeNodeHeader + sizeof(entry.first);
+            usage.keyBytes += stringHeapBytes(entry.first);
+            usage += entry.second.memoryUsage();
+        }
+
+        return usage;
+    }
+
     void clear() override {
         value_.clear();
     }
@@ -353,6 +505,10 @@ public:
         return result;
     }
 
+    bool remove(const std::string& key) override {
+        return value_.erase(key) != 0;
+    }
+
 private:
 
     std::map<std::string, Variant> value_;
@@ -362,6 +518,8 @@ private:
 /*****************************************************************************/
 
 Variant::Variant(VariantType type) {
+    trackVariant(1);
+
     switch (type) {
     case VariantType::Integer:
         value_.reset(new IntValue());
@@ -389,30 +547,35 @@ Variant::Variant(VariantType type) {
 /*****************************************************************************/
 
 Variant::Variant(int32 value) {
+    trackVariant(1);
     value_.reset(new IntValue(value));
 }
 
 /*****************************************************************************/
 
 Variant::Variant(real64 value) {
+    trackVariant(1);
     value_.reset(new RealValue(value));
 }
 
 /*****************************************************************************/
 
 Variant::Variant(bool value) {
+    trackVariant(1);
     value_.reset(new BoolValue(value));
 }
 
 /*****************************************************************************/
 
 Variant::Variant(const char* value) {
+    trackVariant(1);
     value_.reset(new StringValue(value));
 }
 
 /*****************************************************************************/
 
 Variant::Variant(const std::string& value) {
+    trackVariant(1);
     value_.reset(new StringValue(value));
 }
 
@@ -420,17 +583,20 @@ Variant::Variant(const std::string& value) {
 
 Variant::Variant(const Variant& variant) 
     : value_(variant.value_->clone()) {
+    trackVariant(1);
 }
 
 /*****************************************************************************/
 
 Variant::Variant(Variant&& variant)
     : value_(std::move(variant.value_)) {
+    trackVariant(1);
 }
 
 /*****************************************************************************/
 
 Variant::~Variant() {
+    trackVariant(-1);
 }
 
 /*****************************************************************************/
@@ -522,6 +688,12 @@ void Variant::add(const Variant& variant) {
 
 /*****************************************************************************/
 
+void Variant::add(Variant&& variant) {
+    value_->add(std::move(variant));
+}
+
+/*****************************************************************************/
+
 bool Variant::containsKey(const std::string& key) const {
     return value_->containsKey(key);
 }
@@ -534,6 +706,147 @@ std::vector<std::string> Variant::mapKeys() const {
 
 /*****************************************************************************/
 
+bool Variant::remove(const std::string& key) {
+    return value_->remove(key);
+}
+
+/*****************************************************************************/
+
+/**
+ * Merges an overlay that does not alias the target, moving its nodes.
+ */
+static void mergeVariant(Variant& target, Variant& overlay, const VariantMergeOptions& options) {
+    if (overlay.type() == VariantType::Array && target.type() == VariantType::Array && options.arrays == ArrayMergeMode::Append) {
+        auto size = overlay.size();
+        for (auto i = 0; i < size; ++i) {
+            target.add(std::move(overlay[i]));
+        }
+
+        return;
+    }
+
+    if (overlay.type() != VariantType::Map) {
+        target = std::move(overlay);
+        return;
+    }
+
+    if (target.type() != VariantType::Map) {
+        target = Variant(VariantType::Map);
+    }
+
+    for (auto& key : overlay.mapKeys()) {
+        auto& value = overlay[key];
+
+        if (value.type() == VariantType::Null && options.nullRemovesKey) {
+            target.remove(key);
+        } else if (!target.containsKey(key) && (value.type() != VariantType::Map || !options.nullRemovesKey)) {
+            target[key] = std::move(value);
+        } else {
+            mergeVariant(target[key], value, options);
+        }
+    }
+}
+
+/*****************************************************************************/
+
+VariantMergeOptions::VariantMergeOptions()
+    : arrays(ArrayMergeMode::Replace),
+      nullRemovesKey(false) {
+}
+
+/*****************************************************************************/
+
+void Variant::merge(const Variant& overlay, const VariantMergeOptions& options) {
+    // The overlay may be this variant or a node inside it, which the merge would
+    // replace or remove while reading it. Copying first rules that out, and the
+    // nodes are then moved out of the copy rather than copied a second time.
+    Variant copy(overlay);
+    mergeVariant(*this, copy, options);
+}
+
+/*****************************************************************************/
+
+void Variant::merge(Variant&& overlay, const VariantMergeOptions& options) {
+    // Detaching would leave nothing to merge into.
+    if (&overlay == this) {
+        merge(static_cast<const Variant&>(overlay), options);
+        return;
+    }
+
+    // Detaching the overlay's nodes first keeps the merge from reading a node it
+    // is changing when the overlay is inside this variant.
+    Variant detached(std::move(overlay));
+    overlay = Variant();
+
+    mergeVariant(*this, detached, options);
+}
+
+/*****************************************************************************/
+
+static VariantMergeOptions mergePatchOptions() {
+    VariantMergeOptions options;
+    options.nullRemovesKey = true;
+
+    return options;
+}
+
+/*****************************************************************************/
+
+void Variant::mergePatch(const Variant& patch) {
+    merge(patch, mergePatchOptions());
+}
+
+/*****************************************************************************/
+
+void Variant::mergePatch(Variant&& patch) {
+    merge(std::move(patch), mergePatchOptions());
+}
+
+/*****************************************************************************/
+
+VariantMemoryUsage Variant::memoryUsage() const {
+    auto usage = value_->memoryUsage();
+    usage.nodeBytes += sizeof(*this);
+
+    return usage;
+}
+
+/*****************************************************************************/
+
+VariantStats Variant::stats() {
+    VariantStats result = VariantStats();
+
+#ifdef OBLIVION_CORE_VARIANT_STATS
+    result.liveVariants = liveVariants.load(std::memory_order_relaxed);
+
+    for (auto i = 0; i < VARIANT_TYPE_COUNT; ++i) {
+        result.liveValues[i] = liveValues[i].load(std::memory_order_relaxed);
+        result.allocations[i] = allocations[i].load(std::memory_order_relaxed);
+    }
+#endif
+
+    return result;
+}
+
+/*****************************************************************************/
+
+uint64 VariantMemoryUsage::total() const {
+    return nodeBytes + stringBytes + keyBytes + containerSlackBytes;
+}
+
+/*****************************************************************************/
+
+VariantMemoryUsage& VariantMemoryUsage::operator +=(const VariantMemoryUsage& other) {
+    nodeBytes += other.nodeBytes;
+    stringBytes += other.stringBytes;
+    keyBytes += other.keyBytes;
+    containerSlackBytes += other.containerSlackBytes;
+
+    return *this;
+}
+
+/*****************************************************************************/
+
 static Json::Value toJsonValue(const Variant& variant) {
     switch (variant.type()) {
     case VariantType::Null:
@@ -617,6 +930,121 @@ std::string Variant::toJson() const {
 
 /*****************************************************************************/
 
+static std::string toJsonFragment(const Variant& variant) {
+    Json::FastWriter writer;
+
+    auto result = writer.write(toJsonValue(variant));
+    result.pop_back();
+
+    return result;
+}
+
+/*****************************************************************************/
+
+static std::string toJsonChunk(const Variant& variant, const std::vector<std::string>& keys, int32 begin, int32 end) {
+    std::string result;
+
+    for (auto i = begin; i < end; ++i) {
+        if (i > begin) {
+            result += ",";
+        }
+
+        if (variant.type() == VariantType::Map) {
+            result += Json::valueToQuotedString(keys[i].c_str());
+            result += ":";
+            result += toJsonFragment(variant[keys[i]]);
+        } else {
+            result += toJsonFragment(variant[i]);
+        }
+    }
+
+    return result;
+}
+
+/*****************************************************************************/
+
+static std::vector<std::future<std::string>> startJsonChunks(const Variant& variant, 
+                                                              const std::vector<std::string>& keys,
+                                                              int32 threadCount) {
+    std::vector<std::future<std::string>> result;
+
+    if (variant.type() != VariantType::Array && variant.type() != VariantType::Map) {
+        return result;
+    }
+
+    if (threadCount <= 0) {
+        threadCount = std::max(1, static_cast<int32>(std::thread::hardware_concurrency()));
+    }
+
+    auto size = variant.size();
+    if (threadCount < 2 || size < MIN_PARALLEL_JSON_SIZE) {
+        return result;
+    }
+
+    auto chunkSize = (size + threadCount - 1) / threadCount;
+    for (auto begin = 0; begin < size; begin += chunkSize) {
+        auto end = std::min(size, begin + chunkSize);
+        result.push_back(std::async(std::launch::async, toJsonChunk, std::cref(variant), std::cref(keys), begin, end));
+    }
+
+    return result;
+}
+
+/*****************************************************************************/
+
+std::string Variant::toJsonParallel(int32 threadCount) const {
+    std::vector<std::string> keys;
+    if (type() == VariantType::Map) {
+        keys = mapKeys();
+    }
+
+    auto chunks = startJsonChunks(*this, keys, threadCount);
+    if (chunks.empty()) {
+        return toJson();
+    }
+
+    std::string result = type() == VariantType::Map ? "{" : "[";
+    for (auto i = 0u; i < chunks.size(); ++i) {
+        if (i > 0) {
+            result += ",";
+        }
+
+        result += chunks[i].get();
+    }
+
+    result += type() == VariantType::Map ? "}" : "]";
+
+    return result;
+}
+
+/*****************************************************************************/
+
+void Variant::writeJson(File& file, int32 threadCount) const {
+    std::vector<std::string> keys;
+    if (type() == VariantType::Map) {
+        keys = mapKeys();
+    }
+
+    auto chunks = startJsonChunks(*this, keys, threadCount);
+    if (chunks.empty()) {
+        file.write(toJson());
+        return;
+    }
+
+    file.write(type() == VariantType::Map ? "{" : "[");
+    for (auto i = 0u; i < chunks.size(); ++i) {
+        if (i > 0) {
+            file.write(",");
+        }
+
+        file.write(chunks[i].get());
+    }
+
+    file.write(type() == VariantType::Map ? "}" : "]");
+}
+
+/*****************************************************************************/
+
 Variant Variant::parseJson(const std::string& jsonString) {
     Json::Reader reader;
     Json::Value value;
@@ -630,6 +1058,102 @@ Variant Variant::parseJson(const std::string& jsonString) {
 
 /*****************************************************************************/
 
+std::string Variant::toCbor() const {
+    std::string result;
+
+    CborWriter writer(result);
+    writer.write(*this);
+
+    return result;
+}
+
+/*****************************************************************************/
+
+void Variant::writeCbor(File& file) const {
+    CborWriter writer(file);
+    writer.write(*this);
+    writer.flush();
+}
+
+/*****************************************************************************/
+
+/**
+ * The deepest nesting of arrays and maps parseCbor accepts, which bounds the
+ * recursion below on hostile input.
+ */
+static const int32 CBOR_MAX_DEPTH = 512;
+
+/*****************************************************************************/
+
+static Variant fromCbor(CborReader& reader, CborToken token, int32 depth) {
+    if ((token == CborToken::ArrayBegin || token == CborToken::MapBegin) && depth >= CBOR_MAX_DEPTH) {
+        OB_THROW("CBOR data nested deeper than %d levels", CBOR_MAX_DEPTH);
+    }
+
+    switch (token) {
+    case CborToken::Null:
+        return Variant();
+    case CborToken::Bool:
+        return reader.boolValue();
+    case CborToken::Integer: {
+        auto value = reader.intValue();
+        if (value < std::numeric_limits<int32>::min() || value > std::numeric_limits<int32>::max()) {
+            return static_cast<real64>(value);
+        }
+
+        return static_cast<int32>(value);
+    }
+    case CborToken::Real:
+        return reader.realValue();
+    case CborToken::String:
+        return std::string(reader.stringData(), reader.stringSize());
+    case CborToken::ArrayBegin: {
+        Variant result(VariantType::Array);
+        for (auto next = reader.next(); next != CborToken::End; next = reader.next()) {
+            result.add(fromCbor(reader, next, depth + 1));
+        }
+
+        return result;
+    }
+    case CborToken::MapBegin: {
+        Variant result(VariantType::Map);
+        for (auto next = reader.next(); next != CborToken::End; next = reader.next()) {
+            if (next != CborToken::String) {
+                OB_THROW("CBOR map keys must be strings");
+            }
+
+            std::string key(reader.stringData(), reader.stringSize());
+            result[key] = fromCbor(reader, reader.next(), depth + 1);
+        }
+
+        return result;
+    }
+    default:
+        OB_THROW("Unexpected end of CBOR data");
+    }
+}
+
+/*****************************************************************************/
+
+Variant Variant::parseCbor(const std::string& cbor) {
+    return parseCbor(cbor.data(), cbor.size());
+}
+
+/*****************************************************************************/
+
+Variant Variant::parseCbor(const void* data, size_t size) {
+    CborReader reader(data, size);
+
+    auto result = fromCbor(reader, reader.next(), 0);
+    if (reader.next() != CborToken::EndOfInput) {
+        OB_THROW("Trailing data after CBOR value");
+    }
+
+    return result;
+}
+
+/*****************************************************************************/
+
 template <>
 std::string StringUtil::toString(const Variant& variant) {
     return variant.toJson();
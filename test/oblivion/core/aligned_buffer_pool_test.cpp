@@ -0,0 +1,61 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <utility>
+
+#include <oblivion/core/aligned_buffer_pool.h>
+#include <oblivion/core/exception.h>
+
+namespace oblivion {
+
+/*****************************************************************************/
+
+TEST(AlignedBufferPoolTest, Buffer) {
+    AlignedBuffer buffer(10000, 512);
+    EXPECT_EQ(10000u, buffer.size());
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(buffer.data()) % 512);
+
+    AlignedBuffer moved(std::move(buffer));
+    EXPECT_EQ(nullptr, buffer.data());
+    EXPECT_EQ(10000u, moved.size());
+
+    EXPECT_EQ(nullptr, AlignedBuffer().data());
+    EXPECT_THROW(AlignedBuffer(16, 3000), Exception);
+}
+
+/*****************************************************************************/
+
+TEST(AlignedBufferPoolTest, Reuse) {
+    AlignedBufferPool pool(8192, 4096, 1);
+    char* first;
+
+    {
+        auto lease = pool.acquire();
+        first = lease.data();
+        EXPECT_EQ(8192u, lease.size());
+        EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(first) % 4096);
+        EXPECT_EQ(0u, pool.idle());
+    }
+
+    EXPECT_EQ(1u, pool.idle());
+
+    {
+        auto lease = pool.acquire();
+        EXPECT_EQ(first, lease.data());
+
+        // Only one idle buffer is kept, so the second is freed on return.
+        auto other = pool.acquire();
+        auto moved = std::move(other);
+        EXPECT_NE(first, moved.data());
+    }
+
+    EXPECT_EQ(1u, pool.idle());
+
+    EXPECT_THROW(AlignedBufferPool(0), Exception);
+}
+
+/*****************************************************************************/
+
+}
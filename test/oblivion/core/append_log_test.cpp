@@ -0,0 +1,149 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <oblivion/core/append_log.h>
+#include <oblivion/core/exception.h>
+#include <oblivion/core/file.h>
+#include <oblivion/core/file_util.h>
+
+namespace oblivion {
+
+/*****************************************************************************/
+
+static std::string readFile(const std::string& path) {
+    File file(path, "rb");
+    std::string contents(static_cast<size_t>(file.size()), '\0');
+
+    if (!contents.empty()) {
+        file.read(contents.size(), &contents[0]);
+    }
+
+    return contents;
+}
+
+/*****************************************************************************/
+
+static void removeLog(const std::string& directory) {
+    for (auto& file : FileUtil::listFiles(directory)) {
+        FileUtil::remove(file);
+    }
+
+    FileUtil::remove(directory);
+}
+
+/*****************************************************************************/
+
+TEST(AppendLogTest, GroupCommit) {
+    FileUtil::createDirectory("test_append_log");
+
+    AppendLog::Options options;
+    options.interval = 0;
+    EXPECT_THROW(AppendLog("test_append_log/wal", options), Exception);
+
+    {
+        AppendLog log("test_append_log/wal");
+        EXPECT_EQ(1, log.segment());
+        EXPECT_EQ("test_append_log/wal.000001", log.segmentPath(1));
+
+        std::vector<std::thread> threads;
+        std::vector<int> failures(8, 0);
+
+        for (int t = 0; t < 8; ++t) {
+            threads.push_back(std::thread([&, t] {
+                std::string record(16, static_cast<char>('a' + t));
+                record.back() = '\n';
+
+                for (int i = 0; i < 100; ++i) {
+                    // Commit mode returns only once the record is durable.
+                    if (log.append(record) > log.durablePosition()) {
+                        ++failures[t];
+                    }
+                }
+            }));
+        }
+
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        for (auto count : failures) {
+            EXPECT_EQ(0, count);
+        }
+
+        EXPECT_EQ(12800u, log.position());
+        EXPECT_EQ(12800u, log.durablePosition());
+    }
+
+    auto contents = readFile("test_append_log/wal.000001");
+    ASSERT_EQ(12800u, contents.size());
+
+    // Records are never interleaved.
+    for (size_t i = 0; i < contents.size(); i += 16) {
+        EXPECT_EQ(std::string(15, contents[i]) + "\n", contents.substr(i, 16));
+    }
+
+    removeLog("test_append_log");
+}
+
+/*****************************************************************************/
+
+TEST(AppendLogTest, Rotation) {
+    FileUtil::createDirectory("test_append_log");
+
+    AppendLog::Options options;
+    options.durability = Durability::Interval;
+    options.segmentSize = 100;
+
+    std::string expected;
+
+    {
+        AppendLog log("test_append_log/wal", options);
+
+        for (int i = 0; i < 10; ++i) {
+            std::string record = "record " + std::to_string(i) + " ........................\n";
+            log.append(record);
+            expected += record;
+
+            log.sync();
+            EXPECT_EQ(log.position(), log.durablePosition());
+        }
+
+        EXPECT_GT(log.segment(), 2);
+    }
+
+    std::string contents;
+    int32 segments = 0;
+
+    while (FileUtil::exists("test_append_log/wal." + std::string(5, '0') + std::to_string(segments + 1))) {
+        auto segment = readFile("test_append_log/wal.00000" + std::to_string(++segments));
+        EXPECT_LE(segment.size(), 100u);
+        contents += segment;
+    }
+
+    EXPECT_EQ(expected, contents);
+
+    // A new log continues after the existing segments.
+    {
+        options.durability = Durability::None;
+        AppendLog log("test_append_log/wal", options);
+        EXPECT_EQ(segments + 1, log.segment());
+
+        log.append("unsynced");
+        log.append("synced", 6);
+        log.sync();
+        EXPECT_EQ(14u, log.durablePosition());
+    }
+
+    EXPECT_EQ("unsyncedsynced", readFile("test_append_log/wal.00000" + std::to_string(segments + 1)));
+
+    removeLog("test_append_log");
+}
+
+/*****************************************************************************/
+
+}
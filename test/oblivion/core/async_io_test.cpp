@@ -0,0 +1,185 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+
+#include <oblivion/core/async_io.h>
+#include <oblivion/core/exception.h>
+#include <oblivion/core/file_util.h>
+
+namespace oblivion {
+
+/*****************************************************************************/
+
+static void exercise(AsyncIo& io) {
+    auto fd = io.open("test_async.txt", O_RDWR | O_CREAT | O_TRUNC, 0644);
+    io.submit();
+
+    int file = static_cast<int>(fd.get());
+    ASSERT_GE(file, 0);
+
+    // A batch of writes at distinct offsets, completed through callbacks.
+    std::vector<std::string> blocks;
+    for (int i = 0; i < 64; ++i) {
+        blocks.push_back(std::string(100, static_cast<char>('a' + i % 26)));
+    }
+
+    std::atomic<int> written(0);
+    std::atomic<int> failed(0);
+    for (size_t i = 0; i < blocks.size(); ++i) {
+        io.write(file, blocks[i].data(), blocks[i].size(), i * 100, [&](int64 result) {
+            if (result == 100) {
+                ++written;
+            } else {
+                ++failed;
+            }
+        });
+    }
+
+    io.submit();
+    io.drain();
+    EXPECT_EQ(64, written.load());
+    EXPECT_EQ(0, failed.load());
+
+    auto synced = io.sync(file, true);
+    io.submit();
+    EXPECT_EQ(0, synced.get());
+
+    std::string buffer(6400, '\0');
+    auto read = io.read(file, &buffer[0], buffer.size(), 0);
+    io.submit();
+    EXPECT_EQ(6400, read.get());
+    EXPECT_EQ(std::string(100, 'c'), buffer.substr(200, 100));
+    EXPECT_EQ(std::string(100, 'l'), buffer.substr(6300, 100));
+
+    // Reading past the end is a short read, not an error.
+    auto tail = io.read(file, &buffer[0], buffer.size(), 6350);
+    io.submit();
+    EXPECT_EQ(50, tail.get());
+
+    // Registered buffers.
+    std::vector<char> fixed(4096, 'z');
+    std::vector<IoBuffer> buffers(1);
+    buffers[0].data = fixed.data();
+    buffers[0].size = fixed.size();
+    io.registerBuffers(buffers);
+
+    int64 fixedWrite = -1;
+    io.writeFixed(file, 0, fixed.data(), 10, 0, [&](int64 result) { fixedWrite = result; });
+    io.drain();
+    EXPECT_EQ(10, fixedWrite);
+
+    int64 fixedRead = -1;
+    io.readFixed(file, 0, fixed.data() + 100, 20, 0, [&](int64 result) { fixedRead = result; });
+    io.drain();
+    EXPECT_EQ(20, fixedRead);
+    EXPECT_EQ(std::string(10, 'z') + std::string(10, 'a'), std::string(fixed.data() + 100, 20));
+
+    EXPECT_THROW(io.readFixed(file, 1, fixed.data(), 10, 0, nullptr), Exception);
+    EXPECT_THROW(io.readFixed(file, 0, fixed.data() + 4090, 10, 0, nullptr), Exception);
+
+    auto closed = io.close(file);
+    io.submit();
+    EXPECT_EQ(0, closed.get());
+
+    // Errors come back as negative errno values.
+    auto missing = io.open("test_async_missing/nothing.txt", O_RDONLY, 0);
+    auto badRead = io.read(file, &buffer[0], 10, 0);
+    io.submit();
+    EXPECT_EQ(-ENOENT, missing.get());
+    EXPECT_EQ(-EBADF, badRead.get());
+
+    FileUtil::remove("test_async.txt");
+}
+
+/*****************************************************************************/
+
+TEST(AsyncIoTest, ThreadPool) {
+    EXPECT_THROW(AsyncIo(IoBackend::ThreadPool, 0), Exception);
+    EXPECT_THROW(AsyncIo(IoBackend::ThreadPool, 8, 0), Exception);
+
+    AsyncIo io(IoBackend::ThreadPool, 16, 3);
+    EXPECT_EQ(IoBackend::ThreadPool, io.backend());
+
+    exercise(io);
+}
+
+/*****************************************************************************/
+
+TEST(AsyncIoTest, Auto) {
+    AsyncIo io;
+    EXPECT_NE(IoBackend::Auto, io.backend());
+
+    // The queue depth is smaller than the batch, so requests are also
+    // submitted automatically as the queue fills.
+    AsyncIo small(IoBackend::Auto, 4);
+
+    exercise(io);
+    exercise(small);
+}
+
+/*****************************************************************************/
+
+TEST(AsyncIoTest, CallbackQueuesMore) {
+    AsyncIo io(IoBackend::Auto, 2);
+
+    std::atomic<int> count(0);
+    std::function<void(int64)> chain;
+    chain = [&](int64) {
+        if (++count < 100) {
+            io.open("/dev/null", O_RDONLY, 0, [&](int64 fd) {
+                io.close(static_cast<int>(fd), chain);
+                io.submit();
+            });
+            io.submit();
+        }
+    };
+
+    io.sync(-1, false, chain);
+    io.submit();
+
+    while (count.load() < 100) {
+        io.drain();
+    }
+
+    EXPECT_EQ(100, count.load());
+}
+
+/*****************************************************************************/
+
+TEST(AsyncIoTest, DrainRunsQueuedCallbacks) {
+    // Callbacks that queue requests without submitting them leave those
+    // requests below the queue depth; drain must still run them.
+    const IoBackend backends[] = { IoBackend::ThreadPool, IoBackend::Auto };
+
+    for (auto backend : backends) {
+        AsyncIo io(backend, 64);
+
+        std::atomic<int> count(0);
+        std::function<void(int64)> chain;
+        chain = [&](int64) {
+            if (++count < 50) {
+                io.sync(-1, false, chain);
+            }
+        };
+
+        io.sync(-1, false, chain);
+        io.drain();
+        EXPECT_EQ(50, count.load());
+
+        auto last = io.sync(-1, false);
+        io.drain();
+        EXPECT_EQ(-EBADF, last.get());
+    }
+}
+
+/*****************************************************************************/
+
+}
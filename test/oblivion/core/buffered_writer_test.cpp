@@ -0,0 +1,120 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <limits>
+#include <string>
+
+#include <oblivion/core/buffered_writer.h>
+#include <oblivion/core/exception.h>
+#include <oblivion/core/file.h>
+#include <oblivion/core/file_util.h>
+
+namespace oblivion {
+
+/*****************************************************************************/
+
+TEST(BufferedWriterTest, Append) {
+    std::string longText(100, 'x');
+
+    {
+        BufferedWriter writer("test_writer.txt", 16);
+        writer.append("abc").append(' ').append(std::string("def"));
+        EXPECT_EQ(7u, writer.buffered());
+
+        // Larger than the buffer, so written straight through.
+        writer.append(longText);
+        EXPECT_EQ(0u, writer.buffered());
+
+        writer.appendLine("").append(int32(-42)).append(' ').append(uint32(7)).newline();
+        writer.append(std::numeric_limits<int64>::min()).append(' ');
+        writer.append(std::numeric_limits<uint64>::max()).newline();
+
+        // Every standard integer type resolves, whichever of them the fixed
+        // width types are on this platform.
+        writer.append(short(-1)).append(' ').append(-2L).append(' ').append(-3LL).append(' ');
+        writer.append(4u).append(' ').append(5UL).append(' ').append(6ULL).append(' ');
+        writer.append(size_t(7)).newline();
+    }
+
+    EXPECT_EQ("abc def" + longText + "\n-42 7\n-9223372036854775808 18446744073709551615\n"
+        "-1 -2 -3 4 5 6 7\n", FileUtil::readAll("test_writer.txt"));
+
+    FileUtil::remove("test_writer.txt");
+
+    // An invalid buffer size is rejected before the file is created.
+    EXPECT_THROW(BufferedWriter("test_writer.txt", 0), Exception);
+    EXPECT_FALSE(FileUtil::exists("test_writer.txt"));
+}
+
+/*****************************************************************************/
+
+TEST(BufferedWriterTest, Double) {
+    const double values[] = {
+        0.0, -0.0, 1.0, -1.5, 0.1, 3.14159265358979, 2.75, 999999.9999999,
+        -0.0000001, 123456789.123456789, 1e14, 1e20, -1e300
+    };
+
+    for (int32 precision = 0; precision <= 9; ++precision) {
+        std::string expected;
+
+        {
+            BufferedWriter writer("test_writer.txt");
+
+            for (auto value : values) {
+                char text[512];
+                snprintf(text, sizeof(text), "%.*f\n", precision, value);
+                expected += text;
+
+                writer.append(value, precision).newline();
+            }
+        }
+
+        EXPECT_EQ(expected, FileUtil::readAll("test_writer.txt")) << precision;
+    }
+
+    {
+        BufferedWriter writer("test_writer.txt");
+        writer.append(std::numeric_limits<double>::infinity()).append(' ');
+        writer.append(std::numeric_limits<double>::quiet_NaN(), 2);
+        EXPECT_THROW(writer.append(1.0, 10), Exception);
+    }
+
+    EXPECT_EQ("inf nan", FileUtil::readAll("test_writer.txt"));
+
+    FileUtil::remove("test_writer.txt");
+}
+
+/*****************************************************************************/
+
+TEST(BufferedWriterTest, FlushPolicy) {
+    {
+        File file("test_writer.txt", "wb");
+
+        {
+            BufferedWriter writer(file, BufferedWriter::DEFAULT_BUFFER_SIZE, FlushPolicy::EveryLine);
+            writer.append("partial");
+            EXPECT_EQ(0u, file.size());
+
+            writer.appendLine(" line");
+            EXPECT_EQ(0u, writer.buffered());
+            EXPECT_EQ(13u, file.size());
+        }
+
+        BufferedWriter writer(file);
+        writer.appendLine("held");
+        EXPECT_EQ(13u, file.size());
+
+        writer.flush(true);
+        EXPECT_EQ(18u, file.size());
+    }
+
+    EXPECT_EQ("partial line\nheld\n", FileUtil::readAll("test_writer.txt"));
+
+    FileUtil::remove("test_writer.txt");
+}
+
+/*****************************************************************************/
+
+}
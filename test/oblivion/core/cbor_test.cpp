@@ -0,0 +1,240 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <limits>
+
+#include <oblivion/core/cbor.h>
+#include <oblivion/core/exception.h>
+#include <oblivion/core/file.h>
+#include <oblivion/core/file_util.h>
+#include <oblivion/core/variant.h>
+
+namespace oblivion {
+
+/*****************************************************************************/
+
+static std::string bytes(std::initializer_list<int> values) {
+    std::string result;
+    for (auto value : values) {
+        result += static_cast<char>(value);
+    }
+
+    return result;
+}
+
+/*****************************************************************************/
+
+TEST(CborTest, WriteScalars) {
+    std::string buffer;
+    CborWriter writer(buffer);
+
+    writer.writeInt(10);
+    writer.writeInt(1000000);
+    writer.writeInt(-1000);
+    writer.writeReal(100000.0);
+    writer.writeReal(1.1);
+    writer.writeBool(true);
+    writer.writeNull();
+    writer.writeString("IETF");
+
+    EXPECT_EQ(bytes({
+        0x0a,
+        0x1a, 0x00, 0x0f, 0x42, 0x40,
+        0x39, 0x03, 0xe7,
+        0xfa, 0x47, 0xc3, 0x50, 0x00,
+        0xfb, 0x3f, 0xf1, 0x99, 0x99, 0x99, 0x99, 0x99, 0x9a,
+        0xf5,
+        0xf6,
+        0x64, 'I', 'E', 'T', 'F'
+    }), buffer);
+}
+
+/*****************************************************************************/
+
+TEST(CborTest, WriteLargeReals) {
+    std::string buffer;
+    CborWriter writer(buffer);
+
+    writer.writeReal(1e300);
+    writer.writeReal(-1e40);
+    writer.writeReal(std::numeric_limits<real64>::infinity());
+
+    EXPECT_EQ(bytes({
+        0xfb, 0x7e, 0x37, 0xe4, 0x3c, 0x88, 0x00, 0x75, 0x9c,
+        0xfb, 0xc8, 0x3d, 0x63, 0x29, 0xf1, 0xc3, 0x5c, 0xa5,
+        0xfa, 0x7f, 0x80, 0x00, 0x00
+    }), buffer);
+
+    EXPECT_EQ(1e300, Variant::parseCbor(buffer.substr(0, 9)).realValue());
+}
+
+/*****************************************************************************/
+
+TEST(CborTest, ReadScalars) {
+    auto data = bytes({
+        0x1b, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00,
+        0x3b, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xf9, 0x3e, 0x00,
+        0xf9, 0x80, 0x00,
+        0xf4,
+        0xc1, 0x1a, 0x51, 0x4b, 0x67, 0xb0
+    });
+
+    CborReader reader(data.data(), data.size());
+
+    ASSERT_EQ(CborToken::Integer, reader.next());
+    EXPECT_EQ(8589934592LL, reader.intValue());
+
+    ASSERT_EQ(CborToken::Real, reader.next());
+    EXPECT_EQ(-18446744073709551616.0, reader.realValue());
+
+    ASSERT_EQ(CborToken::Real, reader.next());
+    EXPECT_EQ(1.5, reader.realValue());
+
+    ASSERT_EQ(CborToken::Real, reader.next());
+    EXPECT_EQ(0.0, reader.realValue());
+    EXPECT_TRUE(std::signbit(reader.realValue()));
+
+    ASSERT_EQ(CborToken::Bool, reader.next());
+    EXPECT_FALSE(reader.boolValue());
+
+    ASSERT_EQ(CborToken::Integer, reader.next());
+    EXPECT_EQ(1363896240, reader.intValue());
+
+    EXPECT_EQ(CborToken::EndOfInput, reader.next());
+    EXPECT_EQ(data.size(), reader.position());
+}
+
+/*****************************************************************************/
+
+TEST(CborTest, Strings) {
+    auto data = bytes({ 0x63, 'a', 'b', 'c', 0x7f, 0x62, 's', 't', 0x63, 'r', 'e', 'a', 0xff });
+
+    CborReader reader(data.data(), data.size());
+
+    ASSERT_EQ(CborToken::String, reader.next());
+    EXPECT_EQ(data.data() + 1, reader.stringData());
+    EXPECT_EQ("abc", std::string(reader.stringData(), reader.stringSize()));
+
+    ASSERT_EQ(CborToken::String, reader.next());
+    EXPECT_EQ("strea", std::string(reader.stringData(), reader.stringSize()));
+}
+
+/*****************************************************************************/
+
+TEST(CborTest, Containers) {
+    std::string buffer;
+
+    {
+        CborWriter writer(buffer);
+        writer.beginMap();
+        writer.writeString("a");
+        writer.beginArray(2);
+        writer.writeInt(1);
+        writer.beginArray();
+        writer.end();
+        writer.end();
+    }
+
+    EXPECT_EQ(bytes({ 0xbf, 0x61, 'a', 0x82, 0x01, 0x9f, 0xff, 0xff }), buffer);
+
+    CborReader reader(buffer.data(), buffer.size());
+
+    ASSERT_EQ(CborToken::MapBegin, reader.next());
+    EXPECT_EQ(-1, reader.containerSize());
+    ASSERT_EQ(CborToken::String, reader.next());
+    ASSERT_EQ(CborToken::ArrayBegin, reader.next());
+    EXPECT_EQ(2, reader.containerSize());
+    ASSERT_EQ(CborToken::Integer, reader.next());
+    ASSERT_EQ(CborToken::ArrayBegin, reader.next());
+    ASSERT_EQ(CborToken::End, reader.next());
+    ASSERT_EQ(CborToken::End, reader.next());
+    ASSERT_EQ(CborToken::End, reader.next());
+    EXPECT_EQ(CborToken::EndOfInput, reader.next());
+}
+
+/*****************************************************************************/
+
+TEST(CborTest, Malformed) {
+    auto truncated = bytes({ 0x82, 0x01 });
+    CborReader reader(truncated.data(), truncated.size());
+
+    reader.next();
+    reader.next();
+    EXPECT_THROW(reader.next(), Exception);
+
+    EXPECT_THROW(Variant::parseCbor(bytes({ 0x1a, 0x00 })), Exception);
+    EXPECT_THROW(Variant::parseCbor(bytes({ 0xff })), Exception);
+    EXPECT_THROW(Variant::parseCbor(bytes({ 0xa1, 0x01, 0x02 })), Exception);
+    EXPECT_THROW(Variant::parseCbor(bytes({ 0x01, 0x02 })), Exception);
+
+    // Deep nesting is refused rather than exhausting the stack.
+    EXPECT_THROW(Variant::parseCbor(std::string(100000, static_cast<char>(0x81))), Exception);
+    EXPECT_NO_THROW(Variant::parseCbor(std::string(100, static_cast<char>(0x81)) + bytes({ 0x80 })));
+
+    // So is a long run of tags, which must also be followed by an item.
+    std::string tags(20 << 20, static_cast<char>(0xc0));
+    EXPECT_THROW(Variant::parseCbor(tags), Exception);
+    EXPECT_EQ(7, Variant::parseCbor(tags + bytes({ 0x07 })).intValue());
+    EXPECT_THROW(Variant::parseCbor(bytes({ 0x9f, 0xc0, 0xff })), Exception);
+}
+
+/*****************************************************************************/
+
+TEST(CborTest, Variant) {
+    Variant var(VariantType::Map);
+    var["int"] = -42;
+    var["real"] = 3.25;
+    var["precise"] = 0.1;
+    var["string"] = "Hello, World";
+    var["bool"] = true;
+    var["null"] = Variant();
+
+    Variant list(VariantType::Array);
+    list.add(1);
+    list.add("two");
+    list.add(Variant(VariantType::Map));
+    var["list"] = list;
+
+    auto result = Variant::parseCbor(var.toCbor());
+    EXPECT_EQ(var.toJson(), result.toJson());
+    EXPECT_EQ(0.1, result["precise"].realValue());
+    EXPECT_EQ(VariantType::Integer, result["int"].type());
+
+    auto big = Variant::parseCbor(bytes({ 0x1b, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00 }));
+    EXPECT_EQ(VariantType::Real, big.type());
+    EXPECT_EQ(8589934592.0, big.realValue());
+}
+
+/*****************************************************************************/
+
+TEST(CborTest, WriteFile) {
+    Variant var(VariantType::Array);
+    for (auto i = 0; i < 20000; ++i) {
+        var.add("element " + StringUtil::toString(i));
+    }
+
+    {
+        File file("test.cbor", "wb");
+        var.writeCbor(file);
+    }
+
+    std::string contents;
+
+    {
+        File file("test.cbor", "rb");
+        contents.resize(file.size());
+        file.read(contents.size(), &contents[0]);
+    }
+
+    EXPECT_EQ(var.toCbor(), contents);
+    EXPECT_EQ(20000, Variant::parseCbor(contents).size());
+
+    FileUtil::remove("test.cbor");
+}
+
+/*****************************************************************************/
+
+}
@@ -0,0 +1,122 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#include <gtest/gtest.h>
+
+#include <oblivion/core/compiled_properties.h>
+#include <oblivion/core/exception.h>
+#include <oblivion/core/file.h>
+#include <oblivion/core/file_util.h>
+
+namespace oblivion {
+
+/*****************************************************************************/
+
+TEST(CompiledPropertiesTest, Lookup) {
+    Properties source;
+    source.set("db.primary.host", "db1");
+    source.set("db.primary.port", 5432);
+    source.set("cache.enabled", true);
+    source.set("empty", "");
+
+    CompiledProperties::compile(source, "test.compiled");
+
+    {
+        CompiledProperties props("test.compiled");
+
+        EXPECT_EQ(4, props.size());
+        EXPECT_EQ("db1", props.getProperty("db.primary.host"));
+        EXPECT_EQ(5432, props.get<int32>("db.primary.port"));
+        EXPECT_TRUE(props.get<bool>("cache.enabled"));
+        EXPECT_EQ(7, props.get<int32>("missing", 7));
+        EXPECT_TRUE(props.contains("empty"));
+        EXPECT_STREQ("", props.find("empty"));
+        EXPECT_EQ(nullptr, props.find("db.primary"));
+        EXPECT_EQ(nullptr, props.find("db.primary.hostx"));
+
+        EXPECT_STREQ("cache.enabled", props.name(0));
+        EXPECT_STREQ("db1", props.value(1));
+
+        auto copy = props.toProperties();
+        EXPECT_EQ(4, copy.size());
+        EXPECT_EQ("5432", copy.getProperty("db.primary.port"));
+
+        // Recompiling replaces the file without disturbing open readers.
+        CompiledProperties::compile(Properties(), "test.compiled");
+        EXPECT_EQ("db1", props.getProperty("db.primary.host"));
+        EXPECT_EQ(0, CompiledProperties("test.compiled").size());
+        EXPECT_FALSE(FileUtil::exists("test.compiled.tmp"));
+    }
+
+    FileUtil::remove("test.compiled");
+}
+
+/*****************************************************************************/
+
+TEST(CompiledPropertiesTest, Large) {
+    Properties source;
+    for (int32 i = 0; i < 10000; ++i) {
+        source.set("key." + StringUtil::toString(i), i);
+    }
+
+    CompiledProperties::compile(source, "test.compiled");
+
+    {
+        CompiledProperties props("test.compiled");
+        EXPECT_EQ(10000, props.size());
+
+        for (int32 i = 0; i < 10000; ++i) {
+            ASSERT_EQ(i, props.get<int32>("key." + StringUtil::toString(i), -1));
+        }
+
+        EXPECT_FALSE(props.contains("key.10000"));
+    }
+
+    FileUtil::remove("test.compiled");
+}
+
+/*****************************************************************************/
+
+TEST(CompiledPropertiesTest, Empty) {
+    CompiledProperties::compile(Properties(), "test.compiled");
+
+    {
+        CompiledProperties props("test.compiled");
+        EXPECT_EQ(0, props.size());
+        EXPECT_FALSE(props.contains("a"));
+    }
+
+    FileUtil::remove("test.compiled");
+}
+
+/*****************************************************************************/
+
+TEST(CompiledPropertiesTest, Invalid) {
+    EXPECT_THROW(CompiledProperties("notreal.compiled"), Exception);
+
+    Properties source;
+    source.set("name", "Jeff");
+    source.save("test.compiled");
+    EXPECT_THROW(CompiledProperties("test.compiled"), Exception);
+
+    CompiledProperties::compile(source, "test.compiled");
+
+    std::string contents;
+    {
+        File file("test.compiled", "rb");
+        contents.resize(file.size());
+        file.read(contents.size(), &contents[0]);
+    }
+
+    {
+        File file("test.compiled", "wb");
+        file.write(contents.size() - 1, &contents[0]);
+    }
+
+    EXPECT_THROW(CompiledProperties("test.compiled"), Exception);
+
+    FileUtil::remove("test.compiled");
+}
+
+/*****************************************************************************/
+
+}
@@ -0,0 +1,158 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+#include <oblivion/core/compressed_reader.h>
+#include <oblivion/core/compressed_writer.h>
+#include <oblivion/core/exception.h>
+#include <oblivion/core/file.h>
+#include <oblivion/core/file_util.h>
+#include <oblivion/core/random.h>
+
+namespace oblivion {
+
+/*****************************************************************************/
+
+static std::string makeData(size_t size) {
+    Random random(7);
+    std::string data;
+
+    while (data.size() < size) {
+        // A mix of text that compresses and noise that does not.
+        if (random.nextRange(500) == 0) {
+            for (auto i = 0; i < 5000; ++i) {
+                data += static_cast<char>(random.nextRange(256));
+            }
+        } else {
+            data += "record " + std::to_string(random.nextRange(1000)) + " payload\n";
+        }
+    }
+
+    data.resize(size);
+    return data;
+}
+
+/*****************************************************************************/
+
+TEST(CompressedWriterTest, RoundTrip) {
+    auto data = makeData(1000000);
+
+    CompressedWriter::Options options;
+    options.blockSize = 64 << 10;
+    options.threadCount = 3;
+
+    {
+        CompressedWriter writer("test_compressed.obz", options);
+
+        // Uneven writes that straddle block boundaries.
+        for (size_t offset = 0; offset < data.size(); offset += 7777) {
+            writer.write(data.data() + offset, std::min<size_t>(7777, data.size() - offset));
+        }
+
+        EXPECT_EQ(data.size(), writer.size());
+        writer.close();
+        EXPECT_THROW(writer.write("more"), Exception);
+    }
+
+    CompressedReader reader("test_compressed.obz");
+    EXPECT_EQ(data.size(), reader.size());
+    EXPECT_EQ(16u, reader.blockCount());
+    EXPECT_EQ(data, reader.readAll());
+    EXPECT_LT(File("test_compressed.obz", "rb").size(), data.size());
+
+    // Sequential reads of odd sizes, through the block cache.
+    std::string sequential;
+    char buffer[1000];
+    size_t count;
+    while ((count = reader.read(sizeof(buffer) - 3, buffer)) > 0) {
+        sequential.append(buffer, count);
+    }
+
+    EXPECT_EQ(data, sequential);
+
+    FileUtil::remove("test_compressed.obz");
+}
+
+/*****************************************************************************/
+
+TEST(CompressedWriterTest, RandomAccess) {
+    auto data = makeData(300000);
+
+    CompressedWriter::Options options;
+    options.blockSize = 4096;
+    options.threadCount = 1;
+
+    {
+        CompressedWriter writer("test_compressed.obz", options);
+        writer.write(data);
+    }
+
+    CompressedReader reader("test_compressed.obz");
+    Random random(11);
+
+    for (auto i = 0; i < 200; ++i) {
+        auto offset = static_cast<uint64>(random.nextRange(static_cast<int32>(data.size())));
+        auto size = static_cast<size_t>(random.nextRange(20000));
+
+        std::string out(size, '\0');
+        auto count = reader.readAt(offset, size, &out[0]);
+
+        ASSERT_EQ(std::min<size_t>(size, data.size() - offset), count);
+        EXPECT_EQ(data.substr(offset, count), out.substr(0, count));
+    }
+
+    reader.seek(data.size() - 10);
+    char tail[20];
+    EXPECT_EQ(10u, reader.read(sizeof(tail), tail));
+    EXPECT_EQ(0u, reader.readAt(data.size(), sizeof(tail), tail));
+
+    FileUtil::remove("test_compressed.obz");
+}
+
+/*****************************************************************************/
+
+TEST(CompressedWriterTest, Invalid) {
+    {
+        CompressedWriter writer("test_compressed.obz");
+    }
+
+    {
+        CompressedReader reader("test_compressed.obz");
+        EXPECT_EQ(0u, reader.size());
+        EXPECT_EQ("", reader.readAll());
+    }
+
+    CompressedWriter::Options options;
+    options.blockSize = 100;
+    EXPECT_THROW(CompressedWriter("test_compressed.obz", options), Exception);
+
+    {
+        File file("test_compressed.obz", "wb");
+        file.write("not a compressed file at all, but long enough to have a footer");
+    }
+
+    EXPECT_THROW(CompressedReader("test_compressed.obz"), Exception);
+
+    // A damaged block is reported rather than returned.
+    std::string text(100000, 'x');
+    {
+        CompressedWriter writer("test_compressed.obz");
+        writer.write(text);
+    }
+
+    {
+        File file("test_compressed.obz", "r+b");
+        file.writeAt(100, 4, "\0\0\0\0");
+    }
+
+    CompressedReader reader("test_compressed.obz");
+    EXPECT_THROW(reader.readAll(), Exception);
+
+    FileUtil::remove("test_compressed.obz");
+}
+
+/*****************************************************************************/
+
+}
@@ -0,0 +1,123 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string>
+
+#include <oblivion/core/aligned_buffer.h>
+#include <oblivion/core/direct_file.h>
+#include <oblivion/core/exception.h>
+#include <oblivion/core/file_util.h>
+
+namespace oblivion {
+
+/*****************************************************************************/
+
+TEST(DirectFileTest, Aligned) {
+    AlignedBuffer buffer(3 * DirectFile::ALIGNMENT);
+    memset(buffer.data(), 'a', buffer.size());
+
+    {
+        DirectFile file("test_direct.bin", DirectMode::Create);
+        file.writeAt(0, buffer.size(), buffer.data());
+        file.sync(true);
+        EXPECT_EQ(buffer.size(), file.size());
+    }
+
+    DirectFile file("test_direct.bin", DirectMode::Read);
+    memset(buffer.data(), 0, buffer.size());
+
+    EXPECT_EQ(buffer.size(), file.readAt(0, buffer.size(), buffer.data()));
+    EXPECT_EQ(std::string(buffer.size(), 'a'), std::string(buffer.data(), buffer.size()));
+
+    // Reads that run into the end of the file stop there.
+    memset(buffer.data(), 0, buffer.size());
+    EXPECT_EQ(DirectFile::ALIGNMENT, file.readAt(2 * DirectFile::ALIGNMENT, buffer.size(), buffer.data()));
+    EXPECT_EQ(std::string(DirectFile::ALIGNMENT, 'a'), std::string(buffer.data(), DirectFile::ALIGNMENT));
+    EXPECT_EQ(0u, file.readAt(buffer.size(), DirectFile::ALIGNMENT, buffer.data()));
+
+    EXPECT_THROW(file.writeAt(0, DirectFile::ALIGNMENT, buffer.data()), Exception);
+    EXPECT_THROW(DirectFile("test_direct_missing.bin", DirectMode::Read), Exception);
+
+    FileUtil::remove("test_direct.bin");
+}
+
+/*****************************************************************************/
+
+TEST(DirectFileTest, Unaligned) {
+    std::string expected;
+
+    {
+        DirectFile file("test_direct.bin", DirectMode::Create);
+
+        // Writes of every shape, including ones larger than a bounce buffer,
+        // checked against the same writes applied to a string.
+        const size_t shapes[][2] = {
+            { 0, 100 }, { 50, 5000 }, { 4000, 200 }, { 4096, 4096 }, { 10000, 1 },
+            { 1, DirectFile::BOUNCE_SIZE * 2 + 123 }, { 8192, 4097 }, { 20, 10 }
+        };
+
+        int32 fill = 0;
+        for (auto& shape : shapes) {
+            std::string data;
+            for (size_t i = 0; i < shape[1]; ++i) {
+                data += static_cast<char>('a' + (fill++ % 26));
+            }
+
+            file.writeAt(shape[0], data.size(), data.data());
+
+            if (expected.size() < shape[0] + data.size()) {
+                expected.resize(shape[0] + data.size());
+            }
+
+            expected.replace(shape[0], data.size(), data);
+            ASSERT_EQ(expected.size(), file.size());
+        }
+    }
+
+    DirectFile file("test_direct.bin", DirectMode::ReadWrite);
+    EXPECT_EQ(expected, FileUtil::readAll("test_direct.bin"));
+
+    const size_t ranges[][2] = {
+        { 0, 1 }, { 3, 4093 }, { 4095, 2 }, { 4096, 8192 + 7 }, { 12345, DirectFile::BOUNCE_SIZE + 5 },
+        { expected.size() - 10, 100 }, { expected.size(), 10 }
+    };
+
+    for (auto& range : ranges) {
+        std::string data(range[1] + 1, '\0');
+        auto count = file.readAt(range[0], range[1], &data[1]);
+
+        auto expectedCount = std::min(range[1], expected.size() - range[0]);
+        ASSERT_EQ(expectedCount, count) << range[0];
+        EXPECT_EQ(expected.substr(range[0], count), data.substr(1, count)) << range[0];
+    }
+
+    FileUtil::remove("test_direct.bin");
+}
+
+/*****************************************************************************/
+
+TEST(DirectFileTest, MovedFrom) {
+    DirectFile file("test_direct.bin", DirectMode::Create);
+    DirectFile moved(std::move(file));
+    EXPECT_EQ("test_direct.bin", moved.path());
+
+    char buffer[100];
+    EXPECT_THROW(file.readAt(0, sizeof(buffer), buffer), Exception);
+    EXPECT_THROW(file.writeAt(1, sizeof(buffer), buffer), Exception);
+    EXPECT_THROW(file.size(), Exception);
+    EXPECT_THROW(file.truncate(0), Exception);
+    EXPECT_THROW(file.sync(), Exception);
+    EXPECT_THROW(file.direct(), Exception);
+    EXPECT_THROW(file.path(), Exception);
+
+    file = std::move(moved);
+    EXPECT_EQ(0u, file.size());
+
+    FileUtil::remove("test_direct.bin");
+}
+
+/*****************************************************************************/
+
+}
@@ -2,6 +2,10 @@
 
 #include <gtest/gtest.h>
 
+#include <string>
+#include <thread>
+#include <vector>
+
 #include <oblivion/core/exception.h>
 #include <oblivion/core/file.h>
 #include <oblivion/core/file_util.h>
@@ -46,4 +50,117 @@ TEST(FileTest, ReadWrite) {
 
 /*****************************************************************************/
 
+TEST(FileTest, ReadLongLine) {
+    std::string line(5000, 'x');
+
+    {
+        File outFile("test.txt", "wb");
+        outFile.writeLine(line);
+        outFile.write("last");
+    }
+
+    {
+        File inFile("test.txt", "rb");
+        EXPECT_EQ(line + "\n", inFile.readLine());
+        EXPECT_EQ("last", inFile.readLine());
+        EXPECT_EQ("", inFile.readLine());
+    }
+
+    FileUtil::remove("test.txt");
+}
+
+/*****************************************************************************/
+
+TEST(FileTest, Positional) {
+    {
+        File file("test.txt", "w+b");
+        file.write("0123456789");
+        EXPECT_EQ(10u, file.size());
+
+        file.writeAt(4, 2, "ab");
+        file.writeAt(12, 2, "yz");
+        EXPECT_EQ(14u, file.size());
+
+        char buffer[16];
+        EXPECT_EQ(4u, file.readAt(2, 4, buffer));
+        EXPECT_EQ("23ab", std::string(buffer, 4));
+
+        // Short at the end of the file.
+        EXPECT_EQ(2u, file.readAt(12, sizeof(buffer), buffer));
+        EXPECT_EQ("yz", std::string(buffer, 2));
+        EXPECT_EQ(0u, file.readAt(100, sizeof(buffer), buffer));
+
+        // The stream position is untouched.
+        EXPECT_EQ(10, file.position());
+        file.write("!");
+        file.flush();
+        EXPECT_EQ(1u, file.readAt(10, 1, buffer));
+        EXPECT_EQ('!', buffer[0]);
+        file.seek(int64(1) << 32, SEEK_SET);
+        EXPECT_EQ(int64(1) << 32, file.position());
+    }
+
+    {
+        File file("test.txt", "w+b");
+
+        std::string header = "HDR:";
+        std::string payload = "payload";
+        IoBuffer out[3] = {
+            { nullptr, 0 },
+            { &header[0], header.size() },
+            { &payload[0], payload.size() }
+        };
+        file.writev(0, out, 3);
+        EXPECT_EQ(11u, file.size());
+
+        std::string first(2, '\0');
+        std::string second(20, '\0');
+        IoBuffer in[2] = {
+            { &first[0], first.size() },
+            { &second[0], second.size() }
+        };
+        EXPECT_EQ(11u, file.readv(0, in, 2));
+        EXPECT_EQ("HD", first);
+        EXPECT_EQ("R:payload", second.substr(0, 9));
+    }
+
+    {
+        std::string contents;
+        for (int i = 0; i < 4096; ++i) {
+            contents += static_cast<char>('a' + i % 26);
+        }
+
+        File file("test.txt", "w+b");
+        file.writeAt(0, contents.size(), contents.data());
+
+        // Threads read different regions of the same file at once.
+        std::vector<std::thread> threads;
+        std::vector<int> matches(4, 0);
+        for (int t = 0; t < 4; ++t) {
+            threads.push_back(std::thread([&, t] {
+                char buffer[64];
+                for (int i = 0; i < 200; ++i) {
+                    size_t offset = (t * 1000 + i * 13) % (contents.size() - sizeof(buffer));
+                    if (file.readAt(offset, sizeof(buffer), buffer) == sizeof(buffer) &&
+                        contents.compare(offset, sizeof(buffer), buffer, sizeof(buffer)) == 0) {
+                        ++matches[t];
+                    }
+                }
+            }));
+        }
+
+        for (auto& thread : threads) {
+            thread.join();
+        }
+
+        for (auto count : matches) {
+            EXPECT_EQ(200, count);
+        }
+    }
+
+    FileUtil::remove("test.txt");
+}
+
+/*****************************************************************************/
+
 }
@@ -8,6 +8,11 @@
 #include <oblivion/core/file_util.h>
 #include <oblivion/core/string_util.h>
 
+#ifndef WIN32
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 namespace oblivion {
 
 TEST(FileUtilTest, Exists) {
@@ -24,6 +29,140 @@ TEST(FileUtilTest, Exists) {
 
 /*****************************************************************************/
 
+TEST(FileUtilTest, Rename) {
+    EXPECT_THROW(FileUtil::rename("notreal.txt", "test_rename.txt"), Exception);
+
+    {
+        File file("test_rename_from.txt", "w");
+        file.write("new");
+        file.sync();
+    }
+
+    {
+        File file("test_rename.txt", "w");
+        file.write("old");
+    }
+
+    FileUtil::rename("test_rename_from.txt", "test_rename.txt");
+
+    EXPECT_FALSE(FileUtil::exists("test_rename_from.txt"));
+
+    {
+        File file("test_rename.txt", "r");
+        EXPECT_EQ("new", file.readLine());
+    }
+
+    FileUtil::remove("test_rename.txt");
+}
+
+/*****************************************************************************/
+
+TEST(FileUtilTest, ReadWriteAll) {
+    EXPECT_THROW(FileUtil::readAll("notreal.txt"), Exception);
+    EXPECT_THROW(FileUtil::writeAll("notreal/test.txt", "data"), Exception);
+
+    FileUtil::writeAll("test_all.txt", "");
+    EXPECT_EQ("", FileUtil::readAll("test_all.txt"));
+
+    FileUtil::writeAll("test_all.txt", "hello\nworld", true);
+    EXPECT_EQ("hello\nworld", FileUtil::readAll("test_all.txt"));
+
+    // Direct writes of sizes that are not a multiple of the block size, from
+    // an unaligned buffer.
+    std::string contents;
+    for (int i = 0; i < 100000; ++i) {
+        contents += static_cast<char>('a' + i % 26);
+    }
+
+    FileUtil::writeAll("test_all.txt", contents.data() + 1, contents.size() - 1, true, true);
+    EXPECT_EQ(contents.substr(1), FileUtil::readAll("test_all.txt"));
+
+    FileUtil::writeAll("test_all.txt", contents.data(), 10, false, true);
+    EXPECT_EQ(contents.substr(0, 10), FileUtil::readAll("test_all.txt"));
+
+    FileUtil::remove("test_all.txt");
+
+#ifdef __linux__
+    // Special files report a size of 0 but still have contents.
+    EXPECT_TRUE(StringUtil::startsWith(FileUtil::readAll("/proc/self/status"), "Name:"));
+#endif
+}
+
+/*****************************************************************************/
+
+TEST(FileUtilTest, Copy) {
+    EXPECT_THROW(FileUtil::copy("notreal.txt", "test_copy.txt"), Exception);
+    EXPECT_FALSE(FileUtil::exists("test_copy.txt"));
+
+    FileUtil::writeAll("test_copy_from.txt", "");
+    FileUtil::copy("test_copy_from.txt", "test_copy.txt");
+    EXPECT_EQ("", FileUtil::readAll("test_copy.txt"));
+
+    std::string contents;
+    for (int i = 0; i < 3000000; ++i) {
+        contents += static_cast<char>('a' + i % 26);
+    }
+
+    FileUtil::writeAll("test_copy_from.txt", contents);
+    FileUtil::copy("test_copy_from.txt", "test_copy.txt");
+    EXPECT_EQ(contents, FileUtil::readAll("test_copy.txt"));
+
+    // A file with a large hole in the middle and one at the end.
+    {
+        File file("test_copy_from.txt", "wb");
+        file.writeAt(0, 5, "start");
+        file.writeAt(8 << 20, 6, "middle");
+    }
+
+    {
+        File file("test_copy_from.txt", "r+b");
+        file.writeAt((16 << 20) - 1, 1, "");
+    }
+
+    auto sparse = FileUtil::readAll("test_copy_from.txt");
+    ASSERT_EQ(16u << 20, sparse.size());
+
+    FileUtil::copy("test_copy_from.txt", "test_copy.txt", true);
+    EXPECT_TRUE(sparse == FileUtil::readAll("test_copy.txt"));
+
+    FileUtil::copy("test_copy_from.txt", "test_copy.txt");
+    EXPECT_TRUE(sparse == FileUtil::readAll("test_copy.txt"));
+
+#ifdef __linux__
+    FileUtil::copy("/proc/self/status", "test_copy.txt");
+    EXPECT_TRUE(StringUtil::startsWith(FileUtil::readAll("test_copy.txt"), "Name:"));
+#endif
+
+    // Copying a file onto itself must not truncate it.
+    FileUtil::writeAll("test_copy_from.txt", "keep");
+    EXPECT_THROW(FileUtil::copy("test_copy_from.txt", "test_copy_from.txt"), Exception);
+    EXPECT_EQ("keep", FileUtil::readAll("test_copy_from.txt"));
+
+#ifndef WIN32
+    FileUtil::remove("test_copy.txt");
+    ASSERT_EQ(0, link("test_copy_from.txt", "test_copy.txt"));
+    EXPECT_THROW(FileUtil::copy("test_copy_from.txt", "test_copy.txt"), Exception);
+    EXPECT_EQ("keep", FileUtil::readAll("test_copy_from.txt"));
+    FileUtil::remove("test_copy.txt");
+
+    // The permissions are copied regardless of the umask or an existing target.
+    FileUtil::writeAll("test_copy.txt", "old contents");
+    ASSERT_EQ(0, chmod("test_copy.txt", 0600));
+    ASSERT_EQ(0, chmod("test_copy_from.txt", 0747));
+    FileUtil::copy("test_copy_from.txt", "test_copy.txt");
+    EXPECT_EQ("keep", FileUtil::readAll("test_copy.txt"));
+
+    struct stat status;
+    ASSERT_EQ(0, stat("test_copy.txt", &status));
+    EXPECT_EQ(0747, static_cast<int>(status.st_mode & 07777));
+#endif
+
+    FileUtil::remove("test_copy_from.txt");
+    FileUtil::remove("test_copy.txt");
+}
+
+/*****************************************************************************/
+
 TEST(FileUtilTest, Remove) {
     EXPECT_THROW(FileUtil::remove("notreal.txt"), Exception);
 
@@ -0,0 +1,139 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#include <gtest/gtest.h>
+
+#include <oblivion/core/exception.h>
+#include <oblivion/core/json_schema.h>
+#include <oblivion/core/variant.h>
+
+namespace oblivion {
+
+/*****************************************************************************/
+
+static bool matches(const std::string& schema, const std::string& value) {
+    JsonSchema compiled(Variant::parseJson(schema));
+    return compiled.validate(Variant::parseJson(value));
+}
+
+/*****************************************************************************/
+
+TEST(JsonSchemaTest, Types) {
+    EXPECT_TRUE(matches("{\"type\":\"integer\"}", "3"));
+    EXPECT_TRUE(matches("{\"type\":\"integer\"}", "3.0"));
+    EXPECT_FALSE(matches("{\"type\":\"integer\"}", "3.5"));
+    EXPECT_TRUE(matches("{\"type\":\"number\"}", "3.5"));
+    EXPECT_FALSE(matches("{\"type\":\"string\"}", "3"));
+    EXPECT_TRUE(matches("{\"type\":[\"string\",\"null\"]}", "null"));
+    EXPECT_TRUE(matches("{\"type\":\"boolean\"}", "false"));
+    EXPECT_TRUE(matches("{\"type\":\"array\"}", "[]"));
+    EXPECT_TRUE(matches("{\"type\":\"object\"}", "{}"));
+    EXPECT_TRUE(matches("true", "[1]"));
+    EXPECT_FALSE(matches("false", "[1]"));
+}
+
+/*****************************************************************************/
+
+TEST(JsonSchemaTest, Scalars) {
+    EXPECT_TRUE(matches("{\"minimum\":1,\"exclusiveMaximum\":10}", "1"));
+    EXPECT_FALSE(matches("{\"minimum\":1,\"exclusiveMaximum\":10}", "10"));
+    EXPECT_FALSE(matches("{\"exclusiveMinimum\":1}", "1"));
+    EXPECT_TRUE(matches("{\"multipleOf\":0.5}", "2.5"));
+    EXPECT_FALSE(matches("{\"multipleOf\":2}", "3"));
+    EXPECT_TRUE(matches("{\"minLength\":2,\"maxLength\":3}", "\"abc\""));
+    EXPECT_FALSE(matches("{\"minLength\":2,\"maxLength\":3}", "\"abcd\""));
+    EXPECT_TRUE(matches("{\"pattern\":\"^[a-z]+\\\\.[0-9]$\"}", "\"pool.1\""));
+    EXPECT_FALSE(matches("{\"pattern\":\"^[a-z]+$\"}", "\"Pool\""));
+    EXPECT_TRUE(matches("{\"enum\":[1,\"two\",[3]]}", "[3]"));
+    EXPECT_FALSE(matches("{\"enum\":[1,\"two\",[3]]}", "\"three\""));
+    EXPECT_TRUE(matches("{\"const\":{\"a\":1}}", "{\"a\":1.0}"));
+
+    // enum and const must both hold.
+    EXPECT_TRUE(matches("{\"enum\":[1,2],\"const\":2}", "2"));
+    EXPECT_FALSE(matches("{\"enum\":[1,2],\"const\":3}", "3"));
+    EXPECT_FALSE(matches("{\"enum\":[1,2],\"const\":2}", "1"));
+}
+
+/*****************************************************************************/
+
+TEST(JsonSchemaTest, Objects) {
+    std::string schema =
+        "{\"type\":\"object\","
+        "\"properties\":{\"host\":{\"type\":\"string\"},\"port\":{\"type\":\"integer\",\"maximum\":65535}},"
+        "\"required\":[\"host\",\"port\"],"
+        "\"additionalProperties\":false}";
+
+    EXPECT_TRUE(matches(schema, "{\"host\":\"db\",\"port\":5432}"));
+    EXPECT_FALSE(matches(schema, "{\"host\":\"db\"}"));
+    EXPECT_FALSE(matches(schema, "{\"host\":\"db\",\"port\":70000}"));
+    EXPECT_FALSE(matches(schema, "{\"host\":\"db\",\"port\":1,\"user\":\"x\"}"));
+
+    EXPECT_TRUE(matches("{\"additionalProperties\":{\"type\":\"integer\"}}", "{\"a\":1,\"b\":2}"));
+    EXPECT_FALSE(matches("{\"additionalProperties\":{\"type\":\"integer\"}}", "{\"a\":1,\"b\":\"2\"}"));
+    EXPECT_FALSE(matches("{\"minProperties\":2}", "{\"a\":1}"));
+
+    // Names that are only required are still additional properties.
+    EXPECT_FALSE(matches("{\"required\":[\"x\"],\"additionalProperties\":false}", "{\"x\":1}"));
+    EXPECT_FALSE(matches("{\"required\":[\"x\"],\"additionalProperties\":{\"type\":\"string\"}}", "{\"x\":1}"));
+    EXPECT_TRUE(matches("{\"required\":[\"x\"],\"additionalProperties\":{\"type\":\"string\"}}", "{\"x\":\"1\"}"));
+}
+
+/*****************************************************************************/
+
+TEST(JsonSchemaTest, Arrays) {
+    EXPECT_TRUE(matches("{\"items\":{\"type\":\"integer\"},\"minItems\":1}", "[1,2,3]"));
+    EXPECT_FALSE(matches("{\"items\":{\"type\":\"integer\"},\"minItems\":1}", "[]"));
+    EXPECT_FALSE(matches("{\"items\":{\"type\":\"integer\"}}", "[1,\"2\"]"));
+    EXPECT_FALSE(matches("{\"maxItems\":2}", "[1,2,3]"));
+    EXPECT_FALSE(matches("{\"uniqueItems\":true}", "[1,2,1.0]"));
+    EXPECT_TRUE(matches("{\"uniqueItems\":true}", "[1,2,\"1\"]"));
+}
+
+/*****************************************************************************/
+
+TEST(JsonSchemaTest, Combinators) {
+    EXPECT_TRUE(matches("{\"anyOf\":[{\"type\":\"string\"},{\"minimum\":5}]}", "6"));
+    EXPECT_FALSE(matches("{\"anyOf\":[{\"type\":\"string\"},{\"minimum\":5}]}", "4"));
+    EXPECT_FALSE(matches("{\"allOf\":[{\"minimum\":1},{\"maximum\":3}]}", "4"));
+    EXPECT_TRUE(matches("{\"oneOf\":[{\"type\":\"integer\"},{\"type\":\"string\"}]}", "1"));
+    EXPECT_FALSE(matches("{\"oneOf\":[{\"type\":\"integer\"},{\"minimum\":0}]}", "1"));
+    EXPECT_FALSE(matches("{\"not\":{\"type\":\"null\"}}", "null"));
+}
+
+/*****************************************************************************/
+
+TEST(JsonSchemaTest, Errors) {
+    JsonSchema schema(Variant::parseJson(
+        "{\"properties\":{\"servers\":{\"items\":{\"required\":[\"host\"],"
+        "\"properties\":{\"port\":{\"type\":\"integer\"}}}}}}"));
+
+    std::vector<std::string> errors;
+    EXPECT_FALSE(schema.validate(Variant::parseJson(
+        "{\"servers\":[{\"host\":\"a\"},{\"port\":\"x\"}]}"), errors));
+
+    ASSERT_EQ(2u, errors.size());
+    EXPECT_TRUE(StringUtil::startsWith(errors[0], "/servers/1/port: "));
+    EXPECT_TRUE(StringUtil::startsWith(errors[1], "/servers/1: missing required property host"));
+
+    errors.clear();
+    EXPECT_TRUE(schema.validate(Variant::parseJson("{\"servers\":[]}"), errors));
+    EXPECT_TRUE(errors.empty());
+
+    JsonSchema escaped(Variant::parseJson("{\"additionalProperties\":{\"type\":\"integer\"}}"));
+    EXPECT_FALSE(escaped.validate(Variant::parseJson("{\"a/b~c\":\"x\"}"), errors));
+    ASSERT_EQ(1u, errors.size());
+    EXPECT_TRUE(StringUtil::startsWith(errors[0], "/a~1b~0c: "));
+}
+
+/*****************************************************************************/
+
+TEST(JsonSchemaTest, InvalidSchema) {
+    EXPECT_THROW(JsonSchema(Variant::parseJson("{\"$ref\":\"#/a\"}")), Exception);
+    EXPECT_THROW(JsonSchema(Variant::parseJson("{\"type\":\"widget\"}")), Exception);
+    EXPECT_THROW(JsonSchema(Variant::parseJson("{\"minLength\":-1}")), Exception);
+    EXPECT_THROW(JsonSchema(Variant::parseJson("{\"pattern\":\"[\"}")), Exception);
+    EXPECT_THROW(JsonSchema(Variant::parseJson("3")), Exception);
+}
+
+/*****************************************************************************/
+
+}
@@ -0,0 +1,82 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#include <gtest/gtest.h>
+
+#include <cstdlib>
+
+#include <oblivion/core/layered_properties.h>
+
+namespace oblivion {
+
+/*****************************************************************************/
+
+TEST(LayeredPropertiesTest, Overlay) {
+    Properties defaults;
+    defaults.set("db.host", "localhost");
+    defaults.set("db.port", 5432);
+    defaults.set("cache.ttl", 30);
+
+    Properties file;
+    file.set("db.host", "db1");
+
+    auto shared = std::make_shared<Properties>(defaults);
+
+    LayeredProperties props;
+    props.addLayer(shared);
+    props.addLayer(file);
+
+    EXPECT_EQ(2, props.layerCount());
+    EXPECT_EQ(shared, props.layer(0));
+
+    EXPECT_EQ("db1", props.getProperty("db.host"));
+    EXPECT_EQ(5432, props.get<int32>("db.port"));
+    EXPECT_EQ(3, props.get<int32>("missing", 3));
+    EXPECT_EQ("", props.getProperty("missing"));
+    EXPECT_FALSE(props.contains("missing"));
+
+    props.set("cache.ttl", 60);
+    EXPECT_EQ(60, props.get<int32>("cache.ttl"));
+    EXPECT_EQ(30, shared->get<int32>("cache.ttl"));
+
+    auto flat = props.flatten();
+    EXPECT_EQ(3, flat.size());
+    EXPECT_EQ("db1", flat.getProperty("db.host"));
+    EXPECT_EQ("60", flat.getProperty("cache.ttl"));
+}
+
+/*****************************************************************************/
+
+#ifndef WIN32
+
+TEST(LayeredPropertiesTest, Environment) {
+    setenv("OBTEST_DB_PRIMARY_HOST", "envhost", 1);
+    setenv("OBTEST_MAX__CONNECTIONS", "16", 1);
+    setenv("OBTESTX", "ignored", 1);
+
+    auto env = LayeredProperties::environment("OBTEST_");
+    EXPECT_EQ(2, env.size());
+    EXPECT_EQ("envhost", env.getProperty("db.primary.host"));
+    EXPECT_EQ("16", env.getProperty("max_connections"));
+
+    Properties defaults;
+    defaults.set("db.primary.host", "localhost");
+    defaults.set("db.primary.port", 5432);
+
+    LayeredProperties props;
+    props.addLayer(defaults);
+    props.addEnvironmentLayer("OBTEST_");
+
+    EXPECT_EQ("envhost", props.getProperty("db.primary.host"));
+    EXPECT_EQ(5432, props.get<int32>("db.primary.port"));
+    EXPECT_EQ(16, props.get<int32>("max_connections"));
+
+    unsetenv("OBTEST_DB_PRIMARY_HOST");
+    unsetenv("OBTEST_MAX__CONNECTIONS");
+    unsetenv("OBTESTX");
+}
+
+#endif
+
+/*****************************************************************************/
+
+}
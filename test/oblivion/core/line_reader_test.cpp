@@ -0,0 +1,91 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include <oblivion/core/file.h>
+#include <oblivion/core/file_util.h>
+#include <oblivion/core/line_reader.h>
+#include <oblivion/core/mapped_file.h>
+
+namespace oblivion {
+
+/*****************************************************************************/
+
+static std::vector<std::string> readAll(LineReader& reader) {
+    std::vector<std::string> lines;
+    while (reader.next()) {
+        lines.push_back(reader.str());
+    }
+
+    return lines;
+}
+
+/*****************************************************************************/
+
+TEST(LineReaderTest, Memory) {
+    std::string text = "first\r\n\nthird\nlast";
+    LineReader reader(text.data(), text.size());
+
+    EXPECT_EQ(0, reader.lineNumber());
+    ASSERT_TRUE(reader.next());
+    EXPECT_EQ(5u, reader.size());
+    EXPECT_EQ(text.data(), reader.data());
+    EXPECT_EQ(1, reader.lineNumber());
+
+    auto rest = readAll(reader);
+    ASSERT_EQ(3u, rest.size());
+    EXPECT_EQ("", rest[0]);
+    EXPECT_EQ("third", rest[1]);
+    EXPECT_EQ("last", rest[2]);
+    EXPECT_EQ(4, reader.lineNumber());
+    EXPECT_FALSE(reader.next());
+
+    std::string trailing = "a\nb\n";
+    LineReader trailingReader(trailing.data(), trailing.size());
+    EXPECT_EQ(2u, readAll(trailingReader).size());
+
+    LineReader empty(nullptr, 0);
+    EXPECT_FALSE(empty.next());
+}
+
+/*****************************************************************************/
+
+TEST(LineReaderTest, File) {
+    std::string longLine(10000, 'y');
+
+    {
+        File file("test_lines.txt", "wb");
+        file.write("one\r\n");
+        file.write(longLine + "\n");
+        file.write("three\n");
+    }
+
+    {
+        File file("test_lines.txt", "rb");
+        LineReader reader(file, 16);
+
+        auto lines = readAll(reader);
+        ASSERT_EQ(3u, lines.size());
+        EXPECT_EQ("one", lines[0]);
+        EXPECT_EQ(longLine, lines[1]);
+        EXPECT_EQ("three", lines[2]);
+    }
+
+    {
+        MappedFile file("test_lines.txt");
+        LineReader reader(file);
+
+        auto lines = readAll(reader);
+        ASSERT_EQ(3u, lines.size());
+        EXPECT_EQ(longLine, lines[1]);
+    }
+
+    FileUtil::remove("test_lines.txt");
+}
+
+/*****************************************************************************/
+
+}
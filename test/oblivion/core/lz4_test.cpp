@@ -0,0 +1,78 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#include <gtest/gtest.h>
+
+#include <string>
+#include <vector>
+
+#include <oblivion/core/exception.h>
+#include <oblivion/core/lz4.h>
+#include <oblivion/core/random.h>
+
+namespace oblivion {
+
+/*****************************************************************************/
+
+static std::string roundTrip(const std::string& input) {
+    std::vector<char> packed(Lz4::compressBound(input.size()));
+    auto size = Lz4::compress(input.data(), input.size(), packed.data());
+    EXPECT_LE(size, packed.size());
+
+    std::string output(input.size() + 1, '\0');
+    output.resize(Lz4::decompress(packed.data(), size, &output[0], output.size()));
+    return output;
+}
+
+/*****************************************************************************/
+
+TEST(Lz4Test, RoundTrip) {
+    Random random(42);
+
+    std::string noise;
+    for (auto i = 0; i < 100000; ++i) {
+        noise += static_cast<char>(random.nextRange(256));
+    }
+
+    std::string text;
+    for (auto i = 0; i < 5000; ++i) {
+        text += "line " + std::to_string(i % 97) + " of some fairly repetitive text\n";
+    }
+
+    const std::string inputs[] = {
+        "", "a", "short input", std::string(13, 'x'), std::string(100000, 'a'),
+        "abcabcabcabcabcabcabcabcabcabcabcabcabc", noise, text, noise.substr(0, 300) + text + noise
+    };
+
+    for (auto& input : inputs) {
+        EXPECT_EQ(input, roundTrip(input)) << input.size();
+    }
+
+    // Repetitive data must actually shrink.
+    std::vector<char> packed(Lz4::compressBound(text.size()));
+    EXPECT_LT(Lz4::compress(text.data(), text.size(), packed.data()), text.size() / 4);
+}
+
+/*****************************************************************************/
+
+TEST(Lz4Test, Decompress) {
+    // One literal, a match of 8 at offset 1, then five literals.
+    const char block[] = { 0x14, 'a', 0x01, 0x00, 0x50, 'b', 'c', 'd', 'e', 'f' };
+    char out[32];
+
+    ASSERT_EQ(14u, Lz4::decompress(block, sizeof(block), out, sizeof(out)));
+    EXPECT_EQ("aaaaaaaaabcdef", std::string(out, 14));
+
+    EXPECT_THROW(Lz4::decompress(block, sizeof(block), out, 13), Exception);
+    EXPECT_THROW(Lz4::decompress(block, 0, out, sizeof(out)), Exception);
+    EXPECT_THROW(Lz4::decompress(block, 3, out, sizeof(out)), Exception);
+
+    const char badOffset[] = { 0x14, 'a', 0x02, 0x00, 0x50, 'b', 'c', 'd', 'e', 'f' };
+    EXPECT_THROW(Lz4::decompress(badOffset, sizeof(badOffset), out, sizeof(out)), Exception);
+
+    const char zeroOffset[] = { 0x14, 'a', 0x00, 0x00, 0x50, 'b', 'c', 'd', 'e', 'f' };
+    EXPECT_THROW(Lz4::decompress(zeroOffset, sizeof(zeroOffset), out, sizeof(out)), Exception);
+}
+
+/*****************************************************************************/
+
+}
@@ -0,0 +1,148 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+#include <string>
+
+#include <oblivion/core/exception.h>
+#include <oblivion/core/file.h>
+#include <oblivion/core/file_util.h>
+#include <oblivion/core/mapped_file.h>
+
+namespace oblivion {
+
+/*****************************************************************************/
+
+static void writeFile(const std::string& path, const std::string& contents) {
+    File file(path, "wb");
+    file.write(contents);
+}
+
+/*****************************************************************************/
+
+TEST(MappedFileTest, ReadOnly) {
+    EXPECT_THROW(MappedFile("notreal.txt"), Exception);
+
+    writeFile("test_mapped.txt", "hello mapped world");
+
+    {
+        MappedFile file("test_mapped.txt");
+        EXPECT_EQ(18u, file.size());
+        EXPECT_FALSE(file.empty());
+        EXPECT_EQ("hello mapped world", std::string(file.begin(), file.end()));
+        EXPECT_EQ('m', file[6]);
+        EXPECT_EQ(18u, file.fileSize());
+        EXPECT_EQ("test_mapped.txt", file.path());
+        EXPECT_THROW(file.mutableData(), Exception);
+
+        file.advise(MapAdvice::Sequential);
+        file.advise(MapAdvice::WillNeed, 6, 6);
+        file.advise(MapAdvice::HugePage);
+
+        MappedFile moved(std::move(file));
+        EXPECT_EQ("hello", std::string(moved.data(), 5));
+
+        EXPECT_TRUE(file.empty());
+        EXPECT_TRUE(file.data() == nullptr);
+        EXPECT_TRUE(file.begin() == file.end());
+        EXPECT_EQ(0u, file.offset());
+        EXPECT_THROW(file.fileSize(), Exception);
+        EXPECT_THROW(file.path(), Exception);
+        EXPECT_THROW(file.remap(), Exception);
+        EXPECT_THROW(file.mutableData(), Exception);
+        file.sync();
+        file.advise(MapAdvice::Sequential);
+    }
+
+    {
+        MappedFile range("test_mapped.txt", MapMode::ReadOnly, 6, 6);
+        EXPECT_EQ(6u, range.offset());
+        EXPECT_EQ("mapped", std::string(range.begin(), range.end()));
+
+        range.remap(13, 5);
+        EXPECT_EQ("world", std::string(range.begin(), range.end()));
+
+        EXPECT_THROW(range.remap(13, 6), Exception);
+        EXPECT_EQ(18u, range.fileSize());
+    }
+
+    writeFile("test_mapped.txt", "");
+
+    {
+        MappedFile file("test_mapped.txt");
+        EXPECT_TRUE(file.empty());
+        EXPECT_TRUE(file.begin() == file.end());
+    }
+
+    FileUtil::remove("test_mapped.txt");
+}
+
+/*****************************************************************************/
+
+TEST(MappedFileTest, ReadWrite) {
+    writeFile("test_mapped.txt", "abc");
+
+    {
+        MappedFile file("test_mapped.txt", MapMode::ReadWrite);
+        file.mutableData()[0] = 'x';
+
+        file.resize(8192 + 3);
+        EXPECT_EQ(8195u, file.size());
+        EXPECT_EQ("xbc", std::string(file.data(), 3));
+
+        memcpy(file.mutableData() + 8192, "end", 3);
+        file.sync();
+    }
+
+    {
+        File file("test_mapped.txt", "rb");
+        EXPECT_EQ(8195u, file.size());
+
+        std::string contents(file.size(), '\0');
+        file.read(contents.size(), &contents[0]);
+        EXPECT_EQ("xbc", contents.substr(0, 3));
+        EXPECT_EQ("end", contents.substr(8192));
+    }
+
+    writeFile("test_mapped.txt", "abc");
+
+    {
+        // Mapping past the end grows the file instead of faulting on access.
+        MappedFile file("test_mapped.txt", MapMode::ReadWrite, 0, 10);
+        EXPECT_EQ(10u, file.fileSize());
+
+        file.mutableData()[9] = 'z';
+        file.sync();
+    }
+
+    EXPECT_EQ(std::string("abc\0\0\0\0\0\0z", 10), FileUtil::readAll("test_mapped.txt"));
+
+    FileUtil::remove("test_mapped.txt");
+}
+
+/*****************************************************************************/
+
+TEST(MappedFileTest, Grow) {
+    writeFile("test_mapped.txt", "first");
+
+    {
+        MappedFile file("test_mapped.txt");
+        EXPECT_EQ(5u, file.size());
+
+        {
+            File append("test_mapped.txt", "ab");
+            append.write(" second");
+        }
+
+        EXPECT_EQ(12u, file.fileSize());
+        file.remap();
+        EXPECT_EQ("first second", std::string(file.begin(), file.end()));
+    }
+
+    FileUtil::remove("test_mapped.txt");
+}
+
+/*****************************************************************************/
+
+}
@@ -2,9 +2,13 @@
 
 #include <gtest/gtest.h>
 
+#include <chrono>
+
 #include <oblivion/core/exception.h>
+#include <oblivion/core/file.h>
 #include <oblivion/core/file_util.h>
 #include <oblivion/core/properties.h>
+#include <oblivion/core/string_util.h>
 
 namespace oblivion {
 
@@ -21,6 +25,280 @@ TEST(PropertiesTest, Get) {
 
 /*****************************************************************************/
 
+TEST(PropertiesTest, TypedCache) {
+    Properties props;
+    props.set("pool.size", 16);
+
+    EXPECT_EQ(16, props.get<int32>("pool.size"));
+    EXPECT_EQ(16, props.get<int32>("pool.size"));
+    EXPECT_EQ(16.0, props.get<real64>("pool.size"));
+    EXPECT_EQ("16", props.get<std::string>("pool.size"));
+
+    props.set("pool.size", 32);
+    EXPECT_EQ(32, props.get<int32>("pool.size"));
+    EXPECT_EQ(32.0, props.get<real64>("pool.size"));
+
+    props.setProperty("enabled", "TRUE");
+    EXPECT_TRUE(props.get<bool>("enabled"));
+    props.setProperty("enabled", "false");
+    EXPECT_FALSE(props.get<bool>("enabled"));
+    EXPECT_TRUE(props.get<bool>("missing", true));
+}
+
+/*****************************************************************************/
+
+TEST(PropertiesTest, Copy) {
+    Properties p1;
+    p1.set("name", "Jeff");
+    p1.set("age", 28);
+    EXPECT_EQ(28, p1.get<int32>("age"));
+
+    Properties p2(p1);
+    p1.set("age", 29);
+
+    EXPECT_EQ(28, p2.get<int32>("age"));
+    EXPECT_EQ(29, p1.get<int32>("age"));
+
+    p2 = p1;
+    EXPECT_EQ(29, p2.get<int32>("age"));
+    EXPECT_EQ("Jeff", p2.getProperty("name"));
+
+    Properties p3(std::move(p2));
+    EXPECT_EQ(2, p3.size());
+    EXPECT_EQ("Jeff", p3.getProperty("name"));
+}
+
+/*****************************************************************************/
+
+TEST(PropertiesTest, Handle) {
+    Properties p1;
+    p1.set("cache.ttl", 30);
+
+    auto ttl = p1.handle<int32>("cache.ttl");
+    auto size = p1.handle<int32>("cache.size");
+    auto name = p1.handle<std::string>("cache.name");
+
+    EXPECT_EQ(30, ttl.get());
+    EXPECT_EQ(30, p1.get(ttl));
+    EXPECT_EQ(64, size.get(64));
+    EXPECT_EQ("", name.get());
+    EXPECT_EQ(1, p1.size());
+    EXPECT_FALSE(p1.contains("cache.size"));
+
+    p1.set("cache.size", 128);
+    p1.set("cache.name", "sessions");
+    EXPECT_EQ(128, size.get(64));
+    EXPECT_EQ("sessions", name.get());
+
+    p1.set("cache.ttl", 60);
+    EXPECT_EQ(60, ttl.get());
+
+    p1.clear();
+    EXPECT_EQ(60, ttl.get(60));
+    EXPECT_EQ(0, ttl.get());
+    EXPECT_TRUE(p1.begin() == p1.end());
+
+    p1.set("cache.ttl", 90);
+    p1.save("test.properties");
+    p1.clear();
+    p1.load("test.properties");
+    EXPECT_EQ(90, ttl.get());
+    EXPECT_EQ(1, p1.size());
+
+    Properties p2(p1);
+    EXPECT_EQ(90, p2.get(ttl));
+
+    EXPECT_THROW(PropertyHandle<int32>().get(), Exception);
+    EXPECT_EQ(5, p1.get(PropertyHandle<int32>(), 5));
+
+    FileUtil::remove("test.properties");
+}
+
+/*****************************************************************************/
+
+TEST(PropertiesTest, View) {
+    Properties p1;
+    p1.set("db.replica.host", "db2");
+    p1.set("db.primary.port", 5432);
+    p1.set("db.primary.host", "db1");
+    p1.set("dbx", "other");
+    p1.set("cache.ttl", 30);
+
+    auto primary = p1.view("db.primary.");
+    EXPECT_EQ("db.primary.", primary.prefix());
+    EXPECT_EQ(2, primary.size());
+    EXPECT_EQ("db1", primary.getProperty("host"));
+    EXPECT_EQ(5432, primary.get<int32>("port"));
+    EXPECT_EQ(1, primary.get<int32>("user", 1));
+    EXPECT_FALSE(primary.contains("db.primary.host"));
+
+    auto itr = primary.begin();
+    EXPECT_EQ("db.primary.host", itr->first);
+    EXPECT_EQ("db.primary.port", (++itr)->first);
+    EXPECT_TRUE(++itr == primary.end());
+
+    auto db = p1.view("db.");
+    EXPECT_EQ(3, db.size());
+    EXPECT_EQ("db2", db.getProperty("replica.host"));
+    EXPECT_EQ("db1", db.view("primary.").getProperty("host"));
+    EXPECT_TRUE(db.view("standby.").empty());
+
+    EXPECT_EQ(5, p1.view("").size());
+    EXPECT_EQ(4, p1.view("db").size());
+    EXPECT_TRUE(p1.view("zzz").empty());
+
+    auto section = primary.toProperties();
+    EXPECT_EQ(2, section.size());
+    EXPECT_EQ(5432, section.get<int32>("port"));
+
+    p1.handle<std::string>("db.primary.user");
+    EXPECT_EQ(2, p1.view("db.primary.").size());
+    EXPECT_FALSE(p1.view("db.primary.").contains("user"));
+
+    p1.set("db.primary.user", "admin");
+    EXPECT_EQ(3, p1.view("db.primary.").size());
+    EXPECT_EQ("admin", p1.view("db.primary.").getProperty("user"));
+
+    Properties p2(p1);
+    p1.clear();
+    EXPECT_TRUE(p1.view("db.").empty());
+    EXPECT_EQ(4, p2.view("db.").size());
+
+    Properties::View empty;
+    EXPECT_TRUE(empty.empty());
+    EXPECT_EQ("", empty.getProperty("host"));
+    EXPECT_TRUE(empty.view("a.").empty());
+}
+
+/*****************************************************************************/
+
+/**
+ * Adds names in a scrambled order and reads them back in name order.
+ * @return The seconds taken.
+ */
+static double buildScrambled(int32 count) {
+    auto start = std::chrono::steady_clock::now();
+
+    Properties properties;
+    for (auto i = 0; i < count; ++i) {
+        // 7919 is prime, so this visits every number below count once.
+        auto key = static_cast<int32>((static_cast<int64>(i) * 7919) % count);
+        properties.setProperty("key." + StringUtil::toString(key), "value");
+    }
+
+    auto view = properties.view("key.");
+    EXPECT_EQ(count, view.size());
+
+    std::string previous;
+    for (auto& property : view) {
+        EXPECT_LT(previous, property.first);
+        previous = property.first;
+    }
+
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/*****************************************************************************/
+
+TEST(PropertiesTest, ViewScaling) {
+    // Sorting once on the first ordered read keeps building linear in the
+    // number of names; sorting on every insert made four times as many names
+    // take sixteen times as long.
+    auto small = buildScrambled(20000);
+    auto large = buildScrambled(80000);
+
+    EXPECT_LT(large, small * 10 + 0.05);
+}
+
+/*****************************************************************************/
+
+TEST(PropertiesTest, Interpolation) {
+    Properties p1;
+    p1.set("host", "db1");
+    p1.set("port", 5432);
+    p1.set("url", "postgres://${host}:${port}/${name}");
+    p1.set("backup.url", "${url}?backup");
+    p1.set("literal", "$${host}");
+    p1.set("timeout", "${seconds}");
+
+    EXPECT_EQ("postgres://${host}:${port}/${name}", p1.getProperty("url"));
+
+    p1.setInterpolation(true);
+    EXPECT_EQ("postgres://db1:5432/", p1.getProperty("url"));
+    EXPECT_EQ("postgres://db1:5432/?backup", p1.getProperty("backup.url"));
+    EXPECT_EQ("${host}", p1.getProperty("literal"));
+    EXPECT_EQ("", p1.getProperty("timeout"));
+
+    // References returned earlier stay valid across changes and, like raw
+    // values, see the new expansion once it has been read.
+    auto& before = p1.getProperty("backup.url");
+
+    p1.set("host", "db2");
+    p1.set("name", "orders");
+    EXPECT_EQ("postgres://db1:5432/?backup", before);
+    EXPECT_EQ("postgres://db2:5432/orders?backup", p1.getProperty("backup.url"));
+    EXPECT_EQ("postgres://db2:5432/orders?backup", before);
+
+    // Repeated changes reuse the same string rather than keeping every expansion.
+    for (auto i = 0; i < 1000; ++i) {
+        p1.set("name", i);
+        EXPECT_EQ(&before, &p1.getProperty("backup.url"));
+    }
+
+    p1.set("name", "orders");
+
+    p1.set("seconds", 30);
+    EXPECT_EQ(30, p1.get<int32>("timeout"));
+    p1.set("seconds", 45);
+    EXPECT_EQ(45, p1.get<int32>("timeout"));
+
+    p1.set("url", "static");
+    p1.set("host", "db3");
+    EXPECT_EQ("static?backup", p1.getProperty("backup.url"));
+
+    Properties p2(p1);
+    p2.set("url", "${host}");
+    EXPECT_EQ("db3?backup", p2.getProperty("backup.url"));
+    EXPECT_EQ("static?backup", p1.getProperty("backup.url"));
+
+    p1.set("a", "${b}");
+    p1.set("b", "${a}");
+    EXPECT_THROW(p1.getProperty("a"), Exception);
+
+    p1.setInterpolation(false);
+    EXPECT_EQ("${b}", p1.getProperty("a"));
+}
+
+/*****************************************************************************/
+
+TEST(PropertiesTest, InterpolationReload) {
+    Properties p1;
+    p1.set("host", "db1");
+    p1.set("url", "${host}/app");
+    p1.save("test.properties");
+
+    p1.set("host", "db2");
+    p1.save("test2.properties", true);
+
+    Properties p2;
+    p2.setInterpolation(true);
+    p2.load("test.properties");
+    EXPECT_EQ("db1/app", p2.getProperty("url"));
+
+    auto url = p2.handle<std::string>("url");
+    p2.clear();
+    EXPECT_EQ("", url.get());
+
+    p2.load("test2.properties");
+    EXPECT_EQ("db2/app", url.get());
+    EXPECT_EQ("db2/app", p2.view("").getProperty("url"));
+
+    FileUtil::remove("test.properties");
+    FileUtil::remove("test2.properties");
+}
+
+/*****************************************************************************/
+
 TEST(PropertiesTest, SaveLoadConstructor) {
     Properties p1;
     p1.set("name", "Jeff");
@@ -54,6 +332,73 @@ TEST(PropertiesTest, SaveLoad) {
 
 /*****************************************************************************/
 
+static std::string readFile(const std::string& path) {
+    File file(path, "rb");
+
+    std::string contents(file.size(), '\0');
+    file.read(contents.size(), &contents[0]);
+
+    return contents;
+}
+
+/*****************************************************************************/
+
+TEST(PropertiesTest, SaveSorted) {
+    Properties p1;
+    p1.set("b", 2);
+    p1.set("c", 3);
+    p1.set("a", 1);
+
+    p1.save("test.properties");
+    EXPECT_EQ("b = 2\nc = 3\na = 1\n", readFile("test.properties"));
+
+    p1.save("test.properties", true);
+    EXPECT_EQ("a = 1\nb = 2\nc = 3\n", readFile("test.properties"));
+    EXPECT_FALSE(FileUtil::exists("test.properties.tmp"));
+
+    EXPECT_THROW(p1.save("notreal/test.properties"), Exception);
+    EXPECT_FALSE(FileUtil::exists("notreal/test.properties.tmp"));
+
+    FileUtil::remove("test.properties");
+}
+
+/*****************************************************************************/
+
+TEST(PropertiesTest, LoadFormat) {
+    std::string longValue(10000, 'x');
+
+    {
+        File file("test.properties", "wb");
+        file.write("# comment\r\n");
+        file.write("\r\n");
+        file.write("  name =  Jeff \r\n");
+        file.write("\tempty=\n");
+        file.write("equation = a=b\n");
+        file.write("long = " + longValue + "\n");
+        file.write("last=1");
+    }
+
+    Properties props("test.properties");
+    EXPECT_EQ(5, props.size());
+    EXPECT_EQ("Jeff", props.getProperty("name"));
+    EXPECT_TRUE(props.contains("empty"));
+    EXPECT_EQ("", props.getProperty("empty"));
+    EXPECT_EQ("a=b", props.getProperty("equation"));
+    EXPECT_EQ(longValue, props.getProperty("long"));
+    EXPECT_EQ(1, props.get<int32>("last"));
+
+    {
+        File file("test.properties", "wb");
+        file.write("name = Bob\nnot a property\n");
+    }
+
+    EXPECT_THROW(props.load("test.properties"), Exception);
+
+    FileUtil::remove("test.properties");
+}
+
+/*****************************************************************************/
+
 TEST(PropertiesTest, Iterable) {
     Properties p1;
     p1.set("name", "Jeff");
@@ -0,0 +1,132 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <oblivion/core/exception.h>
+#include <oblivion/core/file_util.h>
+#include <oblivion/core/properties_watcher.h>
+#include <oblivion/core/shared_properties.h>
+
+namespace oblivion {
+
+/*****************************************************************************/
+
+TEST(PropertiesWatcherTest, ReloadOnChange) {
+    Properties file;
+    file.set("host", "localhost");
+    file.set("port", 80);
+    file.set("debug", false);
+
+    // References are compared unexpanded, so these are unchanged even though
+    // url expands differently and the cycle cannot be expanded at all.
+    file.set("url", "http://${host}:${port}/");
+    file.set("a", "${b}");
+    file.set("b", "${a}");
+    file.save("test_watch.properties");
+
+    SharedProperties props("test_watch.properties");
+    props.update([](Properties& properties) { properties.setInterpolation(true); });
+
+    std::mutex mutex;
+    std::condition_variable changedCondition;
+    std::set<std::string> changed;
+    auto notifications = 0;
+
+    {
+        PropertiesWatcher watcher(props, "test_watch.properties", 50);
+        watcher.subscribe([&](const std::set<std::string>& keys) {
+            std::lock_guard<std::mutex> lock(mutex);
+            changed = keys;
+            ++notifications;
+            changedCondition.notify_all();
+        });
+
+        file.set("port", 8080);
+        file.clear();
+        file.set("host", "localhost");
+        file.set("port", 8080);
+        file.set("user", "admin");
+        file.set("url", "http://${host}:${port}/");
+        file.set("a", "${b}");
+        file.set("b", "${a}");
+
+        // Several writes in a burst are reloaded once.
+        for (auto i = 0; i < 3; ++i) {
+            file.save("test_watch.properties");
+        }
+
+        std::unique_lock<std::mutex> lock(mutex);
+        changedCondition.wait_for(lock, std::chrono::seconds(5), [&]() { return notifications > 0; });
+
+        EXPECT_EQ(1, notifications);
+        EXPECT_EQ(1, watcher.reloadCount());
+        EXPECT_EQ(3u, changed.size());
+        EXPECT_EQ(1u, changed.count("port"));
+        EXPECT_EQ(1u, changed.count("user"));
+        EXPECT_EQ(1u, changed.count("debug"));
+    }
+
+    EXPECT_EQ(8080, props.get<int32>("port"));
+    EXPECT_FALSE(props.snapshot()->contains("debug"));
+
+    FileUtil::remove("test_watch.properties");
+}
+
+/*****************************************************************************/
+
+TEST(PropertiesWatcherTest, BusyDirectoryAndThrowingListener) {
+    Properties file;
+    file.set("port", 80);
+    file.save("test_watch.properties");
+
+    SharedProperties props("test_watch.properties");
+
+    std::mutex mutex;
+    std::condition_variable changedCondition;
+    auto notifications = 0;
+
+    {
+        PropertiesWatcher watcher(props, "test_watch.properties", 100);
+        watcher.subscribe([](const std::set<std::string>&) {
+            OB_THROW("Listener failed");
+        });
+        watcher.subscribe([&](const std::set<std::string>&) {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++notifications;
+            changedCondition.notify_all();
+        });
+
+        file.set("port", 8080);
+        file.save("test_watch.properties");
+
+        // Writes to another file more often than the debounce interval must
+        // not hold the reload back.
+        auto stop = std::chrono::steady_clock::now() + std::chrono::seconds(3);
+        while (std::chrono::steady_clock::now() < stop) {
+            FileUtil::writeAll("test_watch_other.txt", "x");
+
+            std::unique_lock<std::mutex> lock(mutex);
+            if (changedCondition.wait_for(lock, std::chrono::milliseconds(10), [&]() { return notifications > 0; })) {
+                break;
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        EXPECT_EQ(1, notifications);
+        EXPECT_EQ(1, watcher.reloadCount());
+    }
+
+    EXPECT_EQ(8080, props.get<int32>("port"));
+
+    FileUtil::remove("test_watch.properties");
+    FileUtil::remove("test_watch_other.txt");
+}
+
+/*****************************************************************************/
+
+}
@@ -0,0 +1,192 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <oblivion/core/exception.h>
+#include <oblivion/core/file_util.h>
+#include <oblivion/core/shared_properties.h>
+#include <oblivion/core/string_util.h>
+
+namespace oblivion {
+
+/*****************************************************************************/
+
+TEST(SharedPropertiesTest, Snapshot) {
+    SharedProperties props;
+    props.setProperty("name", "Jeff");
+
+    auto before = props.snapshot();
+    props.setProperty("name", "Bob");
+    props.setProperty("age", "28");
+
+    EXPECT_EQ("Jeff", before->getProperty("name"));
+    EXPECT_FALSE(before->contains("age"));
+
+    EXPECT_EQ("Bob", props.getProperty("name"));
+    EXPECT_EQ(28, props.get<int32>("age"));
+    EXPECT_EQ(5, props.get<int32>("missing", 5));
+}
+
+/*****************************************************************************/
+
+TEST(SharedPropertiesTest, Reload) {
+    Properties p1;
+    p1.set("name", "Jeff");
+    p1.save("test.properties");
+
+    SharedProperties props("test.properties");
+    EXPECT_EQ("Jeff", props.getProperty("name"));
+
+    p1.set("name", "Bob");
+    p1.save("test.properties");
+
+    auto before = props.snapshot();
+    props.reload("test.properties");
+
+    EXPECT_EQ("Jeff", before->getProperty("name"));
+    EXPECT_EQ("Bob", props.getProperty("name"));
+
+    EXPECT_THROW(props.reload("notreal.properties"), Exception);
+    EXPECT_EQ("Bob", props.getProperty("name"));
+
+    FileUtil::remove("test.properties");
+}
+
+/*****************************************************************************/
+
+TEST(SharedPropertiesTest, Handle) {
+    Properties p1;
+    p1.set("port", 80);
+    p1.save("test.properties");
+
+    SharedProperties props("test.properties");
+    auto port = props.handle<int32>("port");
+    auto host = props.handle<std::string>("host");
+
+    EXPECT_EQ(80, props.get(port));
+    EXPECT_EQ("localhost", props.get(host, std::string("localhost")));
+    EXPECT_THROW(port.get(), Exception);
+
+    p1.set("port", 8080);
+    p1.set("host", "example.com");
+    p1.save("test.properties");
+    props.reload("test.properties");
+
+    EXPECT_EQ(8080, props.get(port));
+    EXPECT_EQ("example.com", props.get(host));
+    EXPECT_EQ(8080, props.snapshot()->get(port));
+
+    Properties p2;
+    p2.set("host", "other.com");
+    props.publish(p2);
+
+    EXPECT_EQ(0, props.get(port));
+    EXPECT_EQ("other.com", props.get(host));
+    EXPECT_EQ(1, props.snapshot()->size());
+
+    FileUtil::remove("test.properties");
+}
+
+/*****************************************************************************/
+
+TEST(SharedPropertiesTest, CompactsUnusedNames) {
+    SharedProperties props;
+    auto port = props.handle<int32>("port");
+
+    for (auto generation = 0; generation < 50; ++generation) {
+        Properties next;
+        next.set("port", generation);
+        next.set("name." + StringUtil::toString(generation), generation);
+        props.publish(next);
+    }
+
+    props.update([](Properties& properties) {
+        properties.clear();
+        properties.set("only", 1);
+    });
+
+    // A new name in a copy gets the next free slot, which counts the slots in use:
+    // the handle name and the one property that is set.
+    Properties copy(*props.snapshot());
+    EXPECT_EQ(2, copy.handle<int32>("probe").slot());
+
+    EXPECT_EQ(0, port.slot());
+    EXPECT_EQ(7, props.get(port, 7));
+    EXPECT_EQ(1, props.get<int32>("only"));
+}
+
+/*****************************************************************************/
+
+TEST(SharedPropertiesTest, ManyInstances) {
+    // More instances than each thread keeps references for.
+    std::vector<std::unique_ptr<SharedProperties>> all;
+    for (auto i = 0; i < 20; ++i) {
+        all.emplace_back(new SharedProperties());
+        all.back()->setProperty("index", StringUtil::toString(i));
+    }
+
+    for (auto round = 0; round < 3; ++round) {
+        for (auto i = 0; i < 20; ++i) {
+            EXPECT_EQ(i + round, all[i]->get<int32>("index"));
+            all[i]->setProperty("index", StringUtil::toString(i + round + 1));
+        }
+    }
+
+    std::thread reader([&]() {
+        for (auto i = 0; i < 20; ++i) {
+            EXPECT_EQ(i + 3, all[i]->get<int32>("index"));
+        }
+    });
+
+    reader.join();
+}
+
+/*****************************************************************************/
+
+TEST(SharedPropertiesTest, ConcurrentReaders) {
+    SharedProperties props;
+
+    Properties initial;
+    initial.set("a", 0);
+    initial.set("b", 0);
+    props.publish(initial);
+
+    std::atomic<bool> done(false);
+    std::atomic<int32> tornReads(0);
+
+    std::vector<std::thread> readers;
+    for (auto i = 0; i < 4; ++i) {
+        readers.push_back(std::thread([&]() {
+            while (!done) {
+                auto snapshot = props.snapshot();
+                if (snapshot->get<int32>("a") != snapshot->get<int32>("b")) {
+                    ++tornReads;
+                }
+            }
+        }));
+    }
+
+    for (auto i = 1; i <= 200; ++i) {
+        props.update([i](Properties& properties) {
+            properties.set("a", i);
+            properties.set("b", i);
+        });
+    }
+
+    done = true;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    EXPECT_EQ(0, tornReads.load());
+    EXPECT_EQ(200, props.get<int32>("a"));
+}
+
+/*****************************************************************************/
+
+}
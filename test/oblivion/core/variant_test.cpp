@@ -3,6 +3,8 @@
 #include <gtest/gtest.h>
 
 #include <oblivion/core/exception.h>
+#include <oblivion/core/file.h>
+#include <oblivion/core/file_util.h>
 #include <oblivion/core/variant.h>
 
 namespace oblivion {
@@ -179,6 +181,175 @@ TEST(VariantTest, ToJson) {
 
 /*****************************************************************************/
 
+TEST(VariantTest, ToJsonParallel) {
+    Variant v(3);
+    EXPECT_EQ(v.toJson(), v.toJsonParallel(4));
+
+    Variant arrayVar(VariantType::Array);
+    Variant mapVar(VariantType::Map);
+
+    for (auto i = 0; i < 5000; ++i) {
+        Variant entry(VariantType::Map);
+        entry["id"] = i;
+        entry["name"] = "item \"" + StringUtil::toString(i) + "\"";
+        entry["weight"] = i * 0.5;
+
+        arrayVar.add(entry);
+        mapVar["key" + StringUtil::toString(i)] = entry;
+    }
+
+    EXPECT_EQ(arrayVar.toJson(), arrayVar.toJsonParallel(4));
+    EXPECT_EQ(arrayVar.toJson(), arrayVar.toJsonParallel(3));
+    EXPECT_EQ(mapVar.toJson(), mapVar.toJsonParallel(4));
+    EXPECT_EQ(mapVar.toJson(), mapVar.toJsonParallel(1));
+
+    {
+        File file("test.json", "wb");
+        mapVar.writeJson(file, 4);
+    }
+
+    std::string contents;
+
+    {
+        File file("test.json", "rb");
+        contents.resize(file.size());
+        file.read(contents.size(), &contents[0]);
+    }
+
+    EXPECT_EQ(mapVar.toJson(), contents);
+
+    FileUtil::remove("test.json");
+}
+
+/*****************************************************************************/
+
+TEST(VariantTest, MemoryUsage) {
+    Variant intVar(10);
+    auto usage = intVar.memoryUsage();
+
+    EXPECT_LT(0u, usage.nodeBytes);
+    EXPECT_EQ(0u, usage.stringBytes);
+    EXPECT_EQ(usage.nodeBytes, usage.total());
+
+    Variant stringVar(std::string(100, 'x'));
+    EXPECT_LE(101u, stringVar.memoryUsage().stringBytes);
+
+    Variant mapVar(VariantType::Map);
+    mapVar[std::string(64, 'k')] = stringVar;
+    mapVar["small"] = intVar;
+
+    usage = mapVar.memoryUsage();
+    EXPECT_LE(65u, usage.keyBytes);
+    EXPECT_LE(101u, usage.stringBytes);
+    EXPECT_LT(2 * intVar.memoryUsage().nodeBytes, usage.nodeBytes);
+
+    Variant arrayVar(VariantType::Array);
+    arrayVar.add(1);
+    arrayVar.add(2);
+    arrayVar.add(3);
+
+    usage = arrayVar.memoryUsage();
+    EXPECT_LT(3 * intVar.memoryUsage().nodeBytes, usage.total());
+    EXPECT_EQ(usage.total(), usage.nodeBytes + usage.containerSlackBytes);
+}
+
+/*****************************************************************************/
+
+TEST(VariantTest, Stats) {
+    auto before = Variant::stats();
+
+    {
+        Variant var(VariantType::Array);
+        var.add("a");
+        var.add("b");
+
+        auto during = Variant::stats();
+        auto stringIndex = static_cast<int32>(VariantType::String);
+
+#ifdef OBLIVION_CORE_VARIANT_STATS
+        EXPECT_EQ(before.liveVariants + 3, during.liveVariants);
+        EXPECT_EQ(before.liveValues[stringIndex] + 2, during.liveValues[stringIndex]);
+        EXPECT_LE(before.allocations[stringIndex] + 2, during.allocations[stringIndex]);
+#else
+        EXPECT_EQ(0, during.liveVariants);
+        EXPECT_EQ(0, during.allocations[stringIndex]);
+#endif
+    }
+
+    EXPECT_EQ(before.liveVariants, Variant::stats().liveVariants);
+}
+
+/*****************************************************************************/
+
+static std::string applyPatch(const std::string& target, const std::string& patch) {
+    auto result = Variant::parseJson(target);
+    result.mergePatch(Variant::parseJson(patch));
+
+    return result.toJson();
+}
+
+/*****************************************************************************/
+
+TEST(VariantTest, MergePatch) {
+    EXPECT_EQ("{\"a\":\"c\"}", applyPatch("{\"a\":\"b\"}", "{\"a\":\"c\"}"));
+    EXPECT_EQ("{\"a\":\"b\",\"b\":\"c\"}", applyPatch("{\"a\":\"b\"}", "{\"b\":\"c\"}"));
+    EXPECT_EQ("{}", applyPatch("{\"a\":\"b\"}", "{\"a\":null}"));
+    EXPECT_EQ("{\"b\":\"c\"}", applyPatch("{\"a\":\"b\",\"b\":\"c\"}", "{\"a\":null}"));
+    EXPECT_EQ("{\"a\":\"c\"}", applyPatch("{\"a\":[\"b\"]}", "{\"a\":\"c\"}"));
+    EXPECT_EQ("{\"a\":[\"b\"]}", applyPatch("{\"a\":\"c\"}", "{\"a\":[\"b\"]}"));
+    EXPECT_EQ("{\"a\":{\"b\":\"d\"}}", applyPatch("{\"a\":{\"b\":\"c\"}}", "{\"a\":{\"b\":\"d\",\"c\":null}}"));
+    EXPECT_EQ("{\"a\":[1]}", applyPatch("{\"a\":[{\"b\":\"c\"}]}", "{\"a\":[1]}"));
+    EXPECT_EQ("[\"c\",\"d\"]", applyPatch("[\"a\",\"b\"]", "[\"c\",\"d\"]"));
+    EXPECT_EQ("[\"c\"]", applyPatch("{\"a\":\"b\"}", "[\"c\"]"));
+    EXPECT_EQ("null", applyPatch("{\"a\":\"foo\"}", "null"));
+    EXPECT_EQ("\"bar\"", applyPatch("{\"a\":\"foo\"}", "\"bar\""));
+    EXPECT_EQ("{\"a\":\"foo\",\"e\":null}", applyPatch("{\"e\":null}", "{\"a\":\"foo\"}"));
+    EXPECT_EQ("{\"a\":\"foo\"}", applyPatch("[1,2]", "{\"a\":\"foo\",\"c\":null}"));
+    EXPECT_EQ("{\"a\":{\"bb\":{}}}", applyPatch("{}", "{\"a\":{\"bb\":{\"ccc\":null}}}"));
+}
+
+/*****************************************************************************/
+
+TEST(VariantTest, Merge) {
+    auto defaults = Variant::parseJson("{\"db\":{\"host\":\"localhost\",\"port\":5432},\"tags\":[\"a\"],\"debug\":false}");
+    auto overlay = Variant::parseJson("{\"db\":{\"host\":\"prod\"},\"tags\":[\"b\"],\"debug\":null,\"extra\":{\"x\":1}}");
+
+    auto replaced = defaults;
+    replaced.merge(overlay);
+    EXPECT_EQ("{\"db\":{\"host\":\"prod\",\"port\":5432},\"debug\":null,\"extra\":{\"x\":1},\"tags\":[\"b\"]}", replaced.toJson());
+
+    VariantMergeOptions options;
+    options.arrays = ArrayMergeMode::Append;
+    options.nullRemovesKey = true;
+
+    auto appended = defaults;
+    appended.merge(std::move(overlay), options);
+    EXPECT_EQ("{\"db\":{\"host\":\"prod\",\"port\":5432},\"extra\":{\"x\":1},\"tags\":[\"a\",\"b\"]}", appended.toJson());
+
+    EXPECT_TRUE(appended.remove("extra"));
+    EXPECT_FALSE(appended.remove("extra"));
+    EXPECT_THROW(appended["tags"].remove("a"), Exception);
+
+    // Merging a variant into itself sees the overlay as it was before.
+    auto tags = appended["tags"];
+    tags.merge(tags, options);
+    EXPECT_EQ("[\"a\",\"b\",\"a\",\"b\"]", tags.toJson());
+
+    appended.merge(std::move(appended), options);
+    EXPECT_EQ("{\"db\":{\"host\":\"prod\",\"port\":5432},\"tags\":[\"a\",\"b\",\"a\",\"b\"]}", appended.toJson());
+
+    // So does merging a child into its parent, which removes the child as it goes.
+    auto parent = Variant::parseJson("{\"a\":{\"a\":null,\"b\":1,\"c\":{\"d\":2}}}");
+    auto moved = parent;
+    parent.mergePatch(parent["a"]);
+    EXPECT_EQ("{\"b\":1,\"c\":{\"d\":2}}", parent.toJson());
+
+    moved.mergePatch(std::move(moved["a"]));
+    EXPECT_EQ("{\"b\":1,\"c\":{\"d\":2}}", moved.toJson());
+}
+
+/*****************************************************************************/
+
 TEST(VariantTest, ParseJson) {
     Variant v = Variant::parseJson("null");
     EXPECT_EQ(VariantType::Null, v.type());
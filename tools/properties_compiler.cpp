@@ -0,0 +1,27 @@
+/* Copyright (c) 2013 Oblivion Software */
+
+#include <cstdio>
+#include <exception>
+
+#include <oblivion/core/compiled_properties.h>
+#include <oblivion/core/properties.h>
+
+/**
+ * Compiles a properties file into the binary form read by CompiledProperties.
+ */
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        fprintf(stderr, "usage: %s <input.properties> <output>\n", argv[0]);
+        return 2;
+    }
+
+    try {
+        oblivion::Properties properties(argv[1]);
+        oblivion::CompiledProperties::compile(properties, argv[2]);
+    } catch (const std::exception& e) {
+        fprintf(stderr, "%s: %s\n", argv[0], e.what());
+        return 1;
+    }
+
+    return 0;
+}